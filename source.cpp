@@ -6,6 +6,7 @@
  #include <iostream>
  #include <vector>
  #include <queue>
+ #include <deque>
  #include <map>
  #include <string>
  #include <thread>
@@ -25,12 +26,35 @@
  #include <cstring> // Added for strncpy
 // Add this with the other includes if it's not there already (around line 15)
 #include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <functional>
 
 // Add these includes at the top of the file, after the existing includes
 #include <termios.h>
 #include <limits>
 #include <sys/ioctl.h>
 #include <signal.h>
+#include <atomic>
+#include <cerrno>
+#include <pthread.h>
+#include <sys/uio.h>
+#include <poll.h>
+#include <climits>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/eventfd.h>
+#include <sys/epoll.h>
+#include <sched.h>
+#include <sys/stat.h>
+#include <fstream>
+#include <sys/socket.h>
+#include <netdb.h>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
 
  using namespace std;
  
@@ -39,6 +63,9 @@
  // Flight types
  enum class FlightType { COMMERCIAL, CARGO, EMERGENCY };
  
+ // What an airline flies; decides the type of its generated flights
+ enum class AirlineKind { COMMERCIAL, CARGO, MILITARY, MEDICAL };
+ 
  // Aircraft states for arrivals
  enum class ArrivalState { HOLDING, APPROACH, LANDING, TAXI, AT_GATE };
  
@@ -51,6 +78,22 @@
  // Runway designations
  enum class Runway { RWY_A, RWY_B, RWY_C, NONE };
  
+ // Events raised by an aircraft's state machine on phase transitions
+ enum class FlightEvent {
+     STATE_CHANGED,  // Entered a new phase
+     RUNWAY_CLEARED, // Off the runway (arrival entered TAXI, departure entered CLIMB)
+     COMPLETED       // Reached its final phase (arrival AT_GATE, departure CRUISE)
+ };
+ 
+ // How the processes exchange messages
+ enum class Transport { PIPE, SHARED_MEMORY };
+ 
+ // How waiting flights are given runways
+ enum class RunwayPlanning {
+     GREEDY,   // Each tick, whoever tops a queue takes any free runway it may use
+     LOOKAHEAD // Runway slots planned ahead from the phase durations
+ };
+ 
  // Payment status
  enum class PaymentStatus { UNPAID, PAID, OVERDUE };
  
@@ -60,7 +103,8 @@
      PAYMENT_REQUEST,
      PAYMENT_CONFIRMATION,
      QUERY_AVN,
-     QUERY_AIRLINE
+     FLIGHT_HANDOFF,  // Between airports: a departure that will enter the receiver's airspace
+     HANDOFF_BARRIER  // Between airports: the sender has sent every handoff up to tick requestId
  };
  
  // IPC Message structure with fixed-size strings
@@ -73,8 +117,9 @@
      char details[64]; // Fixed-size buffer for details
      int minSpeed; // Added for speed range
      int maxSpeed; // Added for speed range
+     uint32_t requestId; // Set on requests and echoed on their replies, 0 when unsolicited
      
-     IPCMessage() : type(MessageType::AVN_CREATED), avnId(0), amount(0.0), minSpeed(0), maxSpeed(0) {
+     IPCMessage() : type(MessageType::AVN_CREATED), avnId(0), amount(0.0), minSpeed(0), maxSpeed(0), requestId(0) {
          airline[0] = '\0';
          flightNumber[0] = '\0';
          details[0] = '\0';
@@ -122,1862 +167,8218 @@
  const int VIOLATION_PROBABILITY = 15; // 15% chance of a speed violation
  const int MAX_VIOLATION_SPEED_EXCESS = 40; // Max km/h over the limit
  
- // -------- SHARED RESOURCES --------
- 
- // Mutex for console output
- mutex cout_mutex;
- 
- // Mutexes for runway access
- mutex runway_a_mutex;
- mutex runway_b_mutex;
- mutex runway_c_mutex;
- 
- // Mutex for AVN data
- mutex avn_mutex;
+ // StripePay
+ const int PAYMENT_PROCESSING_SECONDS = 2; // Simulated time to settle one payment
+ const int STRIPE_PAY_WORKERS = 8;         // Payments settled concurrently
+ const int STRIPE_PAY_QUEUE_LIMIT = 64;    // Accepted payments waiting for a worker
  
- // Random number generator
- random_device rd;
- mt19937 gen(rd());
+ // The shared AVN table grows a chunk of rows at a time, up to a chunk limit per airport
+ const int SHARED_AVN_CHUNK_ROWS = 65536;
+ const int SHARED_AVN_MAX_CHUNKS = 1024;
+ const int SHARED_AIRLINE_CAPACITY = 256;
  
- // -------- CLASS DEFINITIONS --------
+ // Sharded runs (--airports): one ATC Controller process per airport
+ const int MAX_AIRPORTS = 16;
+ const int AIRPORT_AVN_ID_BLOCK = 100000000; // AVN ids of airport K start at (K - 1) * this + 1000
+ const int HANDOFF_TRANSIT_TICKS = 900;      // A departure reaches its destination's airspace this long after cruise
+ const int DEFAULT_HANDOFF_LAG = 60;         // Ticks between handoff barriers
+ static_assert(static_cast<long long>(MAX_AIRPORTS) * AIRPORT_AVN_ID_BLOCK + 999 <= INT_MAX, "AVN id blocks overflow int");
  
- // Forward declarations
- class Aircraft;
- class FlightScheduler;
+ // AVN deadlines
+ const int AVN_PAYMENT_WINDOW = 3 * 24 * 60 * 60;  // Seconds from issue to due date
+ const int AVN_REMINDER_LEAD = 24 * 60 * 60;       // Reminder this long before the due date
+ const int AVN_ESCALATION_INTERVAL = 24 * 60 * 60; // Between penalty escalations once overdue
+ const int AVN_MAX_ESCALATIONS = 3;
+ const double AVN_LATE_PENALTY_PERCENTAGE = 0.10;  // Of the fine, added per escalation
+
+ // -------- RUN OPTIONS --------
+
+ // Command-line options controlling how the simulation is driven
+ struct SimulationOptions {
+     bool headless;       // Batch mode: no menus, run the ticks back to back and exit
+     int ticks;           // Number of ticks to run in headless mode
+     double timeDilation; // Simulated seconds per wall-clock second (0 = as fast as possible)
+     bool useFlightTable; // Update flight phases through the structure-of-arrays FlightTable
+     int threads;         // Threads for the per-flight phase update (1 = serial)
+     bool hasSeed;        // Seed given on the command line
+     uint64_t seed;       // Seed for every random stream in the run
+     double statusRate;   // Most status frames per wall-clock second (0 = every tick)
+     Transport transport; // How the processes exchange messages
+     string journalPath;  // AVN journal to recover from and append to (empty = none)
+     bool analytics;      // Print the AVN analytics dashboard after a headless run
+     bool wallClockDeadlines; // AVN deadlines follow the wall clock instead of simulated time
+     bool archiveCompleted;   // Retire completed flights into a compact archive and free them
+     string benchmarkPath;    // Run the benchmark suite and write its JSON report here ("-" = stdout)
+     string metricsDir;       // Each process dumps its metrics here (empty = metrics off)
+     string trafficSource;    // Schedule file or tcp:HOST:PORT feed (empty = built-in interval traffic)
+     string checkpointPath;   // Headless runs save their complete state here (empty = no checkpoint)
+     int checkpointAt;        // Simulation time to save it at (-1 = after the last tick)
+     string restorePath;      // Checkpoint to start from instead of tick 0
+     int branches;            // Processes forked off the restored checkpoint, one per branch (0 = just run it)
+     RunwayPlanning runwayPlanning; // How waiting flights are given runways
+     int airports;            // Airports in the network, one ATC Controller process each
+     int handoffLag;          // Ticks between the airports' handoff barriers
+     bool portal;             // Fork the Airline Portal on this terminal while a headless run goes on
+
+     SimulationOptions() : headless(false), ticks(SIMULATION_TIME), timeDilation(0.0), useFlightTable(false),
+                           threads(1), hasSeed(false), seed(0), statusRate(0.0),
+                           transport(Transport::PIPE), analytics(false), wallClockDeadlines(false),
+                           archiveCompleted(false), checkpointAt(-1), branches(0),
+                           runwayPlanning(RunwayPlanning::GREEDY), airports(1), handoffLag(DEFAULT_HANDOFF_LAG),
+                           portal(false) {}
+ };
+
+ // -------- LOGGING --------
  
- // Airspace Violation Notice (AVN)
- class AVN {
- public:
-     int id;
-     string airline;
-     string flightNumber;
-     FlightType aircraftType;
-     int recordedSpeed;
-     int permissibleSpeedMin;
-     int permissibleSpeedMax;
-     time_t issueTime;
-     time_t dueDate;
-     double fineAmount;
-     double serviceFee;
-     double totalAmount;
-     PaymentStatus status;
+ // Log levels, most to least severe. Per-event chatter (runway moves, new flights,
+ // violations, AVN Generator / StripePay activity) is logged at EVENT.
+ enum class LogLevel { OFF, ERROR, WARN, INFO, EVENT };
  
-     AVN(int id, const string& airline, const string& flightNumber, FlightType type, 
-         int recordedSpeed, int permissibleSpeedMin, int permissibleSpeedMax) 
-         : id(id), airline(airline), flightNumber(flightNumber), aircraftType(type),
-           recordedSpeed(recordedSpeed), permissibleSpeedMin(permissibleSpeedMin), 
-           permissibleSpeedMax(permissibleSpeedMax), status(PaymentStatus::UNPAID) {
+ // Asynchronous console log. Each producer thread pushes lines into its own
+ // single-producer ring buffer without taking a lock; one background writer per
+ // process drains every ring and hands the batch to stdout in a single write().
+ class Logger {
+ private:
+     // Single-producer / single-consumer ring of fixed-size text slots. Lines
+     // longer than a slot take several consecutive slots.
+     struct Ring {
+         static constexpr size_t SLOTS = 1024;
+         static constexpr size_t SLOT_TEXT = 252;
          
-         // Set issue time to current time
-         issueTime = time(nullptr);
+         struct Slot {
+             uint32_t length;
+             char text[SLOT_TEXT];
+         };
          
-         // Set due date to 3 days from now
-         dueDate = issueTime + (3 * 24 * 60 * 60);
+         Slot slots[SLOTS];
+         atomic<size_t> head; // Next slot the producer fills
+         atomic<size_t> tail; // Next slot the writer drains
+         pid_t pid;           // Process the ring belongs to (rings are not inherited across fork)
+         atomic<bool> retired; // Its thread has exited; freed by the writer once drained
          
-         // Calculate fine amount based on aircraft type
-         if (type == FlightType::COMMERCIAL) {
-             fineAmount = COMMERCIAL_FINE;
-         } else {
-             fineAmount = CARGO_FINE;
-         }
+         Ring() : head(0), tail(0), pid(getpid()), retired(false) {}
+     };
+     
+     // A thread's ring, retired when the thread exits
+     struct RingHolder {
+         Ring* ring;
          
-         // Calculate service fee
-         serviceFee = fineAmount * SERVICE_FEE_PERCENTAGE;
+         RingHolder() : ring(nullptr) {}
          
-         // Calculate total amount
-         totalAmount = fineAmount + serviceFee;
-     }
- 
-     string getStatusString() const {
-         switch (status) {
-             case PaymentStatus::UNPAID: return "Unpaid";
-             case PaymentStatus::PAID: return "Paid";
-             case PaymentStatus::OVERDUE: return "Overdue";
-             default: return "Unknown";
+         ~RingHolder() {
+             if (ring && ring->pid == getpid()) {
+                 ring->retired.store(true, memory_order_release);
+             }
          }
+     };
+     
+     static atomic<int> level;
+     static thread_local RingHolder localRing;
+     
+     mutex registryMutex;
+     vector<unique_ptr<Ring>> rings;
+     thread* writer; // Owned; only valid in the process that started it
+     pid_t writerPid;
+     atomic<bool> running;
+     
+     // Writer passes, for flush()
+     mutex passMutex;
+     condition_variable wake;
+     condition_variable passDone;
+     uint64_t passes;
+     
+     Logger() : writer(nullptr), writerPid(0), running(false), passes(0) {
+         pthread_atfork(
+             [] { Logger::instance().beforeFork(); },
+             [] { Logger::instance().afterForkParent(); },
+             [] { Logger::instance().afterForkChild(); });
      }
- 
-     string getAircraftTypeString() const {
-         switch (aircraftType) {
-             case FlightType::COMMERCIAL: return "Commercial";
-             case FlightType::CARGO: return "Cargo";
-             case FlightType::EMERGENCY: return "Emergency";
-             default: return "Unknown";
-         }
+     
+     ~Logger() {
+         shutdown();
      }
- 
-     string getFormattedTime(time_t timeValue) const {
-         struct tm* timeinfo = localtime(&timeValue);
-         char buffer[80];
-         strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", timeinfo);
-         return string(buffer);
+     
+     // Hold both locks across fork() so the child never inherits one mid-use
+     void beforeFork() {
+         registryMutex.lock();
+         passMutex.lock();
      }
- 
-     void printDetails() const {
-         lock_guard<mutex> lock(cout_mutex);
-         cout << "============= AVN DETAILS =============" << endl;
-         cout << "AVN ID: " << id << endl;
-         cout << "Airline: " << airline << endl;
-         cout << "Flight Number: " << flightNumber << endl;
-         cout << "Aircraft Type: " << getAircraftTypeString() << endl;
-         cout << "Speed Recorded: " << recordedSpeed << " km/h" << endl;
-         cout << "Permissible Speed Range: " << permissibleSpeedMin << "-" << permissibleSpeedMax << " km/h" << endl;
-         cout << "Issue Date/Time: " << getFormattedTime(issueTime) << endl;
-         cout << "Due Date: " << getFormattedTime(dueDate) << endl;
-         cout << "Fine Amount: PKR " << fixed << setprecision(2) << fineAmount << endl;
-         cout << "Service Fee: PKR " << fixed << setprecision(2) << serviceFee << endl;
-         cout << "Total Due: PKR " << fixed << setprecision(2) << totalAmount << endl;
-         cout << "Payment Status: " << getStatusString() << endl;
-         cout << "=======================================" << endl;
+     
+     void afterForkParent() {
+         passMutex.unlock();
+         registryMutex.unlock();
      }
- };
- 
- // Airline class
- class Airline {
- public:
-     string name;
-     int totalAircrafts;
-     int activeFlights;
-     vector<shared_ptr<AVN>> violations;
      
-     Airline(const string& name, int totalAircrafts, int activeFlights)
-         : name(name), totalAircrafts(totalAircrafts), activeFlights(activeFlights) {}
+     // The child has copies of the parent's rings but no writer thread
+     void afterForkChild() {
+         for (auto& ring : rings) {
+             ring.release(); // Still referenced by the parent's copy of localRing, just drop it
+         }
+         rings.clear();
+         writer = nullptr;
+         writerPid = 0;
+         running = false;
+         passes = 0;
+         passMutex.unlock();
+         registryMutex.unlock();
+     }
      
-     void addViolation(shared_ptr<AVN> violation) {
-         lock_guard<mutex> lock(avn_mutex);
-         violations.push_back(violation);
+     Ring& ring() {
+         if (!localRing.ring || localRing.ring->pid != getpid()) {
+             lock_guard<mutex> lock(registryMutex);
+             rings.emplace_back(new Ring());
+             localRing.ring = rings.back().get();
+             
+             if (!running) {
+                 running = true;
+                 writerPid = getpid();
+                 writer = new thread(&Logger::writerLoop, this);
+             }
+         }
+         return *localRing.ring;
      }
- 
-     void printViolations() const {
-         lock_guard<mutex> lock(cout_mutex);
-         cout << "==== Violations for " << name << " ====" << endl;
+     
+     // Move everything currently in the rings into batch, returns false if there
+     // was nothing. Rings of exited threads are freed once they are empty.
+     bool drain(string& batch) {
+         lock_guard<mutex> lock(registryMutex);
+         bool any = false;
          
-         if (violations.empty()) {
-             cout << "No violations recorded." << endl;
-         } else {
-             for (const auto& avn : violations) {
-                 cout << "AVN ID: " << avn->id << " | Flight: " << avn->flightNumber 
-                      << " | Status: " << avn->getStatusString() 
-                      << " | Amount: PKR " << fixed << setprecision(2) << avn->totalAmount << endl;
+         for (auto it = rings.begin(); it != rings.end();) {
+             Ring& ring = **it;
+             bool retired = ring.retired.load(memory_order_acquire); // Before head: no line comes after it
+             size_t tail = ring.tail.load(memory_order_relaxed);
+             size_t head = ring.head.load(memory_order_acquire);
+             for (; tail != head; tail++) {
+                 const Ring::Slot& slot = ring.slots[tail % Ring::SLOTS];
+                 batch.append(slot.text, slot.length);
+                 any = true;
              }
+             ring.tail.store(tail, memory_order_release);
+             it = retired ? rings.erase(it) : it + 1;
          }
-         cout << "================================" << endl;
+         return any;
+     }
+     
+     static void writeOut(const string& batch) {
+         size_t written = 0;
+         while (written < batch.size()) {
+             ssize_t n = ::write(STDOUT_FILENO, batch.data() + written, batch.size() - written);
+             if (n < 0 && errno == EINTR) {
+                 continue;
+             }
+             if (n <= 0) {
+                 return;
+             }
+             written += n;
+         }
+     }
+     
+     void writerLoop() {
+         string batch;
+         
+         while (running) {
+             batch.clear();
+             bool any = drain(batch);
+             if (!batch.empty()) {
+                 writeOut(batch);
+             }
+             
+             unique_lock<mutex> lock(passMutex);
+             passes++;
+             passDone.notify_all();
+             if (!any) {
+                 wake.wait_for(lock, chrono::milliseconds(2));
+             }
+         }
+         
+         batch.clear();
+         drain(batch);
+         writeOut(batch);
      }
- };
- 
- // Aircraft class (base for both arrival and departure)
- class Aircraft {
- protected:
-     static int nextId;
      
  public:
-     int id;
-     string flightNumber;
-     string airline;
-     FlightType type;
-     Direction direction;
-     int priority;
-     int currentSpeed;
-     bool hasActiveViolation;
-     shared_ptr<AVN> currentViolation;
-     chrono::system_clock::time_point scheduledTime;
-     chrono::system_clock::time_point actualTime;
-     Runway assignedRunway;
-     bool isEmergency;
-     // Add to Aircraft base class (around line 240) after the other member variables:
-
-// Track which states have already had violations
-std::set<string> violatedStates;
-// Add a new member variable to the Aircraft base class (around line 241)
-bool maintainViolationSpeed = false;
-int violationSpeed = 0;
-
-     Aircraft(const string& flightNumber, const string& airline, FlightType type, 
-              Direction direction, int priority, 
-              chrono::system_clock::time_point scheduledTime)
-         : id(nextId++), flightNumber(flightNumber), airline(airline), type(type),
-           direction(direction), priority(priority), currentSpeed(0),
-           hasActiveViolation(false), scheduledTime(scheduledTime),
-           assignedRunway(Runway::NONE), isEmergency(false) {}
+     static Logger& instance() {
+         static Logger logger;
+         return logger;
+     }
      
-     virtual ~Aircraft() {}
+     static void setLevel(LogLevel value) {
+         level.store(static_cast<int>(value), memory_order_relaxed);
+     }
      
-     virtual void updateStatus(int simulationTime) = 0;
-     virtual void checkViolation() = 0;
-     virtual string getStateString() const = 0;
-     virtual bool isCompleted() const = 0;
+     static bool enabled(LogLevel value) {
+         return value != LogLevel::OFF && static_cast<int>(value) <= level.load(memory_order_relaxed);
+     }
      
-     string getRunwayString() const {
-         switch (assignedRunway) {
-             case Runway::RWY_A: return "RWY-A";
-             case Runway::RWY_B: return "RWY-B";
-             case Runway::RWY_C: return "RWY-C";
-             case Runway::NONE: return "None";
-             default: return "Unknown";
+     // Parse a level name (off, error, warn, info, event), returns false if unknown
+     static bool parseLevel(const string& name, LogLevel& value) {
+         static const map<string, LogLevel> names = {
+             {"off", LogLevel::OFF}, {"error", LogLevel::ERROR}, {"warn", LogLevel::WARN},
+             {"info", LogLevel::INFO}, {"event", LogLevel::EVENT}
+         };
+         auto it = names.find(name);
+         if (it == names.end()) {
+             return false;
          }
+         value = it->second;
+         return true;
      }
      
-     string getDirectionString() const {
-         switch (direction) {
-             case Direction::NORTH: return "North";
-             case Direction::SOUTH: return "South";
-             case Direction::EAST: return "East";
-             case Direction::WEST: return "West";
-             default: return "Unknown";
+     // Queue text for the writer. Never blocks on I/O; only waits if this
+     // thread's ring is completely full.
+     void write(const char* text, size_t length) {
+         Ring& target = ring();
+         size_t head = target.head.load(memory_order_relaxed);
+         
+         while (length > 0) {
+             while (head - target.tail.load(memory_order_acquire) >= Ring::SLOTS) {
+                 wake.notify_one();
+                 this_thread::yield();
+             }
+             
+             Ring::Slot& slot = target.slots[head % Ring::SLOTS];
+             slot.length = static_cast<uint32_t>(min(length, Ring::SLOT_TEXT));
+             memcpy(slot.text, text, slot.length);
+             text += slot.length;
+             length -= slot.length;
+             target.head.store(++head, memory_order_release);
          }
      }
      
-     string getTypeString() const {
-         switch (type) {
-             case FlightType::COMMERCIAL: return "Commercial";
-             case FlightType::CARGO: return "Cargo";
-             case FlightType::EMERGENCY: return "Emergency";
-             default: return "Unknown";
+     // Wait until everything logged so far by any thread of this process is on stdout
+     void flush() {
+         if (!running || writerPid != getpid()) {
+             return;
          }
+         unique_lock<mutex> lock(passMutex);
+         uint64_t target = passes + 2; // The pass in progress may have started before our lines
+         wake.notify_one();
+         passDone.wait(lock, [&] { return passes >= target || !running; });
      }
      
-     virtual string getSummary() const {
-         stringstream ss;
-         ss << flightNumber << " | " << airline << " | " << getTypeString() 
-            << " | " << getDirectionString() << " | " << getStateString()
-            << " | Speed: " << currentSpeed << " km/h | Runway: " << getRunwayString();
-         if (isEmergency) ss << " | EMERGENCY";
-         if (hasActiveViolation) ss << " | VIOLATION";
-         return ss.str();
+     // Drain and stop the writer; used before a process exits
+     void shutdown() {
+         if (!running || writerPid != getpid()) {
+             return;
+         }
+         running = false;
+         wake.notify_one();
+         writer->join();
+         delete writer;
+         writer = nullptr;
      }
  };
  
- int Aircraft::nextId = 1000;
+ atomic<int> Logger::level(static_cast<int>(LogLevel::EVENT));
+ thread_local Logger::RingHolder Logger::localRing;
  
- // Arrival Flight class
- class ArrivalFlight : public Aircraft {
+ // One log line, formatted like an ostream and queued on destruction:
+ //     LogLine(LogLevel::EVENT) << "Assigned " << runway << " to " << flight;
+ // Nothing is formatted when the level is disabled.
+ class LogLine {
  private:
-     ArrivalState state;
-     int stateTime; // Time spent in current state
+     ostringstream* stream;
      
-     // State transition times (in simulation seconds)
-     const int HOLDING_TIME = 20;
-     const int APPROACH_TIME = 15;
-     const int LANDING_TIME = 10;
-     const int TAXI_TIME = 15;
+     static ostringstream& threadStream() {
+         static thread_local ostringstream stream;
+         return stream;
+     }
      
  public:
-     ArrivalFlight(const string& flightNumber, const string& airline, FlightType type, 
-                   Direction direction, int priority, 
-                   chrono::system_clock::time_point scheduledTime)
-         : Aircraft(flightNumber, airline, type, direction, priority, scheduledTime),
-           state(ArrivalState::HOLDING), stateTime(0) {
-         
-         // Set initial speed based on state
-         uniform_int_distribution<> holdingDist(HOLDING_MIN_SPEED, HOLDING_MAX_SPEED);
-         currentSpeed = holdingDist(gen);
+     explicit LogLine(LogLevel level) : stream(nullptr) {
+         if (Logger::enabled(level)) {
+             stream = &threadStream();
+             stream->str("");
+             stream->clear();
+             stream->flags(ios_base::dec | ios_base::skipws);
+             stream->precision(6);
+         }
      }
      
-     ArrivalState getState() const {
-         return state;
+     ~LogLine() {
+         if (stream) {
+             *stream << '\n';
+             const string text = stream->str();
+             Logger::instance().write(text.data(), text.size());
+         }
      }
      
-     string getStateString() const override {
-         switch (state) {
-             case ArrivalState::HOLDING: return "Holding";
-             case ArrivalState::APPROACH: return "Approach";
-             case ArrivalState::LANDING: return "Landing";
-             case ArrivalState::TAXI: return "Taxi";
-             case ArrivalState::AT_GATE: return "At Gate";
-             default: return "Unknown";
+     template <typename T>
+     LogLine& operator<<(const T& value) {
+         if (stream) {
+             *stream << value;
          }
+         return *this;
      }
      
-     // For ArrivalFlight::updateStatus (around line 398)
-
-void updateStatus(int simulationTime) override {
-    stateTime++;
-    
-    // Store previous state to detect state transitions
-    ArrivalState previousState = state;
-    
-    // Update speed and state based on current state and time spent in that state
-    switch (state) {
-        case ArrivalState::HOLDING:
-            if (stateTime >= HOLDING_TIME && assignedRunway != Runway::NONE) {
-                state = ArrivalState::APPROACH;
-                stateTime = 0;
-                // Reset violation settings when changing state
-                maintainViolationSpeed = false;
-                
-                if (!maintainViolationSpeed) {
-                    uniform_int_distribution<> approachDist(APPROACH_MIN_SPEED, APPROACH_MAX_SPEED);
-                    currentSpeed = approachDist(gen);
-                }
-            }
-            break;
-            
-        case ArrivalState::APPROACH:
-            if (stateTime >= APPROACH_TIME) {
-                state = ArrivalState::LANDING;
-                stateTime = 0;
-                // Reset violation settings when changing state
-                maintainViolationSpeed = false;
-                
-                if (!maintainViolationSpeed) {
-                    currentSpeed = LANDING_START_SPEED;
-                }
-            }
-            break;
-            
-        case ArrivalState::LANDING:
-            if (!maintainViolationSpeed) {
-                // Gradually decrease speed during landing
-                currentSpeed = max(LANDING_END_SPEED, LANDING_START_SPEED - 
-                                  (LANDING_START_SPEED - LANDING_END_SPEED) * stateTime / LANDING_TIME);
-            }
-            
-            if (stateTime >= LANDING_TIME) {
-                state = ArrivalState::TAXI;
-                stateTime = 0;
-                // Reset violation settings when changing state
-                maintainViolationSpeed = false;
-                
-                if (!maintainViolationSpeed) {
-                    uniform_int_distribution<> taxiDist(TAXI_MIN_SPEED, TAXI_MAX_SPEED);
-                    currentSpeed = taxiDist(gen);
-                }
-            }
-            break;
-            
-        case ArrivalState::TAXI:
-            if (stateTime >= TAXI_TIME) {
-                state = ArrivalState::AT_GATE;
-                stateTime = 0;
-                // Reset violation settings when changing state
-                maintainViolationSpeed = false;
-                currentSpeed = 0;
-            }
-            break;
-            
-        case ArrivalState::AT_GATE:
-            maintainViolationSpeed = false;
-            currentSpeed = 0;
-            break;
-    }
-    
-    // If state has changed, clear violation speed
-    if (previousState != state) {
-        maintainViolationSpeed = false;
-    }
-    
-    // Randomly introduce speed violations with a configurable probability
-    if (!hasActiveViolation && !isEmergency && !maintainViolationSpeed) {  // Don't give violations to emergency flights
-        uniform_int_distribution<> violationChanceDist(1, 100);
-        
-        // Only proceed with violation logic if the random check passes
-        // Make this a lower probability to ensure fewer aircraft get violations
-        if (violationChanceDist(gen) <= VIOLATION_PROBABILITY / 3) {
-            uniform_int_distribution<> violationDist(1, 100);
-            if (violationDist(gen) <= VIOLATION_PROBABILITY) {
-                // Determine excess speed based on current state
-                int excessSpeed = 0;
-                uniform_int_distribution<> excessDist(5, MAX_VIOLATION_SPEED_EXCESS);
-                
-                switch (state) {
-                    case ArrivalState::HOLDING:
-                        excessSpeed = excessDist(gen);
-                        currentSpeed = HOLDING_MAX_SPEED + excessSpeed;
-                        maintainViolationSpeed = true;
-                        violationSpeed = currentSpeed;
-                        break;
-                        
-                    case ArrivalState::APPROACH:
-                        excessSpeed = excessDist(gen);
-                        currentSpeed = APPROACH_MAX_SPEED + excessSpeed;
-                        maintainViolationSpeed = true;
-                        violationSpeed = currentSpeed;
-                        break;
-                        
-                    case ArrivalState::LANDING:
-                        if (stateTime > LANDING_TIME / 2) {
-                            excessSpeed = excessDist(gen);
-                            // Higher speed than should be at this point in landing
-                            currentSpeed += excessSpeed;
-                            maintainViolationSpeed = true;
-                            violationSpeed = currentSpeed;
-                        }
-                        break;
-                        
-                    case ArrivalState::TAXI:
-                        excessSpeed = excessDist(gen) / 2; // Less excess for taxi speeds
-                        currentSpeed = TAXI_MAX_SPEED + excessSpeed;
-                        maintainViolationSpeed = true;
-                        violationSpeed = currentSpeed;
-                        break;
-                        
-                    default:
-                        break;
-                }
-            }
-        }
-    } else if (maintainViolationSpeed) {
-        // Maintain the violation speed until state changes
-        currentSpeed = violationSpeed;
-    }
-    
-    // Check for violations
-    checkViolation();
-}
+     // Manipulators such as fixed
+     LogLine& operator<<(ios_base& (*manipulator)(ios_base&)) {
+         if (stream) {
+             *stream << manipulator;
+         }
+         return *this;
+     }
+ };
+ 
+ // -------- METRICS --------
+ 
+ // Event counts
+ enum class Metric {
+     TICKS,
+     FLIGHTS_DISPATCHED,  // Aircraft put on a runway
+     AVNS_ISSUED,         // By the ATC Controller
+     AVN_NOTICES,         // AVN_CREATED notices handled by the AVN Generator
+     IPC_MESSAGES,        // Messages read off any channel
+     PAYMENTS_SETTLED,
+     RUNWAY_A_BUSY_TICKS, // Ticks that ended with the runway occupied
+     RUNWAY_B_BUSY_TICKS,
+     RUNWAY_C_BUSY_TICKS,
+     RUNWAY_REPLANS,      // Lookahead runway plans built from scratch
+     IPC_REFUSED,         // Messages a full backlog turned away (FrameWriter::REFUSE)
+     COUNT
+ };
+ 
+ // Value distributions
+ enum class Distribution {
+     TICK_NS,
+     GENERATE_NS,
+     ASSIGN_NS,
+     UPDATE_NS,
+     MOVE_NS,
+     RUNWAY_A_QUEUE,     // Depth, sampled once per tick
+     RUNWAY_B_QUEUE,
+     RUNWAY_C_QUEUE,
+     RUNWAY_WAIT_TICKS,  // From entering a queue to getting a runway
+     RUNWAY_DELAY_TICKS, // From being able to use a runway to getting one
+     IPC_LATENCY_US,     // From a frame being opened by its writer to being read
+     PAYMENT_LATENCY_US,
+     COUNT
+ };
+ 
+ // Per-process counters and log2 histograms. Every thread updates its own
+ // shard with plain relaxed stores (one writer per shard, so no atomic
+ // read-modify-write and no shared cache lines); the reporter thread sums the
+ // shards when it writes a dump. With --metrics-dir each process writes
+ // DIR/<role>-<pid>.json every second, on SIGUSR1, and when it exits.
+ class Metrics {
+ private:
+     static constexpr int COUNTERS = static_cast<int>(Metric::COUNT);
+     static constexpr int DISTRIBUTIONS = static_cast<int>(Distribution::COUNT);
+     static constexpr int BUCKETS = 48; // Bucket b holds values below 2^b (bucket 0: zero)
      
-     // Modify the checkViolation method in ArrivalFlight class (around line 634)
-
-void checkViolation() override {
-    // Get current state as a string
-    string currentStateStr = getStateString();
-    
-    // Skip violation check if we already had a violation in this state
-    if (violatedStates.find(currentStateStr) != violatedStates.end()) {
-        return;
-    }
-    
-    bool violation = false;
-    int minSpeed = 0, maxSpeed = 0;
-    
-    switch (state) {
-        case ArrivalState::HOLDING:
-            if (currentSpeed > HOLDING_MAX_SPEED) {
-                violation = true;
-                minSpeed = HOLDING_MIN_SPEED;
-                maxSpeed = HOLDING_MAX_SPEED;
-            }
-            break;
-            
-        case ArrivalState::APPROACH:
-            if (currentSpeed < APPROACH_MIN_SPEED || currentSpeed > APPROACH_MAX_SPEED) {
-                violation = true;
-                minSpeed = APPROACH_MIN_SPEED;
-                maxSpeed = APPROACH_MAX_SPEED;
-            }
-            break;
-            
-        case ArrivalState::LANDING:
-            if (currentSpeed > LANDING_START_SPEED || 
-                (stateTime >= LANDING_TIME && currentSpeed > LANDING_END_SPEED)) {
-                violation = true;
-                minSpeed = 0;
-                maxSpeed = LANDING_START_SPEED;
-            }
-            break;
-            
-        case ArrivalState::TAXI:
-            if (currentSpeed > TAXI_MAX_SPEED) {
-                violation = true;
-                minSpeed = TAXI_MIN_SPEED;
-                maxSpeed = TAXI_MAX_SPEED;
-            }
-            break;
-            
-        case ArrivalState::AT_GATE:
-            if (currentSpeed > GATE_MAX_SPEED) {
-                violation = true;
-                minSpeed = 0;
-                maxSpeed = GATE_MAX_SPEED;
-            }
-            break;
-    }
-    
-    // If there's a violation
-    if (violation) {
-        hasActiveViolation = true;
-        
-        // Create new AVN
-        static int avnIdCounter = 1000;
-        currentViolation = make_shared<AVN>(
-            avnIdCounter++, airline, flightNumber, type,
-            currentSpeed, minSpeed, maxSpeed
-        );
-        
-        // Add this state to the set of states that have had violations
-        violatedStates.insert(currentStateStr);
-        
-        lock_guard<mutex> lock(cout_mutex);
-        cout << "\nVIOLATION DETECTED! Flight " << flightNumber 
-             << " (" << airline << ") - Speed: " << currentSpeed 
-             << " km/h in " << getStateString() << " state.\n";
-    }
-}
+     struct Histogram {
+         atomic<uint64_t> buckets[BUCKETS];
+         atomic<uint64_t> count;
+         atomic<uint64_t> sum;
+         atomic<uint64_t> max;
+     };
      
-     bool isCompleted() const override {
-         return state == ArrivalState::AT_GATE;
+     struct alignas(64) Shard {
+         atomic<uint64_t> counters[COUNTERS];
+         Histogram histograms[DISTRIBUTIONS];
+         
+         Shard() {
+             for (auto& counter : counters) {
+                 counter.store(0, memory_order_relaxed);
+             }
+             for (auto& histogram : histograms) {
+                 for (auto& bucket : histogram.buckets) {
+                     bucket.store(0, memory_order_relaxed);
+                 }
+                 histogram.count.store(0, memory_order_relaxed);
+                 histogram.sum.store(0, memory_order_relaxed);
+                 histogram.max.store(0, memory_order_relaxed);
+             }
+         }
+     };
+     
+     static atomic<bool> on;
+     static volatile sig_atomic_t dumpRequested;
+     static thread_local Shard* localShard;
+     
+     mutex registryMutex;
+     vector<unique_ptr<Shard>> shards;
+     string directory;
+     string role;
+     chrono::steady_clock::time_point started;
+     thread* reporter; // Owned; only valid in the process that started it
+     pid_t reporterPid;
+     atomic<bool> running;
+     
+     Metrics() : reporter(nullptr), reporterPid(0), running(false) {
+         pthread_atfork(
+             [] { Metrics::instance().registryMutex.lock(); },
+             [] { Metrics::instance().registryMutex.unlock(); },
+             [] { Metrics::instance().afterForkChild(); });
+     }
+     
+     // The child starts from zero with no reporter; it calls start() with its role.
+     // Only the forking thread exists in the child, so its localShard is the only
+     // one to reset, and shard() needs no per-call process check.
+     void afterForkChild() {
+         for (auto& shard : shards) {
+             shard.release(); // The parent's shards; the child's copies are simply abandoned
+         }
+         shards.clear();
+         localShard = nullptr;
+         reporter = nullptr;
+         reporterPid = 0;
+         running = false;
+         registryMutex.unlock();
+     }
+     
+     Shard& shard() {
+         if (!localShard) {
+             lock_guard<mutex> lock(registryMutex);
+             shards.emplace_back(new Shard());
+             localShard = shards.back().get();
+         }
+         return *localShard;
+     }
+     
+     static void bump(atomic<uint64_t>& value, uint64_t amount) {
+         value.store(value.load(memory_order_relaxed) + amount, memory_order_relaxed);
+     }
+     
+     static void requestDump(int) {
+         dumpRequested = 1;
+     }
+     
+     static const char* counterName(int counter) {
+         static const char* names[COUNTERS] = {
+             "ticks", "flightsDispatched", "avnsIssued", "avnNotices", "ipcMessages", "paymentsSettled",
+             "runwayABusyTicks", "runwayBBusyTicks", "runwayCBusyTicks", "runwayReplans", "ipcRefused"
+         };
+         return names[counter];
+     }
+     
+     static const char* distributionName(int distribution) {
+         static const char* names[DISTRIBUTIONS] = {
+             "tickNs", "generateFlightsNs", "assignRunwaysNs", "updateFlightsNs", "moveCompletedFlightsNs",
+             "runwayAQueueDepth", "runwayBQueueDepth", "runwayCQueueDepth", "runwayWaitTicks", "runwayDelayTicks",
+             "ipcLatencyUs", "paymentLatencyUs"
+         };
+         return names[distribution];
+     }
+     
+     // Upper bound of the bucket holding the given fraction of the samples, at most the maximum
+     static uint64_t percentile(const uint64_t* buckets, uint64_t count, uint64_t maximum, double fraction) {
+         uint64_t rank = static_cast<uint64_t>(fraction * count);
+         uint64_t seen = 0;
+         for (int b = 0; b < BUCKETS && count > 0; b++) {
+             seen += buckets[b];
+             if (seen > rank) {
+                 return b == 0 ? 0 : min(maximum, (uint64_t(1) << b) - 1);
+             }
+         }
+         return maximum;
+     }
+     
+     void writeJson(ostream& out) {
+         uint64_t counters[COUNTERS] = {};
+         uint64_t buckets[DISTRIBUTIONS][BUCKETS] = {};
+         uint64_t counts[DISTRIBUTIONS] = {}, sums[DISTRIBUTIONS] = {}, maxima[DISTRIBUTIONS] = {};
+         {
+             lock_guard<mutex> lock(registryMutex);
+             for (const auto& shard : shards) {
+                 for (int c = 0; c < COUNTERS; c++) {
+                     counters[c] += shard->counters[c].load(memory_order_relaxed);
+                 }
+                 for (int d = 0; d < DISTRIBUTIONS; d++) {
+                     const Histogram& histogram = shard->histograms[d];
+                     for (int b = 0; b < BUCKETS; b++) {
+                         buckets[d][b] += histogram.buckets[b].load(memory_order_relaxed);
+                     }
+                     counts[d] += histogram.count.load(memory_order_relaxed);
+                     sums[d] += histogram.sum.load(memory_order_relaxed);
+                     maxima[d] = std::max(maxima[d], histogram.max.load(memory_order_relaxed));
+                 }
+             }
+         }
+         
+         double uptime = chrono::duration<double>(chrono::steady_clock::now() - started).count();
+         uint64_t ticks = counters[static_cast<int>(Metric::TICKS)];
+         out << "{\n  \"role\": \"" << role << "\",\n  \"pid\": " << getpid()
+             << ",\n  \"uptimeSeconds\": " << fixed << setprecision(3) << uptime << ",\n  \"counters\": {";
+         for (int c = 0; c < COUNTERS; c++) {
+             out << (c ? ", " : "") << "\"" << counterName(c) << "\": " << counters[c];
+         }
+         out << "},\n  \"avnsIssuedPerSecond\": " << setprecision(3)
+             << (uptime > 0 ? counters[static_cast<int>(Metric::AVNS_ISSUED)] / uptime : 0.0)
+             << ",\n  \"runwayUtilization\": {";
+         const Metric busy[] = {Metric::RUNWAY_A_BUSY_TICKS, Metric::RUNWAY_B_BUSY_TICKS, Metric::RUNWAY_C_BUSY_TICKS};
+         const char* runwayNames[] = {"RWY-A", "RWY-B", "RWY-C"};
+         for (int r = 0; r < 3; r++) {
+             out << (r ? ", " : "") << "\"" << runwayNames[r] << "\": " << setprecision(4)
+                 << (ticks ? static_cast<double>(counters[static_cast<int>(busy[r])]) / ticks : 0.0);
+         }
+         out << "},\n  \"distributions\": {";
+         for (int d = 0; d < DISTRIBUTIONS; d++) {
+             out << (d ? "," : "") << "\n    \"" << distributionName(d) << "\": {\"count\": " << counts[d]
+                 << ", \"mean\": " << setprecision(3) << (counts[d] ? static_cast<double>(sums[d]) / counts[d] : 0.0)
+                 << ", \"p50\": " << percentile(buckets[d], counts[d], maxima[d], 0.50)
+                 << ", \"p99\": " << percentile(buckets[d], counts[d], maxima[d], 0.99)
+                 << ", \"max\": " << maxima[d] << "}";
+         }
+         out << "\n  }\n}\n";
+     }
+     
+     // Write to a temporary name and rename, so a reader never sees half a dump
+     void dump() {
+         string path = directory + "/" + role + "-" + to_string(getpid()) + ".json";
+         string temporary = path + ".tmp";
+         {
+             ofstream file(temporary);
+             if (!file) {
+                 return;
+             }
+             writeJson(file);
+         }
+         rename(temporary.c_str(), path.c_str());
+     }
+     
+     void reporterLoop() {
+         auto nextDump = chrono::steady_clock::now();
+         while (running) {
+             auto now = chrono::steady_clock::now();
+             if (dumpRequested || now >= nextDump) {
+                 dumpRequested = 0;
+                 dump();
+                 nextDump = now + chrono::seconds(1);
+             }
+             this_thread::sleep_for(chrono::milliseconds(100));
+         }
+         dump();
+     }
+     
+ public:
+     static Metrics& instance() {
+         static Metrics metrics;
+         return metrics;
+     }
+     
+     static bool enabled() {
+         return on.load(memory_order_relaxed);
+     }
+     
+     static void add(Metric metric, uint64_t amount = 1) {
+         if (enabled()) {
+             bump(instance().shard().counters[static_cast<int>(metric)], amount);
+         }
+     }
+     
+     static void record(Distribution distribution, uint64_t value) {
+         if (!enabled()) {
+             return;
+         }
+         Histogram& histogram = instance().shard().histograms[static_cast<int>(distribution)];
+         int bucket = value == 0 ? 0 : min(BUCKETS - 1, 64 - __builtin_clzll(value));
+         bump(histogram.buckets[bucket], 1);
+         bump(histogram.count, 1);
+         bump(histogram.sum, value);
+         if (value > histogram.max.load(memory_order_relaxed)) {
+             histogram.max.store(value, memory_order_relaxed);
+         }
+     }
+     
+     // Turn metrics on for this process and every process forked from it
+     void enable(const string& dumpDirectory) {
+         directory = dumpDirectory;
+         on.store(true, memory_order_relaxed);
+         signal(SIGUSR1, &Metrics::requestDump);
+     }
+     
+     // Start this process's reporter under the given role name
+     void start(const string& processRole) {
+         if (!enabled() || running) {
+             return;
+         }
+         role = processRole;
+         started = chrono::steady_clock::now();
+         running = true;
+         reporterPid = getpid();
+         reporter = new thread(&Metrics::reporterLoop, this);
+     }
+     
+     // Write the final dump and stop the reporter; used before a process exits
+     void stop() {
+         if (!running || reporterPid != getpid()) {
+             return;
+         }
+         running = false;
+         reporter->join();
+         delete reporter;
+         reporter = nullptr;
      }
  };
  
- // Departure Flight class
- class DepartureFlight : public Aircraft {
+ atomic<bool> Metrics::on(false);
+ volatile sig_atomic_t Metrics::dumpRequested = 0;
+ thread_local Metrics::Shard* Metrics::localShard = nullptr;
+ 
+ // Steady clock reading as plain nanoseconds; CLOCK_MONOTONIC, so comparable across processes
+ inline uint64_t monotonicNanoseconds() {
+     return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+ }
+ 
+ // -------- IPC TRANSPORT --------
+ 
+ // A one-way byte stream between two processes, created before fork(). After
+ // the fork each process picks its role: useAsWriter(), useAsReader(), or
+ // detach() when it does not take part. Writes never block; reads block up to
+ // a timeout. Framing is layered on top by FrameWriter / FrameReader.
+ class MessageChannel {
+ public:
+     virtual ~MessageChannel() {}
+     
+     virtual void useAsWriter() = 0;
+     virtual void useAsReader() = 0;
+     virtual void detach() = 0;
+     
+     // Writer is done; the reader sees end of stream once it has read everything
+     virtual void closeWriter() = 0;
+     
+     // Nobody will read; further writes fail with EPIPE
+     virtual void closeReader() = 0;
+     
+     // Write as much of parts as fits. Returns bytes written, or -1 with errno
+     // EAGAIN when full and EPIPE when the reader is gone.
+     virtual ssize_t writeSome(const iovec* parts, int count) = 0;
+     
+     // Wait up to timeoutMs for room to write, returns false on timeout
+     virtual bool waitWritable(int timeoutMs) = 0;
+     
+     // Read up to length bytes, waiting up to timeoutMs (-1 = forever). Returns
+     // bytes read, 0 at end of stream, or -1 with errno EAGAIN on timeout.
+     virtual ssize_t readSome(void* buffer, size_t length, int timeoutMs) = 0;
+     
+     // For readers driven by an event loop: an fd that turns readable when data
+     // may have arrived. Call prepareToSleep() before waiting on it; if it
+     // returns false data is already there and the wait should not block.
+     // Call doneSleeping() after the wait.
+     virtual int readinessFd() const = 0;
+     virtual bool prepareToSleep() { return true; }
+     virtual void doneSleeping() {}
+     
+     static unique_ptr<MessageChannel> create(Transport transport);
+ };
+ 
+ // Anonymous pipe; the write end is non-blocking
+ class PipeChannel : public MessageChannel {
  private:
-     DepartureState state;
-     int stateTime; // Time spent in current state
+     int fds[2];
      
-     // State transition times (in simulation seconds)
-     const int TAXI_TIME = 15;
-     const int TAKEOFF_TIME = 10;
-     const int CLIMB_TIME = 20;
+     void closeEnd(int end) {
+         if (fds[end] >= 0) {
+             close(fds[end]);
+             fds[end] = -1;
+         }
+     }
      
  public:
-     DepartureFlight(const string& flightNumber, const string& airline, FlightType type, 
-                     Direction direction, int priority, 
-                     chrono::system_clock::time_point scheduledTime)
-         : Aircraft(flightNumber, airline, type, direction, priority, scheduledTime),
-           state(DepartureState::AT_GATE), stateTime(0) {
+     PipeChannel() {
+         if (pipe(fds) == -1) {
+             throw runtime_error(string("pipe: ") + strerror(errno));
+         }
+         fcntl(fds[1], F_SETFL, fcntl(fds[1], F_GETFL) | O_NONBLOCK);
+     }
+     
+     ~PipeChannel() {
+         closeEnd(0);
+         closeEnd(1);
+     }
+     
+     void useAsWriter() override { closeEnd(0); }
+     void useAsReader() override { closeEnd(1); }
+     void detach() override { closeEnd(0); closeEnd(1); }
+     void closeWriter() override { closeEnd(1); }
+     void closeReader() override { closeEnd(0); }
+     
+     ssize_t writeSome(const iovec* parts, int count) override {
+         if (fds[1] < 0) {
+             errno = EPIPE;
+             return -1;
+         }
+         ssize_t written;
+         do {
+             written = writev(fds[1], parts, count);
+         } while (written < 0 && errno == EINTR);
+         return written;
+     }
+     
+     int readinessFd() const override {
+         return fds[0];
+     }
+     
+     bool waitWritable(int timeoutMs) override {
+         pollfd target = {fds[1], POLLOUT, 0};
+         return poll(&target, 1, timeoutMs) > 0;
+     }
+     
+     ssize_t readSome(void* buffer, size_t length, int timeoutMs) override {
+         pollfd target = {fds[0], POLLIN, 0};
+         int ready;
+         do {
+             ready = poll(&target, 1, timeoutMs);
+         } while (ready < 0 && errno == EINTR);
+         if (ready == 0) {
+             errno = EAGAIN;
+             return -1;
+         }
          
-         // Initial speed at gate is 0
-         currentSpeed = 0;
+         ssize_t bytesRead;
+         do {
+             bytesRead = read(fds[0], buffer, length);
+         } while (bytesRead < 0 && errno == EINTR);
+         return bytesRead;
      }
+ };
+ 
+ // Single-producer / single-consumer byte ring in a shared memory mapping.
+ // Data never goes through the kernel; an eventfd wakes the other side, and
+ // only when it has said it is about to sleep, so a busy stream costs no
+ // syscalls at all.
+ class SharedMemoryChannel : public MessageChannel {
+ private:
+     static constexpr size_t CAPACITY = 256 * 1024;
      
-     DepartureState getState() const {
-         return state;
+     // Lives in the mapping; head and tail on separate cache lines
+     struct Control {
+         alignas(64) atomic<uint64_t> head; // Bytes ever written
+         alignas(64) atomic<uint64_t> tail; // Bytes ever read
+         alignas(64) atomic<uint32_t> readerWaiting;
+         atomic<uint32_t> writerWaiting;
+         atomic<uint32_t> writerClosed;
+         atomic<uint32_t> readerClosed;
+         atomic<pid_t> writerPid;
+         atomic<pid_t> readerPid;
+     };
+     
+     static_assert(atomic<uint64_t>::is_always_lock_free, "ring counters must be lock-free to be shared across processes");
+     
+     Control* control;
+     char* data;
+     int dataReady;  // eventfd, signalled by the writer
+     int spaceReady; // eventfd, signalled by the reader
+     static int nextRegion;
+     
+     static void signal(int eventFd) {
+         uint64_t one = 1;
+         ssize_t ignored = write(eventFd, &one, sizeof(one));
+         (void)ignored;
      }
      
-     string getStateString() const override {
-         switch (state) {
-             case DepartureState::AT_GATE: return "At Gate";
-             case DepartureState::TAXI: return "Taxi";
-             case DepartureState::TAKEOFF_ROLL: return "Takeoff Roll";
-             case DepartureState::CLIMB: return "Climb";
-             case DepartureState::CRUISE: return "Cruise";
-             default: return "Unknown";
+     // Wait on an eventfd; returns false on timeout
+     static bool waitFor(int eventFd, int timeoutMs) {
+         pollfd target = {eventFd, POLLIN, 0};
+         if (poll(&target, 1, timeoutMs) <= 0) {
+             return false;
          }
+         uint64_t count;
+         ssize_t ignored = read(eventFd, &count, sizeof(count));
+         (void)ignored;
+         return true;
      }
      
-     // For DepartureFlight::updateStatus (around line 766)
-
-void updateStatus(int simulationTime) override {
-    stateTime++;
-    
-    // Store previous state to detect state transitions
-    DepartureState previousState = state;
-    
-    // Update speed and state based on current state and time spent in that state
-    switch (state) {
-        case DepartureState::AT_GATE:
-            if (assignedRunway != Runway::NONE) {
-                state = DepartureState::TAXI;
-                stateTime = 0;
-                // Reset violation settings when changing state
-                maintainViolationSpeed = false;
-                
-                if (!maintainViolationSpeed) {
-                    uniform_int_distribution<> taxiDist(TAXI_MIN_SPEED, TAXI_MAX_SPEED);
-                    currentSpeed = taxiDist(gen);
-                }
-            } else {
-                currentSpeed = 0;
-            }
-            break;
-            
-        case DepartureState::TAXI:
-            if (stateTime >= TAXI_TIME) {
-                state = DepartureState::TAKEOFF_ROLL;
-                stateTime = 0;
-                // Reset violation settings when changing state
-                maintainViolationSpeed = false;
-                
-                if (!maintainViolationSpeed) {
-                    currentSpeed = 0; // Start from standstill
-                }
-            }
-            break;
-            
-        case DepartureState::TAKEOFF_ROLL:
-            if (!maintainViolationSpeed) {
-                // Gradually increase speed during takeoff roll
-                currentSpeed = min(TAKEOFF_MAX_SPEED, 
-                                 (TAKEOFF_MAX_SPEED * stateTime) / TAKEOFF_TIME);
-            }
-            
-            if (stateTime >= TAKEOFF_TIME) {
-                state = DepartureState::CLIMB;
-                stateTime = 0;
-                // Reset violation settings when changing state
-                maintainViolationSpeed = false;
-                
-                if (!maintainViolationSpeed) {
-                    uniform_int_distribution<> climbDist(CLIMB_MIN_SPEED, CLIMB_MAX_SPEED);
-                    currentSpeed = climbDist(gen);
-                }
-            }
-            break;
-            
-        case DepartureState::CLIMB:
-            if (stateTime >= CLIMB_TIME) {
-                state = DepartureState::CRUISE;
-                stateTime = 0;
-                // Reset violation settings when changing state
-                maintainViolationSpeed = false;
-                
-                if (!maintainViolationSpeed) {
-                    uniform_int_distribution<> cruiseDist(CRUISE_MIN_SPEED, CRUISE_MAX_SPEED);
-                    currentSpeed = cruiseDist(gen);
-                }
-            }
-            break;
-            
-        case DepartureState::CRUISE:
-            // Maintain cruise speed
-            break;
-    }
-    
-    // If state has changed, clear violation speed
-    if (previousState != state) {
-        maintainViolationSpeed = false;
-    }
-    
-    // Randomly introduce speed violations with a configurable probability
-    if (!hasActiveViolation && !isEmergency && !maintainViolationSpeed) {  // Don't give violations to emergency flights
-        uniform_int_distribution<> violationChanceDist(1, 100);
-        
-        // Only proceed with violation logic if the random check passes
-        // Make this a lower probability to ensure fewer aircraft get violations
-        if (violationChanceDist(gen) <= VIOLATION_PROBABILITY / 3) {
-            uniform_int_distribution<> violationDist(1, 100);
-            if (violationDist(gen) <= VIOLATION_PROBABILITY) {
-                // Determine excess speed based on current state
-                int excessSpeed = 0;
-                uniform_int_distribution<> excessDist(5, MAX_VIOLATION_SPEED_EXCESS);
-                
-                switch (state) {
-                    case DepartureState::TAXI:
-                        excessSpeed = excessDist(gen) / 2; // Less excess for taxi speeds
-                        currentSpeed = TAXI_MAX_SPEED + excessSpeed;
-                        maintainViolationSpeed = true;
-                        violationSpeed = currentSpeed;
-                        break;
-                        
-                    case DepartureState::TAKEOFF_ROLL:
-                        if (stateTime > TAKEOFF_TIME / 2) {
-                            // Only exceed speed when we're supposed to be at a moderate speed
-                            excessSpeed = excessDist(gen);
-                            currentSpeed = TAKEOFF_MAX_SPEED + excessSpeed;
-                            maintainViolationSpeed = true;
-                            violationSpeed = currentSpeed;
-                        }
-                        break;
-                        
-                    case DepartureState::CLIMB:
-                        excessSpeed = excessDist(gen);
-                        currentSpeed = CLIMB_MAX_SPEED + excessSpeed;
-                        maintainViolationSpeed = true;
-                        violationSpeed = currentSpeed;
-                        break;
-                        
-                    case DepartureState::CRUISE:
-                        // Either too slow or too fast
-                        if (violationDist(gen) > 50) {
-                            excessSpeed = excessDist(gen);
-                            currentSpeed = CRUISE_MAX_SPEED + excessSpeed;
-                        } else {
-                            excessSpeed = excessDist(gen);
-                            currentSpeed = CRUISE_MIN_SPEED - excessSpeed;
-                        }
-                        maintainViolationSpeed = true;
-                        violationSpeed = currentSpeed;
-                        break;
-                        
-                    default:
-                        break;
-                }
-            }
-        }
-    } else if (maintainViolationSpeed) {
-        // Maintain the violation speed until state changes
-        currentSpeed = violationSpeed;
-    }
-    
-    // Check for violations
-    checkViolation();
-}
+     static bool processGone(pid_t pid) {
+         return pid > 0 && kill(pid, 0) == -1 && errno == ESRCH;
+     }
      
-     // Modify the checkViolation method in DepartureFlight class (around line 853)
-
-void checkViolation() override {
-    // Get current state as a string
-    string currentStateStr = getStateString();
-    
-    // Skip violation check if we already had a violation in this state
-    if (violatedStates.find(currentStateStr) != violatedStates.end()) {
-        return;
-    }
-    
-    bool violation = false;
-    int minSpeed = 0, maxSpeed = 0;
-    
-    switch (state) {
-        case DepartureState::AT_GATE:
-            if (currentSpeed > GATE_MAX_SPEED) {
-                violation = true;
-                minSpeed = 0;
-                maxSpeed = GATE_MAX_SPEED;
-            }
-            break;
-            
-        case DepartureState::TAXI:
-            if (currentSpeed > TAXI_MAX_SPEED) {
-                violation = true;
-                minSpeed = TAXI_MIN_SPEED;
-                maxSpeed = TAXI_MAX_SPEED;
-            }
-            break;
-            
-        case DepartureState::TAKEOFF_ROLL:
-            if (currentSpeed > TAKEOFF_MAX_SPEED) {
-                violation = true;
-                minSpeed = 0;
-                maxSpeed = TAKEOFF_MAX_SPEED;
-            }
-            break;
-            
-        case DepartureState::CLIMB:
-            if (currentSpeed > CLIMB_MAX_SPEED) {
-                violation = true;
-                minSpeed = CLIMB_MIN_SPEED;
-                maxSpeed = CLIMB_MAX_SPEED;
-            }
-            break;
-            
-        case DepartureState::CRUISE:
-            if (currentSpeed < CRUISE_MIN_SPEED || currentSpeed > CRUISE_MAX_SPEED) {
-                violation = true;
-                minSpeed = CRUISE_MIN_SPEED;
-                maxSpeed = CRUISE_MAX_SPEED;
-            }
-            break;
-    }
-    
-    // If there's a violation
-    if (violation) {
-        hasActiveViolation = true;
-        
-        // Create new AVN
-        static int avnIdCounter = 1000;
-        currentViolation = make_shared<AVN>(
-            avnIdCounter++, airline, flightNumber, type,
-            currentSpeed, minSpeed, maxSpeed
-        );
-        
-        // Add this state to the set of states that have had violations
-        violatedStates.insert(currentStateStr);
-        
-        lock_guard<mutex> lock(cout_mutex);
-        cout << "\nVIOLATION DETECTED! Flight " << flightNumber 
-             << " (" << airline << ") - Speed: " << currentSpeed 
-             << " km/h in " << getStateString() << " state.\n";
-    }
-}
+     void unmap() {
+         if (control) {
+             munmap(control, sizeof(Control) + CAPACITY);
+             control = nullptr;
+             data = nullptr;
+         }
+     }
+     
+ public:
+     SharedMemoryChannel() : control(nullptr), data(nullptr), dataReady(-1), spaceReady(-1) {
+         // Named only long enough to map it; unlinked right away so nothing is left behind
+         string name = "/aircontrolx-" + to_string(getpid()) + "-" + to_string(nextRegion++);
+         int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+         if (fd == -1) {
+             throw runtime_error("shm_open " + name + ": " + strerror(errno));
+         }
+         shm_unlink(name.c_str());
+         
+         size_t size = sizeof(Control) + CAPACITY;
+         if (ftruncate(fd, size) == -1) {
+             close(fd);
+             throw runtime_error(string("ftruncate: ") + strerror(errno));
+         }
+         void* region = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+         close(fd);
+         if (region == MAP_FAILED) {
+             throw runtime_error(string("mmap: ") + strerror(errno));
+         }
+         
+         control = new (region) Control();
+         data = static_cast<char*>(region) + sizeof(Control);
+         dataReady = eventfd(0, EFD_NONBLOCK);
+         spaceReady = eventfd(0, EFD_NONBLOCK);
+         if (dataReady == -1 || spaceReady == -1) {
+             throw runtime_error(string("eventfd: ") + strerror(errno));
+         }
+     }
+     
+     ~SharedMemoryChannel() {
+         if (control && control->readerPid == getpid()) {
+             control->readerClosed = 1;
+         }
+         if (control && control->writerPid == getpid()) {
+             closeWriter();
+         }
+         unmap();
+         if (dataReady >= 0) {
+             close(dataReady);
+         }
+         if (spaceReady >= 0) {
+             close(spaceReady);
+         }
+     }
+     
+     void useAsWriter() override {
+         control->writerPid = getpid();
+     }
+     
+     void useAsReader() override {
+         control->readerPid = getpid();
+     }
+     
+     void detach() override {
+         unmap();
+     }
+     
+     void closeWriter() override {
+         if (control && !control->writerClosed.exchange(1)) {
+             signal(dataReady);
+         }
+     }
+     
+     void closeReader() override {
+         if (control) {
+             control->readerClosed = 1;
+         }
+     }
+     
+     ssize_t writeSome(const iovec* parts, int count) override {
+         if (!control || control->readerClosed) {
+             errno = EPIPE;
+             return -1;
+         }
+         
+         uint64_t head = control->head.load(memory_order_relaxed);
+         size_t space = CAPACITY - (head - control->tail.load(memory_order_acquire));
+         if (space == 0) {
+             errno = processGone(control->readerPid) ? EPIPE : EAGAIN;
+             return -1;
+         }
+         
+         size_t written = 0;
+         for (int i = 0; i < count && written < space; i++) {
+             const char* source = static_cast<const char*>(parts[i].iov_base);
+             size_t length = min(parts[i].iov_len, space - written);
+             
+             // Copy in at most two pieces around the end of the ring
+             size_t offset = (head + written) % CAPACITY;
+             size_t first = min(length, CAPACITY - offset);
+             memcpy(data + offset, source, first);
+             memcpy(data, source + first, length - first);
+             written += length;
+         }
+         
+         control->head.store(head + written);
+         if (control->readerWaiting.load()) {
+             signal(dataReady);
+         }
+         return written;
+     }
+     
+     int readinessFd() const override {
+         return dataReady;
+     }
+     
+     bool prepareToSleep() override {
+         control->readerWaiting.store(1);
+         return control->head.load() == control->tail.load() && !control->writerClosed;
+     }
+     
+     void doneSleeping() override {
+         control->readerWaiting.store(0);
+         uint64_t count;
+         ssize_t ignored = read(dataReady, &count, sizeof(count)); // Reset the eventfd
+         (void)ignored;
+     }
+     
+     bool waitWritable(int timeoutMs) override {
+         control->writerWaiting.store(1);
+         bool ready = control->head.load() - control->tail.load() < CAPACITY || waitFor(spaceReady, timeoutMs);
+         control->writerWaiting.store(0);
+         return ready;
+     }
+     
+     ssize_t readSome(void* buffer, size_t length, int timeoutMs) override {
+         auto deadline = chrono::steady_clock::now() + chrono::milliseconds(timeoutMs);
+         uint64_t tail = control->tail.load(memory_order_relaxed);
+         
+         while (true) {
+             uint64_t head = control->head.load(memory_order_acquire);
+             if (head != tail) {
+                 size_t available = min<uint64_t>(head - tail, length);
+                 size_t offset = tail % CAPACITY;
+                 size_t first = min(available, CAPACITY - offset);
+                 memcpy(buffer, data + offset, first);
+                 memcpy(static_cast<char*>(buffer) + first, data, available - first);
+                 
+                 control->tail.store(tail + available);
+                 if (control->writerWaiting.load()) {
+                     signal(spaceReady);
+                 }
+                 return available;
+             }
+             if (control->writerClosed || processGone(control->writerPid)) {
+                 return 0;
+             }
+             
+             // Announce the sleep, then look again so a write in between is not missed
+             int waitMs = 100; // Wake up now and then to notice a writer that died
+             if (timeoutMs >= 0) {
+                 auto left = chrono::duration_cast<chrono::milliseconds>(deadline - chrono::steady_clock::now()).count();
+                 if (left <= 0) {
+                     errno = EAGAIN;
+                     return -1;
+                 }
+                 waitMs = min<long long>(waitMs, left);
+             }
+             control->readerWaiting.store(1);
+             if (control->head.load() == tail && !control->writerClosed) {
+                 waitFor(dataReady, waitMs);
+             }
+             control->readerWaiting.store(0);
+         }
+     }
+ };
+ 
+ int SharedMemoryChannel::nextRegion = 0;
+ 
+ unique_ptr<MessageChannel> MessageChannel::create(Transport transport) {
+     if (transport == Transport::SHARED_MEMORY) {
+         return unique_ptr<MessageChannel>(new SharedMemoryChannel());
+     }
+     return unique_ptr<MessageChannel>(new PipeChannel());
+ }
+ 
+ // -------- IPC FRAMING --------
+ 
+ // Everything on a channel travels as frames: a header followed by
+ // payloadBytes of payload. The reader reassembles frames across reads, so a
+ // record is never seen half-written.
+ //   MESSAGES: count IPCMessage records
+ enum class FrameKind : uint16_t { MESSAGES = 1 };
+ 
+ struct FrameHeader {
+     uint32_t magic;
+     uint16_t version;
+     FrameKind kind;
+     uint32_t count;        // Records in the frame
+     uint32_t payloadBytes; // Bytes following the header
+     uint64_t openedAtNs;   // Writer's monotonic clock when the frame was started, 0 with metrics off
+ };
+ 
+ const uint32_t FRAME_MAGIC = 0x41435846; // "ACXF"
+ const uint16_t FRAME_VERSION = 3;
+ 
+ // One AVN as plain data, as the shared table, its listings and the journal keep it
+ struct AVNRecord {
+     int32_t id;
+     int32_t recordedSpeed;
+     int32_t permissibleSpeedMin;
+     int32_t permissibleSpeedMax;
+     int64_t issueTime;
+     int64_t dueDate;
+     double totalAmount;
+     uint8_t aircraftType; // FlightType
+     uint8_t status;       // PaymentStatus
+     char flightNumber[16];
+ };
+ 
+ // Totals of an airline's listing
+ struct AVNListingHeader {
+     char airline[32];
+     uint32_t totalCount;  // AVNs in the whole listing
+     uint32_t unpaidCount;
+     double outstanding;   // Sum owed over unpaid AVNs
+ };
+ 
+ // Records per MESSAGES frame, so a whole frame fits in one atomic pipe write
+ const size_t FRAME_MAX_RECORDS = (PIPE_BUF - sizeof(FrameHeader)) / sizeof(IPCMessage);
+ 
+ // Unsent bytes a REFUSE writer keeps when the reader falls behind before turning new frames away
+ const size_t FRAME_BACKLOG_LIMIT = 1 << 20;
+ 
+ // Writing end of a framed channel. Frames are encoded as they are queued and
+ // everything is sent with one write in flush(). Whatever does not fit stays
+ // queued and is retried first on the next flush, so the caller never waits.
+ class FrameWriter {
+ public:
+     // What a slow reader costs. GROW keeps everything queued, for replies,
+     // confirmations and handoffs that must arrive. REFUSE turns frames away
+     // past FRAME_BACKLOG_LIMIT, for the tick path and requests a user can retry;
+     // queue() then returns false and the refusal is counted.
+     enum Overflow { GROW, REFUSE };
+     
+ private:
+     MessageChannel* channel;
+     Overflow overflow;
+     string outgoing;  // Encoded frames not yet accepted by the channel
+     size_t openFrame; // Offset of the MESSAGES frame still taking records, or npos
+     bool warnedFull;
+     
+     bool hasRoom(size_t bytes) {
+         if (overflow == GROW || outgoing.size() + bytes <= FRAME_BACKLOG_LIMIT) {
+             warnedFull = false;
+             return true;
+         }
+         if (!warnedFull) {
+             LogLine(LogLevel::WARN) << "IPC backlog full, refusing messages until the reader catches up";
+             warnedFull = true;
+         }
+         Metrics::add(Metric::IPC_REFUSED);
+         return false;
+     }
+     
+     void appendHeader(FrameKind kind, uint32_t count, uint32_t payloadBytes) {
+         FrameHeader header = {FRAME_MAGIC, FRAME_VERSION, kind, count, payloadBytes,
+                               Metrics::enabled() ? monotonicNanoseconds() : 0};
+         outgoing.append(reinterpret_cast<const char*>(&header), sizeof(header));
+     }
+     
+ public:
+     explicit FrameWriter(MessageChannel* target, Overflow whenFull = GROW)
+         : channel(target), overflow(whenFull), openFrame(string::npos), warnedFull(false) {}
+     
+     // False if the backlog was full and the message was not queued
+     bool queue(const IPCMessage& message) {
+         if (!hasRoom(sizeof(FrameHeader) + sizeof(message))) {
+             return false;
+         }
+         
+         // Append to the open frame, or start a new one when it is full
+         FrameHeader header;
+         if (openFrame != string::npos) {
+             memcpy(&header, &outgoing[openFrame], sizeof(header));
+         }
+         if (openFrame == string::npos || header.count == FRAME_MAX_RECORDS) {
+             openFrame = outgoing.size();
+             appendHeader(FrameKind::MESSAGES, 0, 0);
+             memcpy(&header, &outgoing[openFrame], sizeof(header));
+         }
+         header.count++;
+         header.payloadBytes += sizeof(message);
+         memcpy(&outgoing[openFrame], &header, sizeof(header));
+         outgoing.append(reinterpret_cast<const char*>(&message), sizeof(message));
+         return true;
+     }
+     
+     bool idle() const {
+         return outgoing.empty();
+     }
+     
+     // Send everything queued, never blocks
+     void flush() {
+         openFrame = string::npos;
+         if (!channel || idle()) {
+             return;
+         }
+         
+         iovec part = {&outgoing[0], outgoing.size()};
+         ssize_t written = channel->writeSome(&part, 1);
+         if (written < 0) {
+             if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                 return;
+             }
+             // Reader gone; nothing queued from here on can be delivered
+             outgoing.clear();
+             return;
+         }
+         outgoing.erase(0, written);
+     }
+     
+     // Wait up to timeoutMs for everything queued to be sent, used before closing the channel
+     void drain(int timeoutMs) {
+         auto deadline = chrono::steady_clock::now() + chrono::milliseconds(timeoutMs);
+         flush();
+         while (channel && !idle() && chrono::steady_clock::now() < deadline) {
+             channel->waitWritable(10);
+             flush();
+         }
+     }
+     
+     // Queue, flush, and give a slow reader up to timeoutMs; for one-off replies
+     void send(const IPCMessage& message, int timeoutMs = 1000) {
+         queue(message);
+         drain(timeoutMs);
+     }
+ };
+ 
+ // Reading end of a framed channel. Each read takes as many bytes as are
+ // available and returns the records of every complete frame in them.
+ class FrameReader {
+ private:
+     MessageChannel* channel;
+     string buffer;
+     bool closed;
+     
+     static bool validPayload(const FrameHeader& header) {
+         switch (header.kind) {
+             case FrameKind::MESSAGES:
+                 return header.payloadBytes == header.count * sizeof(IPCMessage);
+             default:
+                 return false;
+         }
+     }
+     
+ public:
+     explicit FrameReader(MessageChannel* source) : channel(source), closed(false) {}
+     
+     bool isClosed() const {
+         return closed;
+     }
+     
+     // Wait up to timeoutMs (-1 = forever) for the next batch and append its
+     // messages to messages. Returns false on timeout, or once the channel is
+     // closed or a corrupt frame is seen (isClosed() tells which).
+     bool read(vector<IPCMessage>& messages, int timeoutMs = -1) {
+         char chunk[16 * 1024];
+         
+         while (!closed) {
+             ssize_t bytesRead = channel->readSome(chunk, sizeof(chunk), timeoutMs);
+             if (bytesRead < 0 && errno == EAGAIN) {
+                 return false;
+             }
+             if (bytesRead <= 0) {
+                 closed = true;
+                 return false;
+             }
+             buffer.append(chunk, bytesRead);
+             
+             size_t offset = 0;
+             size_t frames = 0;
+             while (buffer.size() - offset >= sizeof(FrameHeader)) {
+                 FrameHeader header;
+                 memcpy(&header, buffer.data() + offset, sizeof(header));
+                 if (header.magic != FRAME_MAGIC || header.version != FRAME_VERSION || !validPayload(header)) {
+                     LogLine(LogLevel::ERROR) << "Corrupt IPC frame, closing the channel";
+                     closed = true;
+                     return false;
+                 }
+                 if (buffer.size() - offset < sizeof(FrameHeader) + header.payloadBytes) {
+                     break; // Rest of the frame has not arrived yet
+                 }
+                 
+                 if (header.openedAtNs != 0) {
+                     uint64_t now = monotonicNanoseconds();
+                     Metrics::record(Distribution::IPC_LATENCY_US, now > header.openedAtNs ? (now - header.openedAtNs) / 1000 : 0);
+                     Metrics::add(Metric::IPC_MESSAGES, header.count);
+                 }
+                 
+                 size_t first = messages.size();
+                 messages.resize(first + header.count);
+                 memcpy(&messages[first], buffer.data() + offset + sizeof(FrameHeader), header.payloadBytes);
+                 offset += sizeof(FrameHeader) + header.payloadBytes;
+                 frames++;
+             }
+             buffer.erase(0, offset);
+             
+             if (frames > 0) {
+                 return true;
+             }
+         }
+         return false;
+     }
+ };
+ 
+ // Single-threaded readiness loop over epoll: each watched fd has a handler
+ // that runs when the fd turns readable
+ class EventLoop {
+ private:
+     int epollFd;
+     map<int, function<void()>> handlers;
+     
+ public:
+     EventLoop() : epollFd(epoll_create1(EPOLL_CLOEXEC)) {
+         if (epollFd == -1) {
+             throw runtime_error(string("epoll_create1: ") + strerror(errno));
+         }
+     }
+     
+     ~EventLoop() {
+         close(epollFd);
+     }
+     
+     void watch(int fd, function<void()> onReadable) {
+         epoll_event event;
+         memset(&event, 0, sizeof(event));
+         event.events = EPOLLIN;
+         event.data.fd = fd;
+         epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event);
+         handlers[fd] = onReadable;
+     }
+     
+     void unwatch(int fd) {
+         epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+         handlers.erase(fd);
+     }
+     
+     // Wait up to timeoutMs for readiness and run the handlers of every ready fd
+     void runOnce(int timeoutMs) {
+         epoll_event events[16];
+         int ready = epoll_wait(epollFd, events, 16, timeoutMs);
+         for (int i = 0; i < ready; i++) {
+             auto it = handlers.find(events[i].data.fd);
+             if (it != handlers.end()) {
+                 function<void()> handler = it->second; // The handler may unwatch its own fd
+                 handler();
+             }
+         }
+     }
+ };
+ 
+ // -------- SHARED AVN TABLE --------
+ 
+ // One table of every AVN, in a memfd mapped MAP_SHARED before the forks so the
+ // ATC Controller, the AVN Generator and the Airline Portal all read the same
+ // rows instead of keeping private copies in sync through messages. Rows are
+ // appended only by the controller, in ascending id order, and made visible by
+ // bumping count. A sharded run splits the rows into one segment per airport,
+ // each appended by that airport's controller alone. Segments grow a chunk of
+ // rows at a time at the end of the file; each process maps a chunk the first
+ // time it touches it. After that only a row's status changes; each row carries
+ // a sequence lock (odd while being written), so readers copy it without taking
+ // a lock and retry if a writer got in between.
+ //
+ // Every airline also has a chain through its rows and running totals, so a
+ // listing touches that airline's rows alone. Writers to an airline take turns
+ // on its lock; listings take no lock.
+ //
+ // The controller keeps its own AVN objects for deadlines, analytics and the
+ // journal, but a row's payment status here is the authoritative one: PAID is
+ // final, and the controller takes in payments recorded by other processes.
+ class SharedAVNTable {
+ public:
+     // A consistent copy of one row
+     struct Entry {
+         AVNRecord record;
+         char airline[32];
+     };
+     
+ private:
+     struct Slot {
+         atomic<uint32_t> sequence;
+         uint32_t airlineId;     // Index into Header::airlines, fixed at publish
+         uint32_t nextInAirline; // Handle of the airline's next row, set when that row is published
+         uint32_t claimed;       // A payment waits for the controller to record it, see claimPayment
+         double claimedAmount;
+         Entry entry;
+     };
+     
+     // An airline's rows in publish order with their totals, changed only under
+     // lock. The chain only grows: count is stored after the new row is linked,
+     // so readers walk the first count rows unlocked. Count and the totals carry
+     // their own sequence lock, read like a row's, so they always agree.
+     struct AirlineIndex {
+         atomic<uint32_t> lock; // Pid of the holder, 0 when free
+         uint32_t head;      // Handle of the first row
+         uint32_t tail;      // Handle of the last row
+         atomic<uint32_t> count;
+         atomic<uint32_t> totalsSequence;
+         uint32_t unpaid;
+         double outstanding; // Sum owed over unpaid rows
+     };
+     
+     struct Header {
+         atomic<uint32_t> counts[MAX_AIRPORTS]; // Rows visible to readers, per segment
+         atomic<uint32_t> chunkCount;           // Chunks allocated in the file, over all segments
+         uint32_t chunks[MAX_AIRPORTS][SHARED_AVN_MAX_CHUNKS]; // File chunk of each segment chunk
+         atomic<uint32_t> airlineCount;         // Names in airlines, appended by the controllers
+         atomic<uint32_t> airlineLock;          // Pid of the process appending a name, 0 when free
+         atomic<uint32_t> payments;             // Rows turned PAID so far, in any process
+         atomic<uint32_t> paymentsDeferred;     // Set while the controller journals payments
+         atomic<uint32_t> claims;               // Payments claimed so far, see claimPayment
+         char airlines[SHARED_AIRLINE_CAPACITY][32];
+         AirlineIndex index[SHARED_AIRLINE_CAPACITY];
+     };
+     
+     static const uint32_t FILE_CHUNKS = MAX_AIRPORTS * SHARED_AVN_MAX_CHUNKS;
+     
+     int fd;
+     Header* header;
+     size_t headerBytes;
+     size_t chunkBytes;
+     int segments;
+     int ownSegment; // Where this process appends
+     
+     // Chunks this process has mapped, by file chunk. Inherited over fork with the mappings.
+     unique_ptr<atomic<Slot*>[]> mapped;
+     mutable mutex mapMutex;
+     
+     static size_t pageRound(size_t bytes) {
+         size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+         return (bytes + page - 1) / page * page;
+     }
+     
+     // Waits on a row or lock held in another process: spin a little, then give
+     // up the CPU, then sleep, since the holder may not be running
+     static void backoff(unsigned& spins) {
+         spins++;
+         if (spins < 64) {
+             return;
+         }
+         if (spins < 1024) {
+             sched_yield();
+             return;
+         }
+         this_thread::sleep_for(chrono::microseconds(100));
+     }
+     
+     // The locks are shared between processes and hold the holder's pid. A
+     // waiter that finds the holder gone takes the lock over and returns true;
+     // the caller then repairs whatever the holder left half changed.
+     static bool lock(atomic<uint32_t>& word) {
+         uint32_t self = static_cast<uint32_t>(getpid());
+         unsigned spins = 0;
+         while (true) {
+             uint32_t holder = 0;
+             if (word.compare_exchange_weak(holder, self, memory_order_acquire)) {
+                 return false;
+             }
+             if (holder != 0 && spins % 256 == 255 && kill(static_cast<pid_t>(holder), 0) != 0 && errno == ESRCH &&
+                 word.compare_exchange_strong(holder, self, memory_order_acquire)) {
+                 LogLine(LogLevel::WARN) << "Shared AVN table lock taken over from exited process " << holder;
+                 return true;
+             }
+             backoff(spins);
+         }
+     }
+     
+     static void unlock(atomic<uint32_t>& word) {
+         word.store(0, memory_order_release);
+     }
+     
+     // Unpaid rows count toward an airline's totals
+     static bool owing(const AVNRecord& record) {
+         return static_cast<PaymentStatus>(record.status) != PaymentStatus::PAID;
+     }
+     
+     // Add (sign 1) or take away (sign -1) one row's share of its airline's totals.
+     // Callers hold the index lock and bracket the changes with beginTotals/endTotals.
+     static void countTotals(AirlineIndex& index, const AVNRecord& record, int sign) {
+         if (owing(record)) {
+             index.unpaid += sign;
+             index.outstanding += sign * record.totalAmount;
+         }
+     }
+     
+     static void beginTotals(AirlineIndex& index) {
+         index.totalsSequence.store(index.totalsSequence.load(memory_order_relaxed) + 1, memory_order_relaxed);
+         atomic_thread_fence(memory_order_release);
+     }
+     
+     // Lock an airline's index, repairing it if the last holder exited mid-change
+     void lockIndex(AirlineIndex& index) const {
+         if (lock(index.lock)) {
+             repair(index);
+         }
+     }
+     
+     // Make an index whose writer exited under its lock consistent again: drop
+     // a row it linked but never counted, finish the row changes it left
+     // open, and count the totals afresh from the rows
+     void repair(AirlineIndex& index) const {
+         uint32_t count = index.count.load(memory_order_relaxed);
+         uint32_t unpaid = 0;
+         double outstanding = 0.0;
+         uint32_t handle = index.head;
+         for (uint32_t row = 0; row < count; row++) {
+             Slot* slot = slotAt(handle);
+             if (!slot) {
+                 break;
+             }
+             uint32_t sequence = slot->sequence.load(memory_order_relaxed);
+             if (sequence & 1) {
+                 slot->sequence.store(sequence + 1, memory_order_release);
+             }
+             if (owing(slot->entry.record)) {
+                 unpaid++;
+                 outstanding += slot->entry.record.totalAmount;
+             }
+             index.tail = handle;
+             handle = slot->nextInAirline;
+         }
+         uint32_t sequence = index.totalsSequence.load(memory_order_relaxed) | 1;
+         index.totalsSequence.store(sequence, memory_order_relaxed);
+         atomic_thread_fence(memory_order_release);
+         index.unpaid = unpaid;
+         index.outstanding = outstanding;
+         index.totalsSequence.store(sequence + 1, memory_order_release);
+     }
+     
+     // A reader still finding a change open after a long wait passes through
+     // the lock, which repairs the index if the writer exited
+     void settle(AirlineIndex& index) const {
+         lockIndex(index);
+         unlock(index.lock);
+     }
+     
+     static void endTotals(AirlineIndex& index) {
+         if (index.unpaid == 0) {
+             index.outstanding = 0.0; // Drop rounding left over from the running sum
+         }
+         index.totalsSequence.store(index.totalsSequence.load(memory_order_relaxed) + 1, memory_order_release);
+     }
+     
+     // First row of a file chunk in this process, mapping it if need be; null if mmap fails
+     Slot* chunkAt(uint32_t fileChunk) const {
+         Slot* rows = mapped[fileChunk].load(memory_order_acquire);
+         if (rows) {
+             return rows;
+         }
+         lock_guard<mutex> guard(mapMutex);
+         rows = mapped[fileChunk].load(memory_order_relaxed);
+         if (!rows) {
+             void* region = mmap(nullptr, chunkBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+                                 static_cast<off_t>(headerBytes + chunkBytes * fileChunk));
+             if (region == MAP_FAILED) {
+                 LogLine(LogLevel::WARN) << "Shared AVN table chunk " << fileChunk << " not mapped: " << strerror(errno);
+                 return nullptr;
+             }
+             rows = static_cast<Slot*>(region);
+             mapped[fileChunk].store(rows, memory_order_release);
+         }
+         return rows;
+     }
+     
+     // Rows are named by handle: file chunk * SHARED_AVN_CHUNK_ROWS + offset in the chunk
+     Slot* slotAt(uint32_t handle) const {
+         Slot* rows = chunkAt(handle / SHARED_AVN_CHUNK_ROWS);
+         return rows ? rows + handle % SHARED_AVN_CHUNK_ROWS : nullptr;
+     }
+     
+     uint32_t handleOf(int segment, uint32_t row) const {
+         return header->chunks[segment][row / SHARED_AVN_CHUNK_ROWS] * SHARED_AVN_CHUNK_ROWS + row % SHARED_AVN_CHUNK_ROWS;
+     }
+     
+     // Give this process's segment another chunk at the end of the file. The
+     // chunk is claimed only once it is mapped, so a failed attempt leaves it
+     // for the next; airports racing for it retry with the one after.
+     bool grow(uint32_t segmentChunk) {
+         uint32_t fileChunk = header->chunkCount.load(memory_order_relaxed);
+         do {
+             if (fileChunk >= FILE_CHUNKS) {
+                 return false;
+             }
+             // fallocate only ever extends, so airports growing at once cannot cut each other short
+             if (fallocate(fd, 0, static_cast<off_t>(headerBytes + chunkBytes * fileChunk), static_cast<off_t>(chunkBytes)) != 0) {
+                 LogLine(LogLevel::WARN) << "Shared AVN table cannot grow: " << strerror(errno);
+                 return false;
+             }
+             if (!chunkAt(fileChunk)) {
+                 return false;
+             }
+         } while (!header->chunkCount.compare_exchange_weak(fileChunk, fileChunk + 1, memory_order_relaxed));
+         header->chunks[ownSegment][segmentChunk] = fileChunk;
+         return true;
+     }
+     
+     void readSlot(const Slot& slot, Entry& entry) const {
+         unsigned spins = 0;
+         while (true) {
+             uint32_t before = slot.sequence.load(memory_order_acquire);
+             if (before & 1) {
+                 backoff(spins);
+                 if (spins % 1024 == 0) {
+                     settle(header->index[slot.airlineId]);
+                 }
+                 continue;
+             }
+             memcpy(&entry, &slot.entry, sizeof(entry));
+             atomic_thread_fence(memory_order_acquire);
+             if (slot.sequence.load(memory_order_relaxed) == before) {
+                 return;
+             }
+         }
+     }
+     
+     // Id of an airline name, or -1 if no row has used it yet
+     int airlineIdOf(const char* airline) const {
+         uint32_t names = header->airlineCount.load(memory_order_acquire);
+         for (uint32_t id = 0; id < names; id++) {
+             if (strncmp(header->airlines[id], airline, sizeof(header->airlines[id])) == 0) {
+                 return static_cast<int>(id);
+             }
+         }
+         return -1;
+     }
+     
+     // Id of an airline name, adding it if no row has used it yet; -1 once the names are full
+     int internAirline(const char* airline) {
+         int airlineId = airlineIdOf(airline);
+         if (airlineId >= 0) {
+             return airlineId;
+         }
+         lock(header->airlineLock); // A name is counted only once written, so a takeover needs no repair
+         airlineId = airlineIdOf(airline); // Another airport may have added it meanwhile
+         uint32_t names = header->airlineCount.load(memory_order_relaxed);
+         if (airlineId < 0 && names < static_cast<uint32_t>(SHARED_AIRLINE_CAPACITY)) {
+             memcpy(header->airlines[names], airline, sizeof(header->airlines[names]));
+             header->airlineCount.store(names + 1, memory_order_release);
+             airlineId = names;
+         }
+         unlock(header->airlineLock);
+         return airlineId;
+     }
+     
+     // Row of avnId, or null. Ids are never rewritten, so the search reads them
+     // directly; each segment is in id order on its own.
+     Slot* slotOf(int avnId) const {
+         for (int segment = 0; segment < segments; segment++) {
+             int low = 0;
+             int high = static_cast<int>(header->counts[segment].load(memory_order_acquire)) - 1;
+             while (low <= high) {
+                 int middle = low + (high - low) / 2;
+                 Slot* slot = slotAt(handleOf(segment, middle));
+                 if (!slot) {
+                     break;
+                 }
+                 int id = slot->entry.record.id;
+                 if (id == avnId) {
+                     return slot;
+                 }
+                 if (id < avnId) {
+                     low = middle + 1;
+                 } else {
+                     high = middle - 1;
+                 }
+             }
+         }
+         return nullptr;
+     }
+     
+ public:
+     // One segment per airport of a sharded run
+     explicit SharedAVNTable(int airports = 1)
+         : fd(-1), header(nullptr), headerBytes(pageRound(sizeof(Header))),
+           chunkBytes(pageRound(sizeof(Slot) * SHARED_AVN_CHUNK_ROWS)), segments(airports), ownSegment(0),
+           mapped(new atomic<Slot*>[FILE_CHUNKS]) {
+         for (uint32_t chunk = 0; chunk < FILE_CHUNKS; chunk++) {
+             mapped[chunk].store(nullptr, memory_order_relaxed);
+         }
+         // The file starts as just the header; chunks are zero-filled as it grows
+         fd = memfd_create("acx-avn-table", MFD_CLOEXEC);
+         if (fd < 0) {
+             throw runtime_error(string("memfd_create: ") + strerror(errno));
+         }
+         void* region = MAP_FAILED;
+         if (ftruncate(fd, static_cast<off_t>(headerBytes)) == 0) {
+             region = mmap(nullptr, headerBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+         }
+         if (region == MAP_FAILED) {
+             int error = errno;
+             close(fd);
+             throw runtime_error(string("shared AVN table: ") + strerror(error));
+         }
+         header = new (region) Header();
+     }
+     
+     ~SharedAVNTable() {
+         for (uint32_t chunk = 0; chunk < FILE_CHUNKS; chunk++) {
+             if (Slot* rows = mapped[chunk].load(memory_order_relaxed)) {
+                 munmap(rows, chunkBytes);
+             }
+         }
+         if (header) {
+             munmap(header, headerBytes);
+         }
+         if (fd >= 0) {
+             close(fd);
+         }
+     }
+     
+     SharedAVNTable(const SharedAVNTable&) = delete;
+     SharedAVNTable& operator=(const SharedAVNTable&) = delete;
+     
+     uint32_t size() const {
+         uint32_t count = 0;
+         for (int segment = 0; segment < segments; segment++) {
+             count += header->counts[segment].load(memory_order_acquire);
+         }
+         return count;
+     }
+     
+     // Rows this process publishes go to the segment of this airport
+     void appendAs(int airport) {
+         ownSegment = airport;
+     }
+     
+     // Append a row. Only the ATC Controllers call this, each in its own segment.
+     // False leaves the AVN private, which the AVN_CREATED notice covers.
+     bool publish(const AVNRecord& record, const string& airline) {
+         uint32_t row = header->counts[ownSegment].load(memory_order_relaxed);
+         if (row > 0) {
+             Slot* previous = slotAt(handleOf(ownSegment, row - 1));
+             if (!previous) {
+                 return false;
+             }
+             if (previous->entry.record.id >= record.id) {
+                 LogLine(LogLevel::WARN) << "AVN #" << record.id << " out of id order, kept private";
+                 return false;
+             }
+         }
+         
+         char name[32] = {};
+         memcpy(name, airline.data(), min(airline.size(), sizeof(name) - 1));
+         // Listings compare these ids instead of names
+         int airlineId = internAirline(name);
+         if (airlineId < 0) {
+             LogLine(LogLevel::WARN) << "Shared AVN table has no room for airline " << airline << ", AVN #" << record.id << " kept private";
+             return false;
+         }
+         
+         uint32_t segmentChunk = row / SHARED_AVN_CHUNK_ROWS;
+         if (row % SHARED_AVN_CHUNK_ROWS == 0 && (segmentChunk >= static_cast<uint32_t>(SHARED_AVN_MAX_CHUNKS) || !grow(segmentChunk))) {
+             LogLine(LogLevel::WARN) << "Shared AVN table full, AVN #" << record.id << " kept private";
+             return false;
+         }
+         uint32_t handle = handleOf(ownSegment, row);
+         Slot* slot = slotAt(handle);
+         if (!slot) {
+             return false;
+         }
+         slot->entry.record = record;
+         memcpy(slot->entry.airline, name, sizeof(slot->entry.airline));
+         slot->airlineId = airlineId;
+         
+         AirlineIndex& index = header->index[airlineId];
+         lockIndex(index);
+         uint32_t count = index.count.load(memory_order_relaxed);
+         if (count > 0) {
+             Slot* tail = slotAt(index.tail);
+             if (!tail) {
+                 unlock(index.lock); // The row stays unlinked and uncounted
+                 return false;
+             }
+             tail->nextInAirline = handle;
+         } else {
+             index.head = handle;
+         }
+         index.tail = handle;
+         beginTotals(index);
+         countTotals(index, record, 1);
+         index.count.store(count + 1, memory_order_release);
+         endTotals(index);
+         unlock(index.lock);
+         
+         header->counts[ownSegment].store(row + 1, memory_order_release);
+         return true;
+     }
+     
+     // Change a row's status, and its amount when totalAmount is not negative.
+     // Any process may call this; writers to a row take turns on its airline's lock.
+     // PAID is final: false if there is no such row or it is paid already, so
+     // of two payments on a row only the first one gets true.
+     bool setStatus(int avnId, PaymentStatus status, double totalAmount = -1.0) {
+         Slot* slot = slotOf(avnId);
+         if (!slot) {
+             return false;
+         }
+         AirlineIndex& index = header->index[slot->airlineId];
+         lockIndex(index);
+         AVNRecord& record = slot->entry.record;
+         if (!owing(record)) {
+             unlock(index.lock);
+             return false;
+         }
+         if (status == PaymentStatus::PAID) {
+             slot->claimed = 0;
+         }
+         beginTotals(index);
+         countTotals(index, record, -1);
+         
+         uint32_t sequence = slot->sequence.load(memory_order_relaxed);
+         slot->sequence.store(sequence + 1, memory_order_relaxed);
+         atomic_thread_fence(memory_order_release);
+         bool newlyPaid = status == PaymentStatus::PAID;
+         record.status = static_cast<uint8_t>(status);
+         if (totalAmount >= 0) {
+             record.totalAmount = totalAmount;
+         }
+         slot->sequence.store(sequence + 2, memory_order_release);
+         if (newlyPaid) {
+             header->payments.fetch_add(1, memory_order_release);
+         }
+         
+         countTotals(index, record, 1);
+         endTotals(index);
+         unlock(index.lock);
+         return true;
+     }
+     
+     // From now on payments made outside the controller are only claimed until
+     // it has journaled them, so nobody is told PAID before that is durable
+     void deferPayments() {
+         header->paymentsDeferred.store(1, memory_order_release);
+     }
+     
+     enum class Claim { PAID, CLAIMED, ALREADY_PAID, NOT_FOUND };
+     
+     // A payment of amount on avnId from outside the controller. The row turns
+     // PAID at once unless payments are deferred; then it stays as it is,
+     // CLAIMED, until the controller records the payment and sets it PAID. A
+     // payment on a row that is paid or claimed already is ALREADY_PAID.
+     Claim claimPayment(int avnId, double amount) {
+         if (!header->paymentsDeferred.load(memory_order_acquire)) {
+             if (setStatus(avnId, PaymentStatus::PAID)) {
+                 return Claim::PAID;
+             }
+             return paid(avnId) ? Claim::ALREADY_PAID : Claim::NOT_FOUND;
+         }
+         Slot* slot = slotOf(avnId);
+         if (!slot) {
+             return Claim::NOT_FOUND;
+         }
+         AirlineIndex& index = header->index[slot->airlineId];
+         lockIndex(index);
+         if (!owing(slot->entry.record) || slot->claimed) {
+             unlock(index.lock);
+             return Claim::ALREADY_PAID;
+         }
+         slot->claimed = 1;
+         slot->claimedAmount = amount;
+         unlock(index.lock);
+         header->claims.fetch_add(1, memory_order_release);
+         return Claim::CLAIMED;
+     }
+     
+     // Changes whenever a payment is claimed, so the controller can tell when to look again
+     uint32_t claims() const {
+         return header->claims.load(memory_order_acquire);
+     }
+     
+     // The amount of a payment claimed on avnId and not yet recorded
+     bool claimOf(int avnId, double& amount) const {
+         Slot* slot = slotOf(avnId);
+         if (!slot) {
+             return false;
+         }
+         AirlineIndex& index = header->index[slot->airlineId];
+         lockIndex(index);
+         bool claimed = slot->claimed != 0;
+         amount = slot->claimedAmount;
+         unlock(index.lock);
+         return claimed;
+     }
+     
+     // Status as carried in IPC details
+     static const char* statusCode(uint8_t status) {
+         switch (static_cast<PaymentStatus>(status)) {
+             case PaymentStatus::PAID: return "PAID";
+             case PaymentStatus::OVERDUE: return "OVERDUE";
+             default: return "UNPAID";
+         }
+     }
+     
+     bool find(int avnId, Entry& entry) const {
+         Slot* slot = slotOf(avnId);
+         if (!slot) {
+             return false;
+         }
+         readSlot(*slot, entry);
+         return true;
+     }
+     
+     // Changes whenever a row is paid, so a process can tell when to look again
+     uint32_t payments() const {
+         return header->payments.load(memory_order_acquire);
+     }
+     
+     bool paid(int avnId) const {
+         Entry entry;
+         return find(avnId, entry) && !owing(entry.record);
+     }
+     
+     // QUERY_AVN reply for avnId, NOT_FOUND in details when there is no such row
+     IPCMessage describe(int avnId) const {
+         IPCMessage reply;
+         reply.type = MessageType::QUERY_AVN;
+         reply.avnId = avnId;
+         
+         Entry entry;
+         if (!find(avnId, entry)) {
+             strncpy(reply.details, "NOT_FOUND", sizeof(reply.details) - 1);
+             return reply;
+         }
+         memcpy(reply.airline, entry.airline, sizeof(reply.airline));
+         memcpy(reply.flightNumber, entry.record.flightNumber, sizeof(reply.flightNumber));
+         reply.airline[sizeof(reply.airline) - 1] = '\0';
+         reply.flightNumber[sizeof(reply.flightNumber) - 1] = '\0';
+         reply.amount = entry.record.totalAmount;
+         strncpy(reply.details, statusCode(entry.record.status), sizeof(reply.details) - 1);
+         return reply;
+     }
+     
+     // Every row of one airline with its totals, in publish order. Walks the
+     // airline's chain without a lock, so no other airline's rows are read and
+     // no writer is held up. Rows published meanwhile are left for the next listing.
+     void listAirline(const string& airline, AVNListingHeader& summary, vector<AVNRecord>& records) const {
+         memset(&summary, 0, sizeof(summary));
+         memcpy(summary.airline, airline.data(), min(airline.size(), sizeof(summary.airline) - 1));
+         
+         int airlineId = airlineIdOf(summary.airline);
+         if (airlineId < 0) {
+             return;
+         }
+         
+         AirlineIndex& index = header->index[airlineId];
+         unsigned spins = 0;
+         while (true) {
+             uint32_t before = index.totalsSequence.load(memory_order_acquire);
+             if (before & 1) {
+                 backoff(spins);
+                 if (spins % 1024 == 0) {
+                     settle(index);
+                 }
+                 continue;
+             }
+             summary.totalCount = index.count.load(memory_order_acquire);
+             summary.unpaidCount = index.unpaid;
+             summary.outstanding = index.outstanding;
+             atomic_thread_fence(memory_order_acquire);
+             if (index.totalsSequence.load(memory_order_relaxed) == before) {
+                 break;
+             }
+         }
+         uint32_t count = summary.totalCount;
+         
+         records.reserve(records.size() + count);
+         Entry entry;
+         uint32_t handle = index.head;
+         for (uint32_t row = 0; row < count; row++) {
+             const Slot* slot = slotAt(handle);
+             if (!slot) {
+                 break;
+             }
+             readSlot(*slot, entry);
+             records.push_back(entry.record);
+             handle = slot->nextInAirline;
+         }
+     }
+ };
+ 
+ // -------- SHARED RESOURCES --------
+ 
+ // Mutex for console output
+ mutex cout_mutex;
+ 
+ // Mutexes for runway access
+ mutex runway_a_mutex;
+ mutex runway_b_mutex;
+ mutex runway_c_mutex;
+ 
+ // Mutex for AVN data
+ mutex avn_mutex;
+ 
+ // Random number generation. There is no shared engine: every consumer owns a
+ // RandomStream keyed by the run seed and a stream id, so draws do not depend on
+ // which thread makes them or in what order flights are updated.
+ 
+ // Counter-based generator: draw n of stream k is a pure function of (seed, k, n).
+ // The key and counter are the whole state, so a stream is cheap to copy and store.
+ class RandomStream {
+ private:
+     uint64_t key;
+     uint64_t counter;
+     
+     // SplitMix64 finaliser
+     static uint64_t mix(uint64_t z) {
+         z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+         z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+         return z ^ (z >> 31);
+     }
+     
+ public:
+     typedef uint64_t result_type;
+     
+     RandomStream(uint64_t seed = 0, uint64_t streamId = 0)
+         : key(mix(seed + 0x9E3779B97F4A7C15ULL * (streamId + 1))), counter(0) {}
+     
+     static constexpr result_type min() { return 0; }
+     static constexpr result_type max() { return UINT64_MAX; }
+     
+     result_type operator()() {
+         return mix(key + 0x9E3779B97F4A7C15ULL * ++counter);
+     }
+     
+     uint64_t getCounter() const {
+         return counter;
+     }
+     
+     void setCounter(uint64_t value) {
+         counter = value;
+     }
+ };
+ 
+ // Stream ids
+ const uint64_t TRAFFIC_STREAM = 0;                // Flight generation in FlightScheduler
+ const uint64_t AIRCRAFT_STREAM_BASE = 1ULL << 32; // + aircraft id, one stream per aircraft
+ 
+ // Seed for the current run (set from --seed, or random_device when not given)
+ uint64_t simulationSeed = 0;
+ 
+ // -------- CLASS DEFINITIONS --------
+ 
+ // Forward declarations
+ class Aircraft;
+ class FlightScheduler;
+ 
+ // Fixed pool of worker threads for data-parallel loops. parallelFor() splits
+ // [0, count) into one contiguous chunk per thread, runs the first chunk on the
+ // calling thread and returns once every chunk is done.
+ class ThreadPool {
+ private:
+     vector<thread> workers;
+     mutex poolMutex;
+     condition_variable workReady;
+     condition_variable workDone;
+     const function<void(size_t, size_t)>* job;
+     size_t jobSize;
+     size_t generation;
+     size_t remaining;
+     bool stopping;
+     
+     static thread_local size_t workerIndex;
+     
+     void runChunk(size_t worker) {
+         size_t threads = size();
+         size_t begin = jobSize * worker / threads;
+         size_t end = jobSize * (worker + 1) / threads;
+         workerIndex = worker;
+         if (begin < end) {
+             (*job)(begin, end);
+         }
+     }
+     
+     void workerLoop(size_t worker) {
+         size_t seenGeneration = 0;
+         
+         while (true) {
+             {
+                 unique_lock<mutex> lock(poolMutex);
+                 workReady.wait(lock, [&] { return stopping || generation != seenGeneration; });
+                 if (stopping) {
+                     return;
+                 }
+                 seenGeneration = generation;
+             }
+             
+             runChunk(worker);
+             
+             lock_guard<mutex> lock(poolMutex);
+             if (--remaining == 0) {
+                 workDone.notify_one();
+             }
+         }
+     }
+     
+ public:
+     // threads is the total number of threads including the caller
+     explicit ThreadPool(size_t threads)
+         : job(nullptr), jobSize(0), generation(0), remaining(0), stopping(false) {
+         for (size_t i = 1; i < threads; i++) {
+             workers.emplace_back(&ThreadPool::workerLoop, this, i);
+         }
+     }
+     
+     ~ThreadPool() {
+         {
+             lock_guard<mutex> lock(poolMutex);
+             stopping = true;
+         }
+         workReady.notify_all();
+         for (auto& worker : workers) {
+             worker.join();
+         }
+     }
+     
+     size_t size() const {
+         return workers.size() + 1;
+     }
+     
+     // Index of the chunk the calling thread is running inside parallelFor()
+     static size_t currentWorker() {
+         return workerIndex;
+     }
+     
+     void parallelFor(size_t count, const function<void(size_t, size_t)>& body) {
+         {
+             lock_guard<mutex> lock(poolMutex);
+             job = &body;
+             jobSize = count;
+             remaining = workers.size();
+             generation++;
+         }
+         workReady.notify_all();
+         
+         runChunk(0);
+         
+         unique_lock<mutex> lock(poolMutex);
+         workDone.wait(lock, [&] { return remaining == 0; });
+         job = nullptr;
+     }
+ };
+ 
+ thread_local size_t ThreadPool::workerIndex = 0;
+ 
+ // Free-list allocator for objects of one size. Blocks are carved out of
+ // 64-block chunks and handed out again as soon as they are freed, so a steady
+ // stream of flights and AVNs stops going to the system allocator once the
+ // pool has grown to the working set.
+ class BlockPool {
+ private:
+     static constexpr size_t BLOCKS_PER_CHUNK = 64;
+     
+     struct FreeBlock {
+         FreeBlock* next;
+     };
+     
+     mutex poolMutex;
+     size_t blockSize; // Fixed by the first allocation
+     FreeBlock* freeList;
+     vector<void*> chunks;
+     size_t inUse;
+     
+ public:
+     BlockPool() : blockSize(0), freeList(nullptr), inUse(0) {}
+     
+     ~BlockPool() {
+         // Blocks still out at exit keep their chunks
+         if (inUse == 0) {
+             for (void* chunk : chunks) {
+                 ::operator delete(chunk);
+             }
+         }
+     }
+     
+     void* allocate(size_t size) {
+         lock_guard<mutex> lock(poolMutex);
+         if (blockSize == 0) {
+             const size_t alignment = alignof(max_align_t);
+             blockSize = (max(size, sizeof(FreeBlock)) + alignment - 1) / alignment * alignment;
+         }
+         if (size > blockSize) {
+             return ::operator new(size);
+         }
+         if (!freeList) {
+             char* chunk = static_cast<char*>(::operator new(blockSize * BLOCKS_PER_CHUNK));
+             chunks.push_back(chunk);
+             for (size_t i = BLOCKS_PER_CHUNK; i-- > 0;) {
+                 FreeBlock* block = reinterpret_cast<FreeBlock*>(chunk + i * blockSize);
+                 block->next = freeList;
+                 freeList = block;
+             }
+         }
+         FreeBlock* block = freeList;
+         freeList = block->next;
+         inUse++;
+         return block;
+     }
+     
+     void deallocate(void* pointer, size_t size) {
+         lock_guard<mutex> lock(poolMutex);
+         if (size > blockSize) {
+             ::operator delete(pointer);
+             return;
+         }
+         FreeBlock* block = static_cast<FreeBlock*>(pointer);
+         block->next = freeList;
+         freeList = block;
+         inUse--;
+     }
+     
+     size_t blocksInUse() {
+         lock_guard<mutex> lock(poolMutex);
+         return inUse;
+     }
+     
+     size_t blocksReserved() {
+         lock_guard<mutex> lock(poolMutex);
+         return chunks.size() * BLOCKS_PER_CHUNK;
+     }
+ };
+ 
+ // Standard allocator over a BlockPool, for allocate_shared. The pool takes on
+ // the size of the rebound type (object plus shared_ptr control block).
+ template <typename T>
+ class PoolAllocator {
+ public:
+     typedef T value_type;
+     
+     BlockPool* pool;
+     
+     explicit PoolAllocator(BlockPool* pool) : pool(pool) {}
+     
+     template <typename U>
+     PoolAllocator(const PoolAllocator<U>& other) : pool(other.pool) {}
+     
+     T* allocate(size_t count) {
+         return static_cast<T*>(pool->allocate(count * sizeof(T)));
+     }
+     
+     void deallocate(T* pointer, size_t count) {
+         pool->deallocate(pointer, count * sizeof(T));
+     }
+     
+     template <typename U>
+     bool operator==(const PoolAllocator<U>& other) const {
+         return pool == other.pool;
+     }
+     
+     template <typename U>
+     bool operator!=(const PoolAllocator<U>& other) const {
+         return pool != other.pool;
+     }
+ };
+ 
+ // One pool per object type
+ template <typename T>
+ BlockPool& poolFor() {
+     static BlockPool pool;
+     return pool;
+ }
+ 
+ // make_shared with the object and its control block in a pooled block
+ template <typename T, typename... Args>
+ shared_ptr<T> makePooled(Args&&... args) {
+     return allocate_shared<T>(PoolAllocator<T>(&poolFor<T>()), forward<Args>(args)...);
+ }
+ 
+ // Airspace Violation Notice (AVN)
+ class AVN {
+ public:
+     int id;
+     string airline;
+     string flightNumber;
+     FlightType aircraftType;
+     int recordedSpeed;
+     int permissibleSpeedMin;
+     int permissibleSpeedMax;
+     time_t issueTime;
+     time_t dueDate;
+     double fineAmount;
+     double serviceFee;
+     double totalAmount;
+     PaymentStatus status;
+ 
+     AVN(int id, const string& airline, const string& flightNumber, FlightType type, 
+         int recordedSpeed, int permissibleSpeedMin, int permissibleSpeedMax) 
+         : id(id), airline(airline), flightNumber(flightNumber), aircraftType(type),
+           recordedSpeed(recordedSpeed), permissibleSpeedMin(permissibleSpeedMin), 
+           permissibleSpeedMax(permissibleSpeedMax), status(PaymentStatus::UNPAID) {
+         
+         // Set issue time to current time
+         issueTime = time(nullptr);
+         
+         // Set due date to 3 days from now
+         dueDate = issueTime + (3 * 24 * 60 * 60);
+         
+         // Calculate fine amount based on aircraft type
+         if (type == FlightType::COMMERCIAL) {
+             fineAmount = COMMERCIAL_FINE;
+         } else {
+             fineAmount = CARGO_FINE;
+         }
+         
+         // Calculate service fee
+         serviceFee = fineAmount * SERVICE_FEE_PERCENTAGE;
+         
+         // Calculate total amount
+         totalAmount = fineAmount + serviceFee;
+     }
+ 
+     // Rebuild an AVN from its plain-data copy (journal recovery)
+     AVN(const AVNRecord& record, const string& airline)
+         : AVN(record.id, airline, string(record.flightNumber, strnlen(record.flightNumber, sizeof(record.flightNumber))),
+               static_cast<FlightType>(record.aircraftType), record.recordedSpeed,
+               record.permissibleSpeedMin, record.permissibleSpeedMax) {
+         issueTime = record.issueTime;
+         dueDate = record.dueDate;
+         totalAmount = record.totalAmount;
+         status = static_cast<PaymentStatus>(record.status);
+     }
+ 
+     // Plain-data copy for the shared table and the journal
+     AVNRecord toRecord() const {
+         AVNRecord record;
+         memset(&record, 0, sizeof(record));
+         record.id = id;
+         record.recordedSpeed = recordedSpeed;
+         record.permissibleSpeedMin = permissibleSpeedMin;
+         record.permissibleSpeedMax = permissibleSpeedMax;
+         record.issueTime = issueTime;
+         record.dueDate = dueDate;
+         record.totalAmount = totalAmount;
+         record.aircraftType = static_cast<uint8_t>(aircraftType);
+         record.status = static_cast<uint8_t>(status);
+         strncpy(record.flightNumber, flightNumber.c_str(), sizeof(record.flightNumber) - 1);
+         return record;
+     }
+ 
+     string getStatusString() const {
+         switch (status) {
+             case PaymentStatus::UNPAID: return "Unpaid";
+             case PaymentStatus::PAID: return "Paid";
+             case PaymentStatus::OVERDUE: return "Overdue";
+             default: return "Unknown";
+         }
+     }
+ 
+     string getAircraftTypeString() const {
+         switch (aircraftType) {
+             case FlightType::COMMERCIAL: return "Commercial";
+             case FlightType::CARGO: return "Cargo";
+             case FlightType::EMERGENCY: return "Emergency";
+             default: return "Unknown";
+         }
+     }
+ 
+     string getFormattedTime(time_t timeValue) const {
+         struct tm* timeinfo = localtime(&timeValue);
+         char buffer[80];
+         strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", timeinfo);
+         return string(buffer);
+     }
+ 
+     void printDetails() const {
+         lock_guard<mutex> lock(cout_mutex);
+         cout << "============= AVN DETAILS =============" << endl;
+         cout << "AVN ID: " << id << endl;
+         cout << "Airline: " << airline << endl;
+         cout << "Flight Number: " << flightNumber << endl;
+         cout << "Aircraft Type: " << getAircraftTypeString() << endl;
+         cout << "Speed Recorded: " << recordedSpeed << " km/h" << endl;
+         cout << "Permissible Speed Range: " << permissibleSpeedMin << "-" << permissibleSpeedMax << " km/h" << endl;
+         cout << "Issue Date/Time: " << getFormattedTime(issueTime) << endl;
+         cout << "Due Date: " << getFormattedTime(dueDate) << endl;
+         cout << "Fine Amount: PKR " << fixed << setprecision(2) << fineAmount << endl;
+         cout << "Service Fee: PKR " << fixed << setprecision(2) << serviceFee << endl;
+         cout << "Total Due: PKR " << fixed << setprecision(2) << totalAmount << endl;
+         cout << "Payment Status: " << getStatusString() << endl;
+         cout << "=======================================" << endl;
+     }
+ };
+ 
+ // Interned string table: each distinct string gets a small integer id
+ class StringInterner {
+ private:
+     unordered_map<string, uint32_t> ids;
+     vector<string> strings;
+     
+ public:
+     uint32_t intern(const string& value) {
+         auto it = ids.find(value);
+         if (it != ids.end()) {
+             return it->second;
+         }
+         uint32_t id = static_cast<uint32_t>(strings.size());
+         strings.push_back(value);
+         ids.emplace(value, id);
+         return id;
+     }
+     
+     // Id of an already interned value, without adding it
+     bool find(const string& value, uint32_t& id) const {
+         auto it = ids.find(value);
+         if (it == ids.end()) {
+             return false;
+         }
+         id = it->second;
+         return true;
+     }
+     
+     const string& resolve(uint32_t id) const {
+         return strings[id];
+     }
+     
+     size_t size() const {
+         return strings.size();
+     }
+ };
+ 
+ // Airline class
+ class Airline {
+ public:
+     string name;
+     int totalAircrafts;
+     int activeFlights;
+     AirlineKind kind;
+     string flightPrefix; // Flight numbers are this plus a sequence number
+     vector<shared_ptr<AVN>> violations;
+     
+     Airline(const string& name, int totalAircrafts, int activeFlights, AirlineKind kind = AirlineKind::COMMERCIAL)
+         : name(name), totalAircrafts(totalAircrafts), activeFlights(activeFlights), kind(kind),
+           flightPrefix(name.substr(0, 2) + "-") {}
+     
+     void addViolation(shared_ptr<AVN> violation) {
+         lock_guard<mutex> lock(avn_mutex);
+         violations.push_back(violation);
+     }
+ 
+     void printViolations() const {
+         lock_guard<mutex> lock(cout_mutex);
+         cout << "==== Violations for " << name << " ====" << endl;
+         
+         if (violations.empty()) {
+             cout << "No violations recorded." << endl;
+         } else {
+             for (const auto& avn : violations) {
+                 cout << "AVN ID: " << avn->id << " | Flight: " << avn->flightNumber 
+                      << " | Status: " << avn->getStatusString() 
+                      << " | Amount: PKR " << fixed << setprecision(2) << avn->totalAmount << endl;
+             }
+         }
+         cout << "================================" << endl;
+     }
+ };
+ 
+ // Append-only binary log of AVN events, so AVN history survives a restart.
+ // The file is a JournalFileHeader followed by fixed-size JournalRecords, each
+ // with a checksum. Appends only copy into memory; a committer thread writes
+ // whatever has built up and covers the whole group with one fdatasync().
+ // Recovery maps the file and walks the records in place, stopping at the
+ // first torn or corrupt one.
+ class AVNJournal {
+ public:
+     enum RecordKind : uint32_t { AVN_ISSUED = 1, AVN_PAID = 2, AVN_UPDATED = 3 };
+     
+     struct JournalRecord {
+         uint32_t kind;
+         uint32_t checksum; // FNV-1a over the record with this field zeroed
+         AVNRecord avn;     // AVN_PAID sets only id and totalAmount (amount paid), AVN_UPDATED id, totalAmount and status
+         char airline[32];
+     };
+     
+     // AVNs as they stand after replaying a journal, in issue order
+     struct Recovery {
+         vector<shared_ptr<AVN>> avns;
+         size_t records;
+         size_t validBytes; // Length of the intact prefix of the file
+         
+         Recovery() : records(0), validBytes(0) {}
+     };
+     
+ private:
+     struct JournalFileHeader {
+         uint32_t magic;
+         uint32_t version;
+         uint32_t recordSize;
+         uint32_t reserved;
+     };
+     
+     static constexpr uint32_t JOURNAL_MAGIC = 0x4143584A; // "ACXJ"
+     static constexpr uint32_t JOURNAL_VERSION = 1;
+     static constexpr int COMMIT_INTERVAL_MS = 50;
+     static constexpr size_t COMMIT_BATCH_BYTES = 64 * 1024; // Commit early once this much is waiting
+     
+     int fd;
+     string buffer;       // Appended, not yet handed to the committer
+     uint64_t appended;   // Records appended so far
+     uint64_t committed;  // Records known to be on disk
+     bool stopping;
+     mutex bufferMutex;
+     condition_variable work;
+     condition_variable durable;
+     thread committer;
+     
+     static uint32_t checksumOf(JournalRecord record) {
+         record.checksum = 0;
+         const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&record);
+         uint32_t hash = 2166136261u;
+         for (size_t i = 0; i < sizeof(record); i++) {
+             hash = (hash ^ bytes[i]) * 16777619u;
+         }
+         return hash;
+     }
+     
+     void append(JournalRecord record) {
+         record.checksum = checksumOf(record);
+         bool full;
+         {
+             lock_guard<mutex> lock(bufferMutex);
+             buffer.append(reinterpret_cast<const char*>(&record), sizeof(record));
+             appended++;
+             full = buffer.size() >= COMMIT_BATCH_BYTES;
+         }
+         if (full) {
+             work.notify_one();
+         }
+     }
+     
+     void commitLoop() {
+         string batch;
+         unique_lock<mutex> lock(bufferMutex);
+         
+         while (true) {
+             work.wait_for(lock, chrono::milliseconds(COMMIT_INTERVAL_MS), [this] {
+                 return stopping || buffer.size() >= COMMIT_BATCH_BYTES;
+             });
+             if (buffer.empty()) {
+                 if (stopping) {
+                     return;
+                 }
+                 continue;
+             }
+             
+             batch.swap(buffer);
+             uint64_t target = appended;
+             lock.unlock();
+             
+             // One write and one fdatasync for the whole group
+             size_t written = 0;
+             while (written < batch.size()) {
+                 ssize_t n = write(fd, batch.data() + written, batch.size() - written);
+                 if (n < 0 && errno == EINTR) {
+                     continue;
+                 }
+                 if (n <= 0) {
+                     LogLine(LogLevel::ERROR) << "AVN journal write failed: " << strerror(errno);
+                     break;
+                 }
+                 written += n;
+             }
+             fdatasync(fd);
+             batch.clear();
+             
+             lock.lock();
+             committed = target;
+             durable.notify_all();
+         }
+     }
+     
+ public:
+     AVNJournal() : fd(-1), appended(0), committed(0), stopping(false) {}
+     
+     ~AVNJournal() {
+         close();
+     }
+     
+     // Replay the journal at path. A missing file is an empty journal.
+     static bool recover(const string& path, Recovery& result, string& error) {
+         int file = ::open(path.c_str(), O_RDONLY);
+         if (file == -1) {
+             if (errno == ENOENT) {
+                 return true;
+             }
+             error = strerror(errno);
+             return false;
+         }
+         
+         struct stat info;
+         fstat(file, &info);
+         size_t size = info.st_size;
+         if (size == 0) {
+             ::close(file);
+             return true;
+         }
+         
+         void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+         ::close(file);
+         if (mapping == MAP_FAILED) {
+             error = strerror(errno);
+             return false;
+         }
+         madvise(mapping, size, MADV_SEQUENTIAL);
+         
+         const char* bytes = static_cast<const char*>(mapping);
+         JournalFileHeader header;
+         if (size < sizeof(header)) {
+             munmap(mapping, size);
+             return true; // Torn before the header was complete
+         }
+         memcpy(&header, bytes, sizeof(header));
+         if (header.magic != JOURNAL_MAGIC || header.version != JOURNAL_VERSION || header.recordSize != sizeof(JournalRecord)) {
+             munmap(mapping, size);
+             error = "not an AVN journal of this version";
+             return false;
+         }
+         
+         unordered_map<int, shared_ptr<AVN>> byId;
+         size_t offset = sizeof(header);
+         for (; offset + sizeof(JournalRecord) <= size; offset += sizeof(JournalRecord)) {
+             JournalRecord record;
+             memcpy(&record, bytes + offset, sizeof(record));
+             if (record.checksum != checksumOf(record)) {
+                 break;
+             }
+             
+             if (record.kind == AVN_ISSUED) {
+                 string airline(record.airline, strnlen(record.airline, sizeof(record.airline)));
+                 auto avn = makePooled<AVN>(record.avn, airline);
+                 byId[avn->id] = avn;
+                 result.avns.push_back(avn);
+             } else if (record.kind == AVN_PAID) {
+                 auto it = byId.find(record.avn.id);
+                 if (it != byId.end()) {
+                     it->second->status = PaymentStatus::PAID;
+                 }
+             } else if (record.kind == AVN_UPDATED) {
+                 auto it = byId.find(record.avn.id);
+                 if (it != byId.end()) {
+                     it->second->status = static_cast<PaymentStatus>(record.avn.status);
+                     it->second->totalAmount = record.avn.totalAmount;
+                 }
+             }
+             result.records++;
+         }
+         result.validBytes = offset;
+         munmap(mapping, size);
+         return true;
+     }
+     
+     // Open path for appending, cutting off anything past validBytes (a torn
+     // tail from a crash). Starts the committer thread.
+     bool open(const string& path, size_t validBytes, string& error) {
+         fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, 0644);
+         if (fd == -1) {
+             error = strerror(errno);
+             return false;
+         }
+         if (validBytes < sizeof(JournalFileHeader)) {
+             JournalFileHeader header = {JOURNAL_MAGIC, JOURNAL_VERSION, sizeof(JournalRecord), 0};
+             if (ftruncate(fd, 0) == -1 || pwrite(fd, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header))) {
+                 error = strerror(errno);
+                 return false;
+             }
+             validBytes = sizeof(header);
+         } else if (ftruncate(fd, validBytes) == -1) {
+             error = strerror(errno);
+             return false;
+         }
+         lseek(fd, validBytes, SEEK_SET);
+         fdatasync(fd);
+         
+         committer = thread(&AVNJournal::commitLoop, this);
+         return true;
+     }
+     
+     bool isOpen() const {
+         return fd >= 0;
+     }
+     
+     void recordIssued(const AVN& avn) {
+         JournalRecord record;
+         memset(&record, 0, sizeof(record));
+         record.kind = AVN_ISSUED;
+         record.avn = avn.toRecord();
+         strncpy(record.airline, avn.airline.c_str(), sizeof(record.airline) - 1);
+         append(record);
+     }
+     
+     void recordPaid(int avnId, double amount) {
+         JournalRecord record;
+         memset(&record, 0, sizeof(record));
+         record.kind = AVN_PAID;
+         record.avn.id = avnId;
+         record.avn.totalAmount = amount;
+         record.avn.status = static_cast<uint8_t>(PaymentStatus::PAID);
+         append(record);
+     }
+     
+     // Status or amount changed after issue (overdue, penalty)
+     void recordUpdated(const AVN& avn) {
+         JournalRecord record;
+         memset(&record, 0, sizeof(record));
+         record.kind = AVN_UPDATED;
+         record.avn.id = avn.id;
+         record.avn.totalAmount = avn.totalAmount;
+         record.avn.status = static_cast<uint8_t>(avn.status);
+         append(record);
+     }
+     
+     // Wait until everything appended so far is on disk
+     void sync() {
+         if (fd < 0) {
+             return;
+         }
+         unique_lock<mutex> lock(bufferMutex);
+         uint64_t target = appended;
+         work.notify_one();
+         durable.wait(lock, [this, target] { return committed >= target || stopping; });
+     }
+     
+     // Commit what is left and stop the committer
+     void close() {
+         if (fd < 0) {
+             return;
+         }
+         {
+             lock_guard<mutex> lock(bufferMutex);
+             stopping = true;
+         }
+         work.notify_one();
+         committer.join();
+         ::close(fd);
+         fd = -1;
+     }
+ };
+ 
+ // Hierarchical timer wheel: four levels of 64 slots, each level 64 times
+ // coarser than the one below, so one wheel spans 2^24 ticks (194 days of
+ // seconds). Scheduling is O(1) and pushes the timer onto its slot's list.
+ // Each advanced tick fires one level-0 slot, and on a level boundary it moves
+ // the next coarser slot down a level. Every timer is moved at most once per
+ // level, so cost follows the timers that expire, not the number waiting.
+ // The tick unit is up to the caller (simulated or wall-clock seconds).
+ template <typename Payload>
+ class TimerWheel {
+ private:
+     static constexpr int LEVEL_BITS = 6;
+     static constexpr int SLOTS = 1 << LEVEL_BITS;
+     static constexpr int LEVELS = 4;
+     static constexpr int OVERFLOW_LIST = LEVELS * SLOTS; // Timers beyond the top level's reach
+     
+     struct Timer {
+         uint64_t expiry;
+         Payload payload;
+         int32_t next;
+     };
+     
+     vector<Timer> timers;   // Pool; freed entries are chained through next
+     int32_t freeList;
+     vector<int32_t> heads;  // LEVELS * SLOTS slot lists, then the overflow list
+     uint64_t current;       // Last tick advanced to
+     size_t pending;
+     
+     void place(int32_t index) {
+         Timer& timer = timers[index];
+         uint64_t delta = timer.expiry - current;
+         int list = OVERFLOW_LIST;
+         for (int level = 0; level < LEVELS; level++) {
+             if (delta < (uint64_t(1) << (LEVEL_BITS * (level + 1)))) {
+                 list = level * SLOTS + static_cast<int>((timer.expiry >> (LEVEL_BITS * level)) & (SLOTS - 1));
+                 break;
+             }
+         }
+         timer.next = heads[list];
+         heads[list] = index;
+     }
+     
+     // Re-place every timer of one list relative to the new current tick
+     void cascade(int list) {
+         int32_t index = heads[list];
+         heads[list] = -1;
+         while (index != -1) {
+             int32_t next = timers[index].next;
+             place(index);
+             index = next;
+         }
+     }
+     
+ public:
+     explicit TimerWheel(uint64_t now = 0) : freeList(-1), heads(LEVELS * SLOTS + 1, -1), current(now), pending(0) {}
+     
+     uint64_t now() const {
+         return current;
+     }
+     
+     size_t size() const {
+         return pending;
+     }
+     
+     // The wheel as it stands, slot lists and all, so a restored wheel fires the
+     // same timers in the same order. encode/decode map a payload to and from the image.
+     template <typename Writer, typename Encode>
+     void save(Writer& out, Encode encode) const {
+         out.put(current);
+         out.put(static_cast<uint64_t>(pending));
+         out.put(freeList);
+         out.putVector(heads);
+         out.put(static_cast<uint64_t>(timers.size()));
+         for (const Timer& timer : timers) {
+             out.put(timer.expiry);
+             out.put(timer.next);
+             encode(out, timer.payload);
+         }
+     }
+     
+     template <typename Reader, typename Decode>
+     bool load(Reader& in, Decode decode) {
+         current = in.template get<uint64_t>();
+         pending = in.template get<uint64_t>();
+         freeList = in.template get<int32_t>();
+         in.getVector(heads);
+         uint64_t count = in.template get<uint64_t>();
+         if (!in.fits(count, sizeof(uint64_t) + sizeof(int32_t))) {
+             return false;
+         }
+         timers.resize(count);
+         for (Timer& timer : timers) {
+             timer.expiry = in.template get<uint64_t>();
+             timer.next = in.template get<int32_t>();
+             if (!decode(in, timer.payload)) {
+                 return false;
+             }
+         }
+         return in.ok() && heads.size() == LEVELS * SLOTS + 1;
+     }
+     
+     // Fire payload on the first advance() that reaches expiry (the next one if already past)
+     void schedule(uint64_t expiry, const Payload& payload) {
+         int32_t index;
+         if (freeList != -1) {
+             index = freeList;
+             freeList = timers[index].next;
+         } else {
+             index = static_cast<int32_t>(timers.size());
+             timers.push_back(Timer());
+         }
+         timers[index].expiry = max(expiry, current + 1);
+         timers[index].payload = payload;
+         place(index);
+         pending++;
+     }
+     
+     // Move time forward to now, calling fire(payload) for every timer that
+     // expires on the way, in expiry order. fire may schedule further timers.
+     template <typename Fire>
+     void advance(uint64_t now, Fire fire) {
+         while (current < now) {
+             if (pending == 0) {
+                 current = now; // Nothing waiting, no slot to visit
+                 return;
+             }
+             current++;
+             
+             // On a level boundary bring the next coarser slot down
+             for (int level = 1; level < LEVELS; level++) {
+                 if ((current & ((uint64_t(1) << (LEVEL_BITS * level)) - 1)) != 0) {
+                     break;
+                 }
+                 cascade(level * SLOTS + static_cast<int>((current >> (LEVEL_BITS * level)) & (SLOTS - 1)));
+                 if (level == LEVELS - 1) {
+                     cascade(OVERFLOW_LIST);
+                 }
+             }
+             
+             int slot = static_cast<int>(current & (SLOTS - 1));
+             int32_t index = heads[slot];
+             heads[slot] = -1;
+             while (index != -1) {
+                 int32_t next = timers[index].next;
+                 Payload payload = timers[index].payload;
+                 timers[index].next = freeList;
+                 freeList = index;
+                 pending--;
+                 fire(payload);
+                 index = next;
+             }
+         }
+     }
+ };
+ 
+ // Flight phase rules, one row per (flight kind, state). Durations, speed
+ // ranges and violation limits live here instead of in each flight class;
+ // the kernels below run them for both Aircraft objects and the FlightTable.
+ 
+ // First index into PHASE_RULES
+ const uint8_t ARRIVAL_PHASES = 0;
+ const uint8_t DEPARTURE_PHASES = 1;
+ const uint8_t FLIGHT_PHASES = 5; // ArrivalState and DepartureState both have five states
+ 
+ const int NO_TRANSITION = INT_MAX; // Duration of a final phase
+ const int NO_LOWER_LIMIT = INT_MIN;
+ 
+ // Speed set on entering a phase
+ enum class EntrySpeed : uint8_t { RANDOM, FIXED };
+ 
+ // Speed a randomly injected violation holds until the phase ends
+ enum class Injection : uint8_t {
+     NONE,
+     ABOVE_LIMIT,   // permittedMax + excess
+     ABOVE_CURRENT, // Current speed + excess
+     EITHER_SIDE    // permittedMax + excess or permittedMin - excess, even odds
+ };
+ 
+ struct PhaseRule {
+     const char* name;
+     int duration;        // Time in the phase before the next one
+     bool needsRunway;    // Also waits for a runway assignment
+     bool clearsRunway;   // Entering it hands the runway back
+     EntrySpeed entry;
+     int entryMin;        // FIXED entry speed, or the RANDOM range
+     int entryMax;
+     bool ramps;          // Speed moves linearly from rampFrom to rampTo over the duration
+     int rampFrom;
+     int rampTo;
+     bool parked;         // Speed held at 0
+     Injection injection;
+     bool injectLate;     // Only in the second half of the phase
+     int excessDivisor;
+     int checkMin;        // Violation below checkMin or above checkMax,
+     int checkMax;
+     int endMax;          // or above endMax once the duration has passed
+     int permittedMin;    // Range written on the AVN
+     int permittedMax;
+ };
+ 
+ constexpr PhaseRule PHASE_RULES[2][FLIGHT_PHASES] = {
+     { // Arrivals
+         {"Holding", 20, true, false, EntrySpeed::RANDOM, HOLDING_MIN_SPEED, HOLDING_MAX_SPEED, false, 0, 0, false,
+          Injection::ABOVE_LIMIT, false, 1, NO_LOWER_LIMIT, HOLDING_MAX_SPEED, HOLDING_MAX_SPEED, HOLDING_MIN_SPEED, HOLDING_MAX_SPEED},
+         {"Approach", 15, false, false, EntrySpeed::RANDOM, APPROACH_MIN_SPEED, APPROACH_MAX_SPEED, false, 0, 0, false,
+          Injection::ABOVE_LIMIT, false, 1, APPROACH_MIN_SPEED, APPROACH_MAX_SPEED, APPROACH_MAX_SPEED, APPROACH_MIN_SPEED, APPROACH_MAX_SPEED},
+         {"Landing", 10, false, false, EntrySpeed::FIXED, LANDING_START_SPEED, LANDING_START_SPEED, true, LANDING_START_SPEED, LANDING_END_SPEED, false,
+          Injection::ABOVE_CURRENT, true, 1, NO_LOWER_LIMIT, LANDING_START_SPEED, LANDING_END_SPEED, 0, LANDING_START_SPEED},
+         {"Taxi", 15, false, true, EntrySpeed::RANDOM, TAXI_MIN_SPEED, TAXI_MAX_SPEED, false, 0, 0, false,
+          Injection::ABOVE_LIMIT, false, 2, NO_LOWER_LIMIT, TAXI_MAX_SPEED, TAXI_MAX_SPEED, TAXI_MIN_SPEED, TAXI_MAX_SPEED},
+         {"At Gate", NO_TRANSITION, false, false, EntrySpeed::FIXED, 0, 0, false, 0, 0, true,
+          Injection::NONE, false, 1, NO_LOWER_LIMIT, GATE_MAX_SPEED, GATE_MAX_SPEED, 0, GATE_MAX_SPEED}
+     },
+     { // Departures
+         {"At Gate", 0, true, false, EntrySpeed::FIXED, 0, 0, false, 0, 0, true,
+          Injection::NONE, false, 1, NO_LOWER_LIMIT, GATE_MAX_SPEED, GATE_MAX_SPEED, 0, GATE_MAX_SPEED},
+         {"Taxi", 15, false, false, EntrySpeed::RANDOM, TAXI_MIN_SPEED, TAXI_MAX_SPEED, false, 0, 0, false,
+          Injection::ABOVE_LIMIT, false, 2, NO_LOWER_LIMIT, TAXI_MAX_SPEED, TAXI_MAX_SPEED, TAXI_MIN_SPEED, TAXI_MAX_SPEED},
+         {"Takeoff Roll", 10, false, false, EntrySpeed::FIXED, 0, 0, true, 0, TAKEOFF_MAX_SPEED, false,
+          Injection::ABOVE_LIMIT, true, 1, NO_LOWER_LIMIT, TAKEOFF_MAX_SPEED, TAKEOFF_MAX_SPEED, 0, TAKEOFF_MAX_SPEED},
+         {"Climb", 20, false, true, EntrySpeed::RANDOM, CLIMB_MIN_SPEED, CLIMB_MAX_SPEED, false, 0, 0, false,
+          Injection::ABOVE_LIMIT, false, 1, NO_LOWER_LIMIT, CLIMB_MAX_SPEED, CLIMB_MAX_SPEED, CLIMB_MIN_SPEED, CLIMB_MAX_SPEED},
+         {"Cruise", NO_TRANSITION, false, false, EntrySpeed::RANDOM, CRUISE_MIN_SPEED, CRUISE_MAX_SPEED, false, 0, 0, false,
+          Injection::EITHER_SIDE, false, 1, CRUISE_MIN_SPEED, CRUISE_MAX_SPEED, CRUISE_MAX_SPEED, CRUISE_MIN_SPEED, CRUISE_MAX_SPEED}
+     }
+ };
+ 
+ // The phase fields a kernel works on, copied out of an Aircraft or a FlightTable row
+ struct PhaseState {
+     int32_t speed;
+     int32_t phaseTime;
+     int32_t violationSpeed;
+     uint8_t phase;
+     bool holdingViolationSpeed; // An injected violation keeps its speed until the phase ends
+ };
+ 
+ // True when speed breaks the phase's limits and the phase has not had a
+ // violation yet (violatedPhases has a bit per phase)
+ inline bool breaksPhaseLimits(const PhaseRule& rule, int32_t speed, int32_t phaseTime, uint8_t phase, uint8_t violatedPhases) {
+     int32_t limit = (phaseTime >= rule.duration) ? rule.endMax : rule.checkMax;
+     bool outside = (speed < rule.checkMin) | (speed > limit);
+     bool fresh = ((violatedPhases >> phase) & 1u) == 0;
+     return outside & fresh;
+ }
+ 
+ // Rows per word of a violation bitmap
+ const size_t VIOLATION_BITMAP_ROWS = 64;
+ 
+ // Bit i is set when speed[i] is outside [low[i], high[i]], for up to 64 rows.
+ // Eight rows per instruction with AVX2, four with NEON, plain compares otherwise.
+ inline uint64_t speedViolationBits(const int32_t* speed, const int32_t* low, const int32_t* high, size_t count) {
+     uint64_t bits = 0;
+     size_t i = 0;
+ #if defined(__AVX2__)
+     for (; i + 8 <= count; i += 8) {
+         __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(speed + i));
+         __m256i below = _mm256_cmpgt_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(low + i)), value);
+         __m256i above = _mm256_cmpgt_epi32(value, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(high + i)));
+         uint32_t lanes = static_cast<uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_or_si256(below, above))));
+         bits |= static_cast<uint64_t>(lanes) << i;
+     }
+ #elif defined(__ARM_NEON) && defined(__aarch64__)
+     const uint32_t laneBits[4] = {1, 2, 4, 8};
+     uint32x4_t laneMask = vld1q_u32(laneBits);
+     for (; i + 4 <= count; i += 4) {
+         int32x4_t value = vld1q_s32(speed + i);
+         uint32x4_t outside = vorrq_u32(vcltq_s32(value, vld1q_s32(low + i)), vcgtq_s32(value, vld1q_s32(high + i)));
+         bits |= static_cast<uint64_t>(vaddvq_u32(vandq_u32(outside, laneMask))) << i;
+     }
+ #endif
+     for (; i < count; i++) {
+         bits |= static_cast<uint64_t>((speed[i] < low[i]) | (speed[i] > high[i])) << i;
+     }
+     return bits;
+ }
+ 
+ // One tick of a flight's phase, specialised per flight kind
+ template <uint8_t Kind>
+ struct PhaseKernel {
+     static constexpr const PhaseRule* rules = PHASE_RULES[Kind];
+     static constexpr uint8_t FINAL_PHASE = FLIGHT_PHASES - 1;
+     
+     static int32_t entrySpeed(const PhaseRule& rule, RandomStream& rng) {
+         if (rule.entry == EntrySpeed::FIXED) {
+             return rule.entryMin;
+         }
+         uniform_int_distribution<> entryDist(rule.entryMin, rule.entryMax);
+         return entryDist(rng);
+     }
+     
+     // Speed for a newly created flight in its first phase
+     static int32_t initialSpeed(RandomStream& rng) {
+         return entrySpeed(rules[0], rng);
+     }
+     
+     static bool clearsRunway(uint8_t phase) {
+         return rules[phase].clearsRunway;
+     }
+     
+     // Count the tick, ramp the speed and move to the next phase when this one
+     // is over. Returns true when the phase changed.
+     static bool advance(PhaseState& state, bool hasRunway, RandomStream& rng) {
+         const PhaseRule& rule = rules[state.phase];
+         state.phaseTime++;
+         
+         if (rule.ramps && !state.holdingViolationSpeed) {
+             int32_t speed = rule.rampFrom + (rule.rampTo - rule.rampFrom) * state.phaseTime / rule.duration;
+             state.speed = (rule.rampTo < rule.rampFrom) ? max(rule.rampTo, speed) : min(rule.rampTo, speed);
+         }
+         
+         if (state.phaseTime >= rule.duration && (hasRunway || !rule.needsRunway)) {
+             state.phase++;
+             state.phaseTime = 0;
+             state.holdingViolationSpeed = false;
+             state.speed = entrySpeed(rules[state.phase], rng);
+             return true;
+         }
+         if (rule.parked) {
+             state.holdingViolationSpeed = false;
+             state.speed = 0;
+         }
+         return false;
+     }
+     
+     // Randomly start a violation in the current phase (never for emergency
+     // flights or one with an AVN pending), or keep up the one already held
+     static void injectViolation(PhaseState& state, bool mayInject, RandomStream& rng) {
+         if (state.holdingViolationSpeed) {
+             state.speed = state.violationSpeed;
+             return;
+         }
+         if (!mayInject) {
+             return;
+         }
+         
+         uniform_int_distribution<> violationChanceDist(1, 100);
+         if (violationChanceDist(rng) > VIOLATION_PROBABILITY / 3) {
+             return;
+         }
+         uniform_int_distribution<> violationDist(1, 100);
+         if (violationDist(rng) > VIOLATION_PROBABILITY) {
+             return;
+         }
+         
+         const PhaseRule& rule = rules[state.phase];
+         if (rule.injection == Injection::NONE || (rule.injectLate && state.phaseTime <= rule.duration / 2)) {
+             return;
+         }
+         
+         uniform_int_distribution<> excessDist(5, MAX_VIOLATION_SPEED_EXCESS);
+         switch (rule.injection) {
+             case Injection::ABOVE_LIMIT:
+                 state.speed = rule.permittedMax + excessDist(rng) / rule.excessDivisor;
+                 break;
+             case Injection::ABOVE_CURRENT:
+                 state.speed += excessDist(rng) / rule.excessDivisor;
+                 break;
+             case Injection::EITHER_SIDE:
+                 // Either too slow or too fast
+                 if (violationDist(rng) > 50) {
+                     state.speed = rule.permittedMax + excessDist(rng);
+                 } else {
+                     state.speed = rule.permittedMin - excessDist(rng);
+                 }
+                 break;
+             default:
+                 break;
+         }
+         state.holdingViolationSpeed = true;
+         state.violationSpeed = state.speed;
+     }
+ };
+ 
+ // Runway timing derived from PHASE_RULES. A flight waits for its runway in
+ // the phase with needsRunway and hands it back on entering the one with
+ // clearsRunway; the release happens at the next tick's runway pass, so the
+ // runway can be given out again the tick after that.
+ constexpr uint8_t runwayPhase(uint8_t kind) {
+     uint8_t phase = 0;
+     while (phase < FLIGHT_PHASES - 1 && !PHASE_RULES[kind][phase].needsRunway) {
+         phase++;
+     }
+     return phase;
+ }
+ 
+ constexpr uint8_t runwayClearedPhase(uint8_t kind) {
+     uint8_t phase = 0;
+     while (phase < FLIGHT_PHASES - 1 && !PHASE_RULES[kind][phase].clearsRunway) {
+         phase++;
+     }
+     return phase;
+ }
+ 
+ // Time in the runway phase after which the flight can leave it, given a runway
+ constexpr int runwayReadyTime(uint8_t kind) {
+     return max(0, PHASE_RULES[kind][runwayPhase(kind)].duration - 1);
+ }
+ 
+ // Ticks from giving a ready flight its runway until the runway can be given out again
+ constexpr int runwayOccupancy(uint8_t kind) {
+     int ticks = 2;
+     for (uint8_t phase = runwayPhase(kind) + 1; phase < runwayClearedPhase(kind); phase++) {
+         ticks += PHASE_RULES[kind][phase].duration;
+     }
+     return ticks;
+ }
+ 
+ // Ticks until a flight holding a runway makes it free again, from its current phase
+ inline int ticksUntilRunwayFree(uint8_t kind, uint8_t phase, int phaseTime) {
+     if (phase == runwayPhase(kind)) {
+         return max(0, runwayReadyTime(kind) - phaseTime) + runwayOccupancy(kind);
+     }
+     if (phase >= runwayClearedPhase(kind)) {
+         return 1;
+     }
+     int ticks = PHASE_RULES[kind][phase].duration - phaseTime + 1;
+     for (uint8_t next = phase + 1; next < runwayClearedPhase(kind); next++) {
+         ticks += PHASE_RULES[kind][next].duration;
+     }
+     return ticks;
+ }
+ 
+ // Aircraft class (base for both arrival and departure)
+ class Aircraft {
+ protected:
+     static int nextId;
+     static int nextAvnId; // Shared by arrivals and departures so AVN ids never collide
+     static int lastAvnId; // End of this airport's id block in a sharded run
+     
+     // Subscriber notified of phase transitions (set by the scheduler)
+     function<void(Aircraft&, FlightEvent)> eventListener;
+     
+     void emitEvent(FlightEvent event) {
+         if (eventListener) {
+             eventListener(*this, event);
+         }
+     }
+     
+     // One tick of the phase rules for this flight's kind: advance the phase,
+     // notify the scheduler of any transition, then inject or hold a violation
+     template <uint8_t Kind, typename State>
+     void runPhaseTick(State& state, int& stateTime) {
+         PhaseState phase = capturePhase(static_cast<uint8_t>(state), stateTime);
+         bool phaseChanged = PhaseKernel<Kind>::advance(phase, assignedRunway != Runway::NONE, rng);
+         applyPhase(phase, state, stateTime);
+         
+         if (phaseChanged) {
+             emitEvent(FlightEvent::STATE_CHANGED);
+             if (PhaseKernel<Kind>::clearsRunway(phase.phase)) {
+                 emitEvent(FlightEvent::RUNWAY_CLEARED);
+             } else if (phase.phase == PhaseKernel<Kind>::FINAL_PHASE) {
+                 emitEvent(FlightEvent::COMPLETED);
+             }
+         }
+         
+         // Don't give violations to emergency flights
+         phase = capturePhase(static_cast<uint8_t>(state), stateTime);
+         PhaseKernel<Kind>::injectViolation(phase, !hasActiveViolation && !isEmergency, rng);
+         applyPhase(phase, state, stateTime);
+     }
+     
+     // Raise a violation if the speed breaks the limits of a state that has not had one yet
+     template <uint8_t Kind>
+     void checkPhaseLimits(uint8_t code, int stateTime) {
+         const PhaseRule& rule = PHASE_RULES[Kind][code];
+         if (breaksPhaseLimits(rule, currentSpeed, stateTime, code, violatedPhases)) {
+             raiseViolation(rule.permittedMin, rule.permittedMax);
+         }
+     }
+     
+     static string phaseName(uint8_t kind, uint8_t code) {
+         return code < FLIGHT_PHASES ? PHASE_RULES[kind][code].name : "Unknown";
+     }
+     
+ private:
+     PhaseState capturePhase(uint8_t code, int stateTime) const {
+         return {currentSpeed, stateTime, violationSpeed, code, maintainViolationSpeed};
+     }
+     
+     template <typename State>
+     void applyPhase(const PhaseState& phase, State& state, int& stateTime) {
+         currentSpeed = phase.speed;
+         stateTime = phase.phaseTime;
+         violationSpeed = phase.violationSpeed;
+         state = static_cast<State>(phase.phase);
+         maintainViolationSpeed = phase.holdingViolationSpeed;
+     }
+     
+ public:
+     int id;
+     string flightNumber;
+     string airline;
+     uint32_t airlineId; // Index into the scheduler's airlines, set when the flight is generated
+     FlightType type;
+     Direction direction;
+     int priority;
+     int currentSpeed;
+     bool hasActiveViolation;
+     shared_ptr<AVN> currentViolation;
+     
+     // Keep new AVN ids above ids restored from a journal
+     static void reserveAvnIds(int highestUsed) {
+         nextAvnId = max(nextAvnId, highestUsed + 1);
+     }
+     
+     // Stop before issuing ids past highest, which belong to the next airport
+     static void limitAvnIds(int highest) {
+         lastAvnId = highest;
+     }
+     
+     // Next flight and AVN ids, saved and put back by checkpoints
+     static int getNextId() {
+         return nextId;
+     }
+     
+     static int getNextAvnId() {
+         return nextAvnId;
+     }
+     
+     static void restoreIdCounters(int flightId, int avnId) {
+         nextId = flightId;
+         nextAvnId = avnId;
+     }
+     chrono::system_clock::time_point scheduledTime;
+     chrono::system_clock::time_point actualTime;
+     Runway assignedRunway;
+     bool isEmergency;
+     // Add to Aircraft base class (around line 240) after the other member variables:
+
+// Track which states have already had violations (bit per state value)
+uint8_t violatedPhases = 0;
+// Add a new member variable to the Aircraft base class (around line 241)
+bool maintainViolationSpeed = false;
+int violationSpeed = 0;
+
+     // Row in the scheduler's FlightTable, -1 when the table is not in use
+     int tableRow = -1;
+     
+     // Simulation time the flight joined its runway queue
+     int queuedAt = 0;
+     
+     // Permissible range for the violation recorded by raiseViolation()
+     int violationMinSpeed = 0;
+     int violationMaxSpeed = 0;
+     
+     // This aircraft's own random stream (speeds and violation injection)
+     RandomStream rng;
+
+     Aircraft(const string& flightNumber, const string& airline, FlightType type, 
+              Direction direction, int priority, 
+              chrono::system_clock::time_point scheduledTime)
+         : id(nextId++), flightNumber(flightNumber), airline(airline), airlineId(0), type(type),
+           direction(direction), priority(priority), currentSpeed(0),
+           hasActiveViolation(false), scheduledTime(scheduledTime),
+           assignedRunway(Runway::NONE), isEmergency(false),
+           rng(simulationSeed, AIRCRAFT_STREAM_BASE + id) {}
+     
+     virtual ~Aircraft() {}
+     
+     void setEventListener(function<void(Aircraft&, FlightEvent)> listener) {
+         eventListener = move(listener);
+     }
+     
+     virtual void updateStatus(int simulationTime) = 0;
+     virtual void checkViolation() = 0;
+     virtual string getStateString() const = 0;
+     virtual bool isCompleted() const = 0;
+     
+     // Phases by number (the ArrivalState / DepartureState value), for checkpoints
+     virtual uint8_t getPhaseKind() const = 0; // First index into PHASE_RULES
+     virtual string getPhaseName(uint8_t code) const = 0;
+     virtual uint8_t getPhaseCode() const = 0;
+     virtual int getPhaseTime() const = 0; // Time spent in the current phase
+     virtual void restorePhase(uint8_t code, int time) = 0;
+     
+     string getRunwayString() const {
+         switch (assignedRunway) {
+             case Runway::RWY_A: return "RWY-A";
+             case Runway::RWY_B: return "RWY-B";
+             case Runway::RWY_C: return "RWY-C";
+             case Runway::NONE: return "None";
+             default: return "Unknown";
+         }
+     }
+     
+     string getDirectionString() const {
+         switch (direction) {
+             case Direction::NORTH: return "North";
+             case Direction::SOUTH: return "South";
+             case Direction::EAST: return "East";
+             case Direction::WEST: return "West";
+             default: return "Unknown";
+         }
+     }
+     
+     string getTypeString() const {
+         switch (type) {
+             case FlightType::COMMERCIAL: return "Commercial";
+             case FlightType::CARGO: return "Cargo";
+             case FlightType::EMERGENCY: return "Emergency";
+             default: return "Unknown";
+         }
+     }
+     
+     // Record a speed violation in the current state. Only touches this aircraft,
+     // so it is safe from a worker thread; the AVN itself is issued by issueAVN().
+     void raiseViolation(int minSpeed, int maxSpeed) {
+         hasActiveViolation = true;
+         violationMinSpeed = minSpeed;
+         violationMaxSpeed = maxSpeed;
+         
+         // Mark this state as one that has had a violation
+         violatedPhases |= (1u << getPhaseCode());
+     }
+     
+     // Issue the AVN for the violation recorded by raiseViolation()
+     void issueAVN() {
+         if (nextAvnId > lastAvnId) {
+             // Going on would hand out another airport's ids
+             LogLine(LogLevel::ERROR) << "AVN ids of this airport used up at #" << lastAvnId << ", stopping";
+             Logger::instance().flush();
+             abort();
+         }
+         currentViolation = makePooled<AVN>(
+             nextAvnId++, airline, flightNumber, type,
+             currentSpeed, violationMinSpeed, violationMaxSpeed
+         );
+         
+         LogLine(LogLevel::EVENT) << "\nVIOLATION DETECTED! Flight " << flightNumber 
+              << " (" << airline << ") - Speed: " << currentSpeed 
+              << " km/h in " << getStateString() << " state.";
+     }
+     
+     virtual string getSummary() const {
+         stringstream ss;
+         ss << flightNumber << " | " << airline << " | " << getTypeString() 
+            << " | " << getDirectionString() << " | " << getStateString()
+            << " | Speed: " << currentSpeed << " km/h | Runway: " << getRunwayString();
+         if (isEmergency) ss << " | EMERGENCY";
+         if (hasActiveViolation) ss << " | VIOLATION";
+         return ss.str();
+     }
+ };
+ 
+ int Aircraft::nextId = 1000;
+ int Aircraft::nextAvnId = 1000;
+ int Aircraft::lastAvnId = INT_MAX;
+ 
+ // Arrival Flight class
+ class ArrivalFlight : public Aircraft {
+     friend class FlightTable;
+     
+ private:
+     ArrivalState state;
+     int stateTime; // Time spent in current state
+     
+ public:
+     ArrivalFlight(const string& flightNumber, const string& airline, FlightType type, 
+                   Direction direction, int priority, 
+                   chrono::system_clock::time_point scheduledTime)
+         : Aircraft(flightNumber, airline, type, direction, priority, scheduledTime),
+           state(ArrivalState::HOLDING), stateTime(0) {
+         
+         // Set initial speed based on state
+         currentSpeed = PhaseKernel<ARRIVAL_PHASES>::initialSpeed(rng);
+     }
+     
+     ArrivalState getState() const {
+         return state;
+     }
+     
+     uint8_t getPhaseKind() const override {
+         return ARRIVAL_PHASES;
+     }
+     
+     string getPhaseName(uint8_t code) const override {
+         return phaseName(ARRIVAL_PHASES, code);
+     }
+     
+     string getStateString() const override {
+         return getPhaseName(static_cast<uint8_t>(state));
+     }
+     
+     uint8_t getPhaseCode() const override {
+         return static_cast<uint8_t>(state);
+     }
+     
+     int getPhaseTime() const override {
+         return stateTime;
+     }
+     
+     void restorePhase(uint8_t code, int time) override {
+         state = static_cast<ArrivalState>(code);
+         stateTime = time;
+     }
+     
+     // Phase durations, speeds and limits come from PHASE_RULES
+     void updateStatus(int simulationTime) override {
+         runPhaseTick<ARRIVAL_PHASES>(state, stateTime);
+         
+         // Check for violations
+         checkViolation();
+     }
+     
+     void checkViolation() override {
+         checkPhaseLimits<ARRIVAL_PHASES>(static_cast<uint8_t>(state), stateTime);
+     }
+     
+     bool isCompleted() const override {
+         return state == ArrivalState::AT_GATE;
+     }
+ };
+ 
+ // Departure Flight class
+ class DepartureFlight : public Aircraft {
+     friend class FlightTable;
+     
+ private:
+     DepartureState state;
+     int stateTime; // Time spent in current state
+     
+ public:
+     DepartureFlight(const string& flightNumber, const string& airline, FlightType type, 
+                     Direction direction, int priority, 
+                     chrono::system_clock::time_point scheduledTime)
+         : Aircraft(flightNumber, airline, type, direction, priority, scheduledTime),
+           state(DepartureState::AT_GATE), stateTime(0) {
+         
+         // Initial speed at gate is 0
+         currentSpeed = PhaseKernel<DEPARTURE_PHASES>::initialSpeed(rng);
+     }
+     
+     DepartureState getState() const {
+         return state;
+     }
+     
+     uint8_t getPhaseKind() const override {
+         return DEPARTURE_PHASES;
+     }
+     
+     string getPhaseName(uint8_t code) const override {
+         return phaseName(DEPARTURE_PHASES, code);
+     }
+     
+     string getStateString() const override {
+         return getPhaseName(static_cast<uint8_t>(state));
+     }
+     
+     uint8_t getPhaseCode() const override {
+         return static_cast<uint8_t>(state);
+     }
+     
+     int getPhaseTime() const override {
+         return stateTime;
+     }
+     
+     void restorePhase(uint8_t code, int time) override {
+         state = static_cast<DepartureState>(code);
+         stateTime = time;
+     }
+     
+     // Phase durations, speeds and limits come from PHASE_RULES
+     void updateStatus(int simulationTime) override {
+         runPhaseTick<DEPARTURE_PHASES>(state, stateTime);
+         
+         // Check for violations
+         checkViolation();
+     }
+     
+     void checkViolation() override {
+         checkPhaseLimits<DEPARTURE_PHASES>(static_cast<uint8_t>(state), stateTime);
+     }
+     
+     bool isCompleted() const override {
+         return state == DepartureState::CRUISE;
+     }
+ };
+ 
+ // Structure-of-arrays flight table for large fleets. The per-tick phase update
+ // runs over contiguous columns instead of calling the virtual updateStatus() on
+ // every heap-allocated Aircraft. Each row still has an owning Aircraft object,
+ // but it is only written back when the row's speed, state or violation changes.
+ class FlightTable {
+ public:
+     enum Kind : uint8_t { ARRIVAL = 0, DEPARTURE = 1 };
+     
+     // Row flags
+     enum : uint8_t {
+         FLAG_EMERGENCY = 1,
+         FLAG_ACTIVE_VIOLATION = 2,
+         FLAG_MAINTAIN_SPEED = 4
+     };
+     
+     // What changed in a row during the last update()
+     enum : uint8_t {
+         CHANGED_SPEED = 1,
+         CHANGED_STATE = 2,
+         CHANGED_VIOLATION = 4
+     };
+     
+     // Final state code for both kinds (ArrivalState::AT_GATE, DepartureState::CRUISE)
+     static constexpr uint8_t FINAL_STATE = FLIGHT_PHASES - 1;
+     
+ private:
+     // Hot columns, one entry per row
+     vector<int32_t> speed;
+     vector<uint8_t> kind;
+     vector<uint8_t> state;
+     vector<int32_t> stateTime;
+     vector<uint8_t> runway;
+     vector<uint8_t> priority;
+     vector<uint8_t> flags;
+     vector<int32_t> violationSpeed;
+     vector<uint8_t> violatedMask; // Bit per state that already had a violation
+     vector<RandomStream> rng; // The owning aircraft's stream, advanced here instead
+     
+     // Speed range the row's current phase allows this tick, or the whole int
+     // range once the phase has had its violation
+     vector<int32_t> checkMin;
+     vector<int32_t> checkMax;
+     
+     // Per-row output of the last update()
+     vector<uint8_t> changes;
+     vector<uint64_t> violators; // Bit per row that broke its limits
+     vector<uint32_t> changedRows;
+     vector<vector<uint32_t>> workerChangedRows;
+     
+     // Cold side
+     vector<Aircraft*> owner;
+     
+     // Same rules as Aircraft::runPhaseTick(), on the row's columns
+     template <uint8_t Kind>
+     void updateRow(size_t row) {
+         PhaseState phase = {speed[row], stateTime[row], violationSpeed[row], state[row],
+                             (flags[row] & FLAG_MAINTAIN_SPEED) != 0};
+         int32_t previousSpeed = phase.speed;
+         uint8_t change = 0;
+         
+         if (PhaseKernel<Kind>::advance(phase, runway[row] != static_cast<uint8_t>(Runway::NONE), rng[row])) {
+             change |= CHANGED_STATE;
+         }
+         PhaseKernel<Kind>::injectViolation(phase, !(flags[row] & (FLAG_ACTIVE_VIOLATION | FLAG_EMERGENCY)), rng[row]);
+         if (phase.speed != previousSpeed) {
+             change |= CHANGED_SPEED;
+         }
+         
+         speed[row] = phase.speed;
+         stateTime[row] = phase.phaseTime;
+         violationSpeed[row] = phase.violationSpeed;
+         state[row] = phase.phase;
+         flags[row] = phase.holdingViolationSpeed ? (flags[row] | FLAG_MAINTAIN_SPEED)
+                                                  : (flags[row] & ~FLAG_MAINTAIN_SPEED);
+         changes[row] = change;
+         
+         const PhaseRule& rule = PhaseKernel<Kind>::rules[phase.phase];
+         bool checked = ((violatedMask[row] >> phase.phase) & 1u) == 0;
+         checkMin[row] = checked ? rule.checkMin : INT_MIN;
+         checkMax[row] = !checked ? INT_MAX : (phase.phaseTime >= rule.duration ? rule.endMax : rule.checkMax);
+     }
+     
+     // Rows of bitmap words [firstWord, lastWord): phase update, then the speed
+     // check for all of them in one vector pass, then the list of changed rows
+     void updateRows(size_t firstWord, size_t lastWord, vector<uint32_t>& changed) {
+         size_t begin = firstWord * VIOLATION_BITMAP_ROWS;
+         size_t end = min(size(), lastWord * VIOLATION_BITMAP_ROWS);
+         
+         for (size_t row = begin; row < end; row++) {
+             if (kind[row] == ARRIVAL) {
+                 updateRow<ARRIVAL_PHASES>(row);
+             } else {
+                 updateRow<DEPARTURE_PHASES>(row);
+             }
+         }
+         
+         for (size_t word = firstWord; word < lastWord; word++) {
+             size_t first = word * VIOLATION_BITMAP_ROWS;
+             size_t count = min(VIOLATION_BITMAP_ROWS, end - first);
+             violators[word] = speedViolationBits(&speed[first], &checkMin[first], &checkMax[first], count);
+         }
+         
+         for (size_t row = begin; row < end; row++) {
+             if ((violators[row / VIOLATION_BITMAP_ROWS] >> (row % VIOLATION_BITMAP_ROWS)) & 1u) {
+                 changes[row] |= CHANGED_VIOLATION;
+             }
+             if (changes[row]) {
+                 changed.push_back(static_cast<uint32_t>(row));
+             }
+         }
+     }
+     
+     void moveRow(size_t from, size_t to) {
+         speed[to] = speed[from];
+         kind[to] = kind[from];
+         state[to] = state[from];
+         stateTime[to] = stateTime[from];
+         runway[to] = runway[from];
+         priority[to] = priority[from];
+         flags[to] = flags[from];
+         violationSpeed[to] = violationSpeed[from];
+         violatedMask[to] = violatedMask[from];
+         rng[to] = rng[from];
+         owner[to] = owner[from];
+         owner[to]->tableRow = static_cast<int>(to);
+     }
+     
+     void resizeColumns(size_t rows) {
+         speed.resize(rows);
+         kind.resize(rows);
+         state.resize(rows);
+         stateTime.resize(rows);
+         runway.resize(rows);
+         priority.resize(rows);
+         flags.resize(rows);
+         violationSpeed.resize(rows);
+         violatedMask.resize(rows);
+         rng.resize(rows);
+         checkMin.resize(rows);
+         checkMax.resize(rows);
+         changes.resize(rows);
+         owner.resize(rows);
+     }
+     
+ public:
+     size_t size() const {
+         return owner.size();
+     }
+     
+     // Append a newly created flight, copying its current fields into the columns
+     void add(Aircraft& aircraft) {
+         size_t row = size();
+         resizeColumns(row + 1);
+         
+         ArrivalFlight* arrival = dynamic_cast<ArrivalFlight*>(&aircraft);
+         DepartureFlight* departure = arrival ? nullptr : static_cast<DepartureFlight*>(&aircraft);
+         
+         speed[row] = aircraft.currentSpeed;
+         kind[row] = arrival ? ARRIVAL : DEPARTURE;
+         state[row] = arrival ? static_cast<uint8_t>(arrival->state) : static_cast<uint8_t>(departure->state);
+         stateTime[row] = arrival ? arrival->stateTime : departure->stateTime;
+         runway[row] = static_cast<uint8_t>(aircraft.assignedRunway);
+         priority[row] = static_cast<uint8_t>(aircraft.priority);
+         flags[row] = (aircraft.isEmergency ? FLAG_EMERGENCY : 0) |
+                      (aircraft.hasActiveViolation ? FLAG_ACTIVE_VIOLATION : 0) |
+                      (aircraft.maintainViolationSpeed ? FLAG_MAINTAIN_SPEED : 0);
+         violationSpeed[row] = aircraft.violationSpeed;
+         violatedMask[row] = aircraft.violatedPhases;
+         rng[row] = aircraft.rng;
+         changes[row] = 0;
+         owner[row] = &aircraft;
+         aircraft.tableRow = static_cast<int>(row);
+     }
+     
+     // Advance every row by one tick. Rows whose speed, state or violation status
+     // changed are listed in getChangedRows() for write-back, in row order, and
+     // the new violators in getViolators().
+     // With a pool the bitmap words are split across its threads; each row only
+     // touches its own columns, so the result is the same as a serial pass.
+     void update(ThreadPool* pool = nullptr) {
+         changedRows.clear();
+         size_t words = (size() + VIOLATION_BITMAP_ROWS - 1) / VIOLATION_BITMAP_ROWS;
+         violators.resize(words);
+         
+         if (!pool) {
+             updateRows(0, words, changedRows);
+             return;
+         }
+         
+         workerChangedRows.resize(pool->size());
+         pool->parallelFor(words, [this](size_t begin, size_t end) {
+             vector<uint32_t>& changed = workerChangedRows[ThreadPool::currentWorker()];
+             changed.clear();
+             updateRows(begin, end, changed);
+         });
+         
+         for (auto& changed : workerChangedRows) {
+             changedRows.insert(changedRows.end(), changed.begin(), changed.end());
+             changed.clear();
+         }
+     }
+     
+     const vector<uint32_t>& getChangedRows() const {
+         return changedRows;
+     }
+     
+     uint8_t getChanges(size_t row) const {
+         return changes[row];
+     }
+     
+     // Bit per row (VIOLATION_BITMAP_ROWS rows per word) that had a new violation in the last update()
+     const vector<uint64_t>& getViolators() const {
+         return violators;
+     }
+     
+     // Permissible range written on the AVN for the row's current state
+     int32_t getLimitMin(size_t row) const {
+         return PHASE_RULES[kind[row]][state[row]].permittedMin;
+     }
+     
+     int32_t getLimitMax(size_t row) const {
+         return PHASE_RULES[kind[row]][state[row]].permittedMax;
+     }
+     
+     Aircraft& getOwner(size_t row) const {
+         return *owner[row];
+     }
+     
+     // Copy a row's hot fields back into its Aircraft and return it
+     Aircraft& writeBack(size_t row) {
+         Aircraft& aircraft = *owner[row];
+         aircraft.currentSpeed = speed[row];
+         aircraft.maintainViolationSpeed = flags[row] & FLAG_MAINTAIN_SPEED;
+         aircraft.violationSpeed = violationSpeed[row];
+         aircraft.rng = rng[row];
+         
+         if (kind[row] == ARRIVAL) {
+             ArrivalFlight& arrival = static_cast<ArrivalFlight&>(aircraft);
+             arrival.state = static_cast<ArrivalState>(state[row]);
+             arrival.stateTime = stateTime[row];
+         } else {
+             DepartureFlight& departure = static_cast<DepartureFlight&>(aircraft);
+             departure.state = static_cast<DepartureState>(state[row]);
+             departure.stateTime = stateTime[row];
+         }
+         return aircraft;
+     }
+     
+     // Bring every Aircraft up to date, including fields only the table advanced
+     // (time in phase, random stream) on rows that did not change
+     void writeBackAll() {
+         for (size_t row = 0; row < size(); row++) {
+             writeBack(row);
+         }
+     }
+     
+     // Event the owning Aircraft would have raised for the row's new state
+     bool clearedRunway(size_t row) const {
+         return (changes[row] & CHANGED_STATE) && PHASE_RULES[kind[row]][state[row]].clearsRunway;
+     }
+     
+     bool reachedFinalState(size_t row) const {
+         return (changes[row] & CHANGED_STATE) && state[row] == FINAL_STATE;
+     }
+     
+     // Keep the row in step with an AVN raised on (and possibly already cleared from) its Aircraft
+     void recordViolation(size_t row) {
+         violatedMask[row] |= (1u << state[row]);
+         if (owner[row]->hasActiveViolation) {
+             flags[row] |= FLAG_ACTIVE_VIOLATION;
+         } else {
+             flags[row] &= ~FLAG_ACTIVE_VIOLATION;
+         }
+     }
+     
+     void setRunway(size_t row, Runway value) {
+         runway[row] = static_cast<uint8_t>(value);
+     }
+     
+     // Drop rows in their final state, keeping the remaining rows in order
+     void removeCompleted() {
+         size_t kept = 0;
+         size_t rows = size();
+         
+         for (size_t row = 0; row < rows; row++) {
+             if (state[row] == FINAL_STATE) {
+                 owner[row]->tableRow = -1;
+                 continue;
+             }
+             if (kept != row) {
+                 moveRow(row, kept);
+             }
+             kept++;
+         }
+         resizeColumns(kept);
+     }
+     
+     // Current phase of a row; the owning Aircraft only sees it after a write-back
+     uint8_t getState(size_t row) const {
+         return state[row];
+     }
+     
+     int32_t getStateTime(size_t row) const {
+         return stateTime[row];
+     }
+ };
+ 
+ // Runway queue: binary heap of waiting aircraft plus a flight id -> heap slot index.
+ // Insert, remove-top and removal of any queued flight are all O(log n),
+ // so the queue never has to be drained and rebuilt to dispatch one aircraft.
+ template <typename Compare>
+ class RunwayQueue {
+ private:
+     vector<shared_ptr<Aircraft>> heap;
+     unordered_map<int, size_t> slotOf; // Aircraft id -> position in heap
+     Compare compare; // compare(a, b) is true when a ranks below b
+
+     void place(size_t slot) {
+         slotOf[heap[slot]->id] = slot;
+     }
+
+     void swapSlots(size_t a, size_t b) {
+         swap(heap[a], heap[b]);
+         place(a);
+         place(b);
+     }
+
+     void siftUp(size_t slot) {
+         while (slot > 0) {
+             size_t parent = (slot - 1) / 2;
+             if (!compare(heap[parent], heap[slot])) {
+                 break;
+             }
+             swapSlots(parent, slot);
+             slot = parent;
+         }
+     }
+
+     void siftDown(size_t slot) {
+         while (true) {
+             size_t left = 2 * slot + 1;
+             size_t right = left + 1;
+             size_t best = slot;
+
+             if (left < heap.size() && compare(heap[best], heap[left])) {
+                 best = left;
+             }
+             if (right < heap.size() && compare(heap[best], heap[right])) {
+                 best = right;
+             }
+             if (best == slot) {
+                 break;
+             }
+             swapSlots(slot, best);
+             slot = best;
+         }
+     }
+
+     void removeSlot(size_t slot) {
+         slotOf.erase(heap[slot]->id);
+         size_t last = heap.size() - 1;
+
+         if (slot != last) {
+             heap[slot] = move(heap[last]);
+             heap.pop_back();
+             place(slot);
+             siftDown(slot);
+             siftUp(slot);
+         } else {
+             heap.pop_back();
+         }
+     }
+
+ public:
+     bool empty() const {
+         return heap.empty();
+     }
+
+     size_t size() const {
+         return heap.size();
+     }
+
+     const shared_ptr<Aircraft>& top() const {
+         return heap.front();
+     }
+
+     void push(const shared_ptr<Aircraft>& aircraft) {
+         heap.push_back(aircraft);
+         place(heap.size() - 1);
+         siftUp(heap.size() - 1);
+     }
+
+     void pop() {
+         removeSlot(0);
+     }
+
+     bool contains(int flightId) const {
+         return slotOf.count(flightId) > 0;
+     }
+     
+     // Waiting aircraft in heap order; pushing them back in this order rebuilds the same heap
+     const vector<shared_ptr<Aircraft>>& items() const {
+         return heap;
+     }
+     
+     // Append the count best-ranked aircraft, best first, without touching the heap.
+     // Walks the heap down from the root, so it costs O(count log count) at any queue size.
+     void top(size_t count, vector<shared_ptr<Aircraft>>& out) const {
+         auto ranksBelow = [this](size_t a, size_t b) { return compare(heap[a], heap[b]); };
+         priority_queue<size_t, vector<size_t>, decltype(ranksBelow)> frontier(ranksBelow);
+         if (!heap.empty()) {
+             frontier.push(0);
+         }
+         while (count > 0 && !frontier.empty()) {
+             size_t slot = frontier.top();
+             frontier.pop();
+             out.push_back(heap[slot]);
+             count--;
+             for (size_t child = 2 * slot + 1; child <= 2 * slot + 2 && child < heap.size(); child++) {
+                 frontier.push(child);
+             }
+         }
+     }
+
+     // Take a flight out from anywhere in the queue, returns false if it is not in this queue
+     bool remove(int flightId) {
+         auto it = slotOf.find(flightId);
+         if (it == slotOf.end()) {
+             return false;
+         }
+         removeSlot(it->second);
+         return true;
+     }
+ };
+
+ // Tick intervals reserved on one runway by the lookahead planner, [start, end)
+ // and sorted by start. Intervals never overlap; a flight is placed in the
+ // first gap after it is ready that is long enough for its whole movement.
+ class RunwaySlots {
+ private:
+     vector<pair<int, int>> reserved;
+     int freeFrom; // Tick the runway's current occupant (if any) makes it free
+     
+ public:
+     RunwaySlots() : freeFrom(0) {}
+     
+     void reset(int freeAt) {
+         reserved.clear();
+         freeFrom = freeAt;
+     }
+     
+     // Earliest start at or after from with length free ticks
+     int earliestFit(int from, int length) const {
+         int start = max(from, freeFrom);
+         for (const auto& slot : reserved) {
+             if (start + length <= slot.first) {
+                 break;
+             }
+             start = max(start, slot.second);
+         }
+         return start;
+     }
+     
+     void reserve(int start, int length) {
+         pair<int, int> slot(start, start + length);
+         reserved.insert(upper_bound(reserved.begin(), reserved.end(), slot), slot);
+     }
+     
+     // Forget intervals that are over by now
+     void expire(int now) {
+         reserved.erase(remove_if(reserved.begin(), reserved.end(),
+                                  [now](const pair<int, int>& slot) { return slot.second <= now; }),
+                        reserved.end());
+     }
+ };
+ 
+ // Status board that remembers the last frame it drew and only emits what changed
+ // since then. Rows are identified by key: scalar rows (time, counts, runway
+ // occupants, queue lengths) print their new value, list rows (flights, AVNs)
+ // are marked + added, ~ changed or - removed. Flight rows are rebuilt every
+ // frame; AVN rows are kept by the board itself and only touched on issue or
+ // payment, so only the first frame scans the AVN history. Before that nothing
+ // is kept, so a run that never draws the board holds no rows for it.
+ class StatusRenderer {
+ public:
+     enum Section { SUMMARY, RUNWAYS, QUEUES, FLIGHTS, AVNS, SECTION_COUNT };
+     
+ private:
+     struct Row {
+         Section section;
+         string text;
+         bool listed;
+     };
+     
+     // A kept row that was added or removed since the last frame
+     struct KeptChange {
+         Row row;
+         bool removed;
+     };
+     
+     vector<pair<string, Row>> frame;
+     map<string, Row> previous;
+     map<string, KeptChange> keptChanges;
+     map<string, Row> keptShown;
+     
+     double maxRate; // Frames per wall-clock second, 0 = no cap
+     chrono::steady_clock::time_point lastRender;
+     bool rendered;
+     
+     static const char* sectionTitle(Section section) {
+         switch (section) {
+             case RUNWAYS: return "\n--- RUNWAY STATUS ---";
+             case QUEUES: return "\n--- QUEUE STATUS ---";
+             case FLIGHTS: return "\n--- ACTIVE FLIGHTS ---";
+             case AVNS: return "\n--- ACTIVE AVNs ---";
+             default: return nullptr;
+         }
+     }
+     
+ public:
+     explicit StatusRenderer(double rate = 0.0) : maxRate(rate), rendered(false) {}
+     
+     // Whether a frame has been drawn; kept rows are only worth adding after that
+     bool drawn() const {
+         return rendered;
+     }
+     
+     // Whether enough wall-clock time has passed for another frame
+     bool due() const {
+         return !rendered || maxRate <= 0 ||
+                chrono::steady_clock::now() - lastRender >= chrono::duration<double>(1.0 / maxRate);
+     }
+     
+     void beginFrame() {
+         frame.clear();
+     }
+     
+     // Row whose new value replaces the old one
+     void set(Section section, const string& key, const string& text) {
+         frame.push_back({key, {section, text, false}});
+     }
+     
+     // Row in a list; rows missing from the next frame are reported as removed
+     void item(Section section, const string& key, const string& text) {
+         frame.push_back({key, {section, text, true}});
+     }
+     
+     // List row that stays on the board across frames until dropItem()
+     void keepItem(Section section, const string& key, const string& text) {
+         keptChanges[key] = {{section, text, true}, false};
+     }
+     
+     void dropItem(const string& key) {
+         auto shown = keptShown.find(key);
+         if (shown == keptShown.end()) {
+             keptChanges.erase(key); // Never drawn, nothing to take back
+             return;
+         }
+         keptChanges[key] = {shown->second, true};
+     }
+     
+     // Diff the frame against the last one drawn, returns the text to print
+     // (empty when nothing changed)
+     string endFrame() {
+         vector<vector<string>> lines(SECTION_COUNT);
+         const bool full = !rendered;
+         
+         map<string, Row> current;
+         for (const auto& entry : frame) {
+             const Row& row = entry.second;
+             auto old = previous.find(entry.first);
+             if (old == previous.end()) {
+                 lines[row.section].push_back(row.listed && !full ? "+ " + row.text : row.text);
+             } else if (old->second.text != row.text) {
+                 lines[row.section].push_back(row.listed ? "~ " + row.text : row.text);
+             }
+             current.emplace(entry.first, row);
+         }
+         for (const auto& old : previous) {
+             if (old.second.listed && !current.count(old.first)) {
+                 lines[old.second.section].push_back("- " + old.second.text);
+             }
+         }
+         
+         for (const auto& change : keptChanges) {
+             const Row& row = change.second.row;
+             if (change.second.removed) {
+                 lines[row.section].push_back("- " + row.text);
+                 keptShown.erase(change.first);
+             } else {
+                 lines[row.section].push_back(full ? row.text : "+ " + row.text);
+                 keptShown[change.first] = row;
+             }
+         }
+         keptChanges.clear();
+         
+         previous.swap(current);
+         rendered = true;
+         lastRender = chrono::steady_clock::now();
+         
+         bool changed = false;
+         for (const auto& section : lines) {
+             changed = changed || !section.empty();
+         }
+         if (!changed) {
+             return "";
+         }
+         
+         ostringstream out;
+         out << (full ? "\n======== AIRCONTROLX STATUS ========" : "\n======== AIRCONTROLX STATUS (changes) ========") << '\n';
+         for (int section = 0; section < SECTION_COUNT; section++) {
+             if (lines[section].empty()) {
+                 continue;
+             }
+             if (const char* title = sectionTitle(static_cast<Section>(section))) {
+                 out << title << '\n';
+             }
+             for (const auto& line : lines[section]) {
+                 out << line << '\n';
+             }
+         }
+         out << "=====================================" << '\n';
+         return out.str();
+     }
+ };
+
+ // Columnar store of every AVN for the analytics dashboard. Each field lives in
+ // its own contiguous array (one row per AVN, in issue order), airline and
+ // phase names are interned to small ids, and every aggregate is a plain scan
+ // over the columns it needs, so the loops stay branch-free and vectorize.
+ class AVNAnalytics {
+ public:
+     static constexpr int EXCESS_BUCKET_KMH = 25; // Width of one speed-excess histogram bucket
+     static constexpr int EXCESS_BUCKETS = 8;     // The last bucket also takes everything above it
+     
+     struct AirlineTotals {
+         string airline;
+         int violations;
+         int unpaid;
+         double outstanding;
+         double collected;
+     };
+     
+     struct Dashboard {
+         size_t rows;
+         vector<AirlineTotals> airlines;
+         vector<pair<string, int>> violationsByPhase;
+         int excessHistogram[EXCESS_BUCKETS];
+         int paidCount;
+         double meanLatency; // Simulated seconds from issue to payment
+         int p95Latency;
+         int maxLatency;
+         double buildMs;     // Time the scans took
+     };
+     
+ private:
+     static constexpr int32_t NO_TICK = -1;
+     
+     vector<uint16_t> airlineColumn;
+     vector<uint8_t> typeColumn;
+     vector<uint8_t> phaseColumn;
+     vector<int32_t> speedColumn;
+     vector<int32_t> minSpeedColumn;
+     vector<int32_t> maxSpeedColumn;
+     vector<double> amountColumn;
+     vector<uint8_t> paidColumn;      // 1 once paid
+     vector<int32_t> issueTickColumn; // Simulation time of issue, NO_TICK for restored rows
+     vector<int32_t> paidTickColumn;  // Simulation time of payment, NO_TICK until paid
+     
+     unordered_map<int, uint32_t> rowOfAVN;
+     StringInterner airlineNames;
+     StringInterner phaseNames;
+     
+ public:
+     size_t size() const {
+         return airlineColumn.size();
+     }
+     
+     // Add a row for avn; issueTick < 0 when the issue time is unknown (restored).
+     // paidTick is only given for a row coming back from a checkpoint.
+     void recordIssued(const AVN& avn, const string& phase, int issueTick, int paidTick = NO_TICK) {
+         rowOfAVN[avn.id] = static_cast<uint32_t>(airlineColumn.size());
+         airlineColumn.push_back(static_cast<uint16_t>(airlineNames.intern(avn.airline)));
+         typeColumn.push_back(static_cast<uint8_t>(avn.aircraftType));
+         phaseColumn.push_back(static_cast<uint8_t>(phaseNames.intern(phase)));
+         speedColumn.push_back(avn.recordedSpeed);
+         minSpeedColumn.push_back(avn.permissibleSpeedMin);
+         maxSpeedColumn.push_back(avn.permissibleSpeedMax);
+         amountColumn.push_back(avn.totalAmount);
+         paidColumn.push_back(avn.status == PaymentStatus::PAID ? 1 : 0);
+         issueTickColumn.push_back(issueTick < 0 ? NO_TICK : issueTick);
+         paidTickColumn.push_back(paidTick < 0 ? NO_TICK : paidTick);
+     }
+     
+     // Phase and ticks of an AVN's row, for checkpoints; false if it has none
+     bool getTimeline(int avnId, string& phase, int& issueTick, int& paidTick) const {
+         auto it = rowOfAVN.find(avnId);
+         if (it == rowOfAVN.end()) {
+             return false;
+         }
+         phase = phaseNames.resolve(phaseColumn[it->second]);
+         issueTick = issueTickColumn[it->second];
+         paidTick = paidTickColumn[it->second];
+         return true;
+     }
+     
+     void recordAmount(int avnId, double totalAmount) {
+         auto it = rowOfAVN.find(avnId);
+         if (it != rowOfAVN.end()) {
+             amountColumn[it->second] = totalAmount;
+         }
+     }
+     
+     void recordPaid(int avnId, int paidTick) {
+         auto it = rowOfAVN.find(avnId);
+         if (it == rowOfAVN.end() || paidColumn[it->second]) {
+             return;
+         }
+         paidColumn[it->second] = 1;
+         paidTickColumn[it->second] = paidTick;
+     }
+     
+     Dashboard build() const {
+         auto start = chrono::steady_clock::now();
+         const size_t rows = size();
+         Dashboard dashboard;
+         dashboard.rows = rows;
+         
+         // Per-airline totals: one pass over the airline, amount and paid columns
+         const size_t airlineCount = airlineNames.size();
+         vector<int> violations(airlineCount, 0);
+         vector<int> unpaid(airlineCount, 0);
+         vector<double> outstanding(airlineCount, 0.0);
+         vector<double> collected(airlineCount, 0.0);
+         for (size_t i = 0; i < rows; i++) {
+             const uint16_t airline = airlineColumn[i];
+             const int isPaid = paidColumn[i];
+             violations[airline]++;
+             unpaid[airline] += 1 - isPaid;
+             outstanding[airline] += amountColumn[i] * (1 - isPaid);
+             collected[airline] += amountColumn[i] * isPaid;
+         }
+         for (size_t a = 0; a < airlineCount; a++) {
+             dashboard.airlines.push_back({airlineNames.resolve(a), violations[a], unpaid[a], outstanding[a], collected[a]});
+         }
+         sort(dashboard.airlines.begin(), dashboard.airlines.end(),
+              [](const AirlineTotals& a, const AirlineTotals& b) { return a.outstanding > b.outstanding; });
+         
+         // Violations per flight phase
+         vector<int> byPhase(phaseNames.size(), 0);
+         for (size_t i = 0; i < rows; i++) {
+             byPhase[phaseColumn[i]]++;
+         }
+         for (size_t p = 0; p < byPhase.size(); p++) {
+             dashboard.violationsByPhase.push_back({phaseNames.resolve(p), byPhase[p]});
+         }
+         
+         // How far outside the permissible range each AVN was. Computing the
+         // bucket index is a branch-free elementwise pass; the counting after it
+         // runs over a byte column.
+         vector<uint8_t> bucket(rows);
+         for (size_t i = 0; i < rows; i++) {
+             int32_t over = speedColumn[i] - maxSpeedColumn[i];
+             int32_t under = minSpeedColumn[i] - speedColumn[i];
+             int32_t excess = max(0, max(over, under));
+             bucket[i] = static_cast<uint8_t>(min(excess / EXCESS_BUCKET_KMH, EXCESS_BUCKETS - 1));
+         }
+         fill(begin(dashboard.excessHistogram), end(dashboard.excessHistogram), 0);
+         for (size_t i = 0; i < rows; i++) {
+             dashboard.excessHistogram[bucket[i]]++;
+         }
+         
+         // Payment latency over rows with both an issue and a payment time
+         vector<int32_t> latencies;
+         long long latencySum = 0;
+         for (size_t i = 0; i < rows; i++) {
+             if (paidTickColumn[i] != NO_TICK && issueTickColumn[i] != NO_TICK) {
+                 int32_t latency = paidTickColumn[i] - issueTickColumn[i];
+                 latencies.push_back(latency);
+                 latencySum += latency;
+             }
+         }
+         dashboard.paidCount = 0;
+         for (size_t i = 0; i < rows; i++) {
+             dashboard.paidCount += paidColumn[i];
+         }
+         dashboard.meanLatency = latencies.empty() ? 0.0 : static_cast<double>(latencySum) / latencies.size();
+         dashboard.p95Latency = 0;
+         dashboard.maxLatency = 0;
+         if (!latencies.empty()) {
+             size_t p95 = (latencies.size() * 95) / 100;
+             nth_element(latencies.begin(), latencies.begin() + p95, latencies.end());
+             dashboard.p95Latency = latencies[p95];
+             dashboard.maxLatency = *max_element(latencies.begin(), latencies.end());
+         }
+         
+         dashboard.buildMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+         return dashboard;
+     }
+     
+     void printDashboard() const {
+         Dashboard dashboard = build();
+         
+         lock_guard<mutex> lock(cout_mutex);
+         cout << "\n======== AVN ANALYTICS ========" << endl;
+         cout << "AVNs: " << dashboard.rows << " | Paid: " << dashboard.paidCount
+              << " | Built in " << fixed << setprecision(3) << dashboard.buildMs << " ms" << endl;
+         
+         cout << "\n--- Outstanding by Airline ---" << endl;
+         for (const auto& totals : dashboard.airlines) {
+             cout << left << setw(24) << totals.airline << right
+                  << " | AVNs: " << setw(6) << totals.violations
+                  << " | Unpaid: " << setw(6) << totals.unpaid
+                  << " | Outstanding: PKR " << fixed << setprecision(2) << setw(14) << totals.outstanding
+                  << " | Collected: PKR " << setw(14) << totals.collected << endl;
+         }
+         
+         cout << "\n--- Violations by Phase ---" << endl;
+         for (const auto& phase : dashboard.violationsByPhase) {
+             cout << left << setw(14) << phase.first << right << " | " << phase.second << endl;
+         }
+         
+         cout << "\n--- Speed Excess (km/h) ---" << endl;
+         for (int b = 0; b < EXCESS_BUCKETS; b++) {
+             ostringstream range;
+             range << b * EXCESS_BUCKET_KMH;
+             if (b + 1 < EXCESS_BUCKETS) {
+                 range << "-" << (b + 1) * EXCESS_BUCKET_KMH - 1;
+             } else {
+                 range << "+";
+             }
+             cout << left << setw(10) << range.str() << right << " | " << dashboard.excessHistogram[b] << endl;
+         }
+         
+         cout << "\n--- Payment Latency (simulated seconds) ---" << endl;
+         cout << "Mean: " << fixed << setprecision(1) << dashboard.meanLatency
+              << " | p95: " << dashboard.p95Latency << " | Max: " << dashboard.maxLatency << endl;
+         cout << "===============================" << endl;
+     }
+ };
+ 
+ // -------- CHECKPOINTS --------
+ 
+ // Byte image of a checkpoint: plain values exactly as they sit in memory,
+ // strings and vectors with their length in front
+ class CheckpointWriter {
+ private:
+     string data;
+     
+ public:
+     template <typename T>
+     void put(const T& value) {
+         static_assert(is_trivially_copyable<T>::value, "checkpoint values are copied as bytes");
+         data.append(reinterpret_cast<const char*>(&value), sizeof(value));
+     }
+     
+     void putString(const string& value) {
+         put(static_cast<uint32_t>(value.size()));
+         data.append(value);
+     }
+     
+     template <typename T>
+     void putVector(const vector<T>& values) {
+         static_assert(is_trivially_copyable<T>::value, "checkpoint values are copied as bytes");
+         put(static_cast<uint64_t>(values.size()));
+         data.append(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+     }
+     
+     const string& bytes() const {
+         return data;
+     }
+ };
+ 
+ // Reads an image back in the order it was written. Reading past the end marks
+ // the reader failed and yields zeroes, so a restore only checks ok() at the end.
+ class CheckpointReader {
+ private:
+     const char* bytes;
+     size_t size;
+     size_t offset;
+     bool failed;
+     
+ public:
+     CheckpointReader(const char* data, size_t length) : bytes(data), size(length), offset(0), failed(false) {}
+     
+     bool ok() const {
+         return !failed;
+     }
+     
+     bool atEnd() const {
+         return offset == size;
+     }
+     
+     // Whether count items of at least bytesEach could still be in the image
+     bool fits(uint64_t count, size_t bytesEach) {
+         if (failed || count > (size - offset) / max<size_t>(bytesEach, 1)) {
+             failed = true;
+         }
+         return !failed;
+     }
+     
+     template <typename T>
+     T get() {
+         static_assert(is_trivially_copyable<T>::value, "checkpoint values are copied as bytes");
+         T value = T();
+         if (fits(1, sizeof(T))) {
+             memcpy(&value, bytes + offset, sizeof(T));
+             offset += sizeof(T);
+         }
+         return value;
+     }
+     
+     string getString() {
+         uint32_t length = get<uint32_t>();
+         if (!fits(length, 1)) {
+             return string();
+         }
+         string value(bytes + offset, length);
+         offset += length;
+         return value;
+     }
+     
+     template <typename T>
+     void getVector(vector<T>& values) {
+         uint64_t count = get<uint64_t>();
+         values.clear();
+         if (fits(count, sizeof(T))) {
+             values.resize(count);
+             memcpy(values.data(), bytes + offset, count * sizeof(T));
+             offset += count * sizeof(T);
+         }
+     }
+ };
+ 
+ // A checkpoint file: a header, then the image the scheduler wrote. Opened by
+ // mapping it privately, so branch processes forked after open() share its
+ // pages copy-on-write instead of each reading their own copy.
+ class CheckpointImage {
+ private:
+     struct FileHeader {
+         uint32_t magic;
+         uint32_t version;
+         uint64_t seed;         // Run seed the image was taken under
+         uint64_t imageBytes;
+         uint32_t checksum;     // FNV-1a over the image
+         int32_t simulationTime;
+     };
+     
+     static constexpr uint32_t CHECKPOINT_MAGIC = 0x43584341; // "ACXC"
+     static constexpr uint32_t CHECKPOINT_VERSION = 2;
+     
+     void* mapping;
+     size_t mappedBytes;
+     FileHeader header;
+     
+     static uint32_t checksumOf(const char* bytes, size_t size) {
+         uint32_t hash = 2166136261u;
+         for (size_t i = 0; i < size; i++) {
+             hash = (hash ^ static_cast<unsigned char>(bytes[i])) * 16777619u;
+         }
+         return hash;
+     }
+     
+ public:
+     CheckpointImage() : mapping(nullptr), mappedBytes(0) {
+         memset(&header, 0, sizeof(header));
+     }
+     
+     ~CheckpointImage() {
+         if (mapping) {
+             munmap(mapping, mappedBytes);
+         }
+     }
+     
+     // Write image to a temporary name and rename it over path, so a crash never
+     // leaves half a checkpoint behind
+     static bool write(const string& path, const CheckpointWriter& image, int simulationTime, string& error) {
+         FileHeader fileHeader;
+         memset(&fileHeader, 0, sizeof(fileHeader));
+         fileHeader.magic = CHECKPOINT_MAGIC;
+         fileHeader.version = CHECKPOINT_VERSION;
+         fileHeader.seed = simulationSeed;
+         fileHeader.imageBytes = image.bytes().size();
+         fileHeader.checksum = checksumOf(image.bytes().data(), image.bytes().size());
+         fileHeader.simulationTime = simulationTime;
+         
+         string temporary = path + ".tmp";
+         {
+             ofstream file(temporary, ios::binary | ios::trunc);
+             file.write(reinterpret_cast<const char*>(&fileHeader), sizeof(fileHeader));
+             file.write(image.bytes().data(), image.bytes().size());
+             if (!file) {
+                 error = strerror(errno);
+                 return false;
+             }
+         }
+         if (rename(temporary.c_str(), path.c_str()) == -1) {
+             error = strerror(errno);
+             return false;
+         }
+         return true;
+     }
+     
+     bool open(const string& path, string& error) {
+         int file = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+         if (file == -1) {
+             error = strerror(errno);
+             return false;
+         }
+         struct stat info;
+         fstat(file, &info);
+         size_t size = info.st_size;
+         if (size < sizeof(header)) {
+             ::close(file);
+             error = "too short for a checkpoint";
+             return false;
+         }
+         
+         void* region = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+         ::close(file);
+         if (region == MAP_FAILED) {
+             error = strerror(errno);
+             return false;
+         }
+         memcpy(&header, region, sizeof(header));
+         if (header.magic != CHECKPOINT_MAGIC || header.version != CHECKPOINT_VERSION ||
+             header.imageBytes != size - sizeof(header)) {
+             munmap(region, size);
+             error = "not a checkpoint of this version";
+             return false;
+         }
+         if (checksumOf(static_cast<const char*>(region) + sizeof(header), header.imageBytes) != header.checksum) {
+             munmap(region, size);
+             error = "checksum mismatch";
+             return false;
+         }
+         mapping = region;
+         mappedBytes = size;
+         return true;
+     }
+     
+     uint64_t getSeed() const {
+         return header.seed;
+     }
+     
+     int getSimulationTime() const {
+         return header.simulationTime;
+     }
+     
+     CheckpointReader reader() const {
+         return CheckpointReader(static_cast<const char*>(mapping) + sizeof(header), header.imageBytes);
+     }
+ };
+ 
+ // -------- TRAFFIC SOURCES --------
+ 
+ // One scheduled movement, as a traffic source hands it to the scheduler
+ struct FlightPlan {
+     static constexpr uint32_t UNKNOWN_AIRLINE = UINT32_MAX;
+     
+     int time;            // Simulation second it joins its runway queue
+     Direction direction; // North/South arrive on RWY-A, East/West depart from RWY-B
+     FlightType type;
+     bool emergency;
+     uint32_t airlineId;  // Scheduler's airline id, or UNKNOWN_AIRLINE to look up airline by name
+     string airline;
+     string flightNumber; // Empty = the airline's prefix plus a sequence number
+     
+     FlightPlan() : time(0), direction(Direction::NORTH), type(FlightType::COMMERCIAL), emergency(false),
+                    airlineId(UNKNOWN_AIRLINE) {}
+ };
+ 
+ // Where new flights come from. The scheduler asks once per tick.
+ class TrafficSource {
+ public:
+     virtual ~TrafficSource() {}
+     
+     // Append every movement due at or before now, in schedule order
+     virtual void takeDue(int now, vector<FlightPlan>& plans) = 0;
+     
+     // How far the source has got, for checkpoints. A source without a cursor
+     // carries on from wherever it is when a checkpoint is restored.
+     virtual void saveCursor(vector<int64_t>& /*cursor*/) const {}
+     virtual void restoreCursor(const vector<int64_t>& /*cursor*/) {}
+ };
+ 
+ // The built-in traffic: one movement per direction at a fixed interval, each
+ // with a random airline from those that still fly and a chance of emergency
+ class IntervalTraffic : public TrafficSource {
+ private:
+     struct Stream {
+         Direction direction;
+         int interval;
+         int firstTime;            // Also spawns on this tick, so the run starts busy
+         int emergencyProbability; // Percent
+         AirlineKind emergencyKind; // Airline kind whose flights always fly as emergencies
+         int last;
+     };
+     
+     RandomStream& rng;
+     const vector<shared_ptr<Airline>>& airlines;
+     const vector<uint32_t>& spawningAirlines;
+     Stream streams[4];
+     
+ public:
+     IntervalTraffic(RandomStream& stream, const vector<shared_ptr<Airline>>& carriers, const vector<uint32_t>& spawning)
+         : rng(stream), airlines(carriers), spawningAirlines(spawning),
+           streams{{Direction::NORTH, ARRIVAL_NORTH_INTERVAL, 1, NORTH_EMERGENCY_PROBABILITY, AirlineKind::MILITARY, 0},
+                   {Direction::SOUTH, ARRIVAL_SOUTH_INTERVAL, 2, SOUTH_EMERGENCY_PROBABILITY, AirlineKind::MEDICAL, 0},
+                   {Direction::EAST, DEPARTURE_EAST_INTERVAL, 3, EAST_EMERGENCY_PROBABILITY, AirlineKind::MILITARY, 0},
+                   {Direction::WEST, DEPARTURE_WEST_INTERVAL, 4, WEST_EMERGENCY_PROBABILITY, AirlineKind::COMMERCIAL, 0}} {}
+     
+     void takeDue(int now, vector<FlightPlan>& plans) override {
+         for (Stream& stream : streams) {
+             if (now - stream.last < stream.interval && now != stream.firstTime) {
+                 continue;
+             }
+             stream.last = now;
+             
+             uniform_int_distribution<> emergencyDist(1, 100);
+             bool isEmergency = (emergencyDist(rng) <= stream.emergencyProbability);
+             
+             uniform_int_distribution<> airlineDist(0, spawningAirlines.size() - 1);
+             uint32_t airlineId = spawningAirlines[airlineDist(rng)];
+             const Airline& carrier = *airlines[airlineId];
+             
+             FlightPlan plan;
+             plan.time = now;
+             plan.direction = stream.direction;
+             plan.type = (carrier.kind == AirlineKind::CARGO) ? FlightType::CARGO : FlightType::COMMERCIAL;
+             // The west stream has no always-emergency kind; COMMERCIAL never matches there
+             bool forced = stream.emergencyKind != AirlineKind::COMMERCIAL && carrier.kind == stream.emergencyKind;
+             if (isEmergency || forced) {
+                 plan.type = FlightType::EMERGENCY;
+             }
+             plan.emergency = isEmergency;
+             plan.airlineId = airlineId;
+             plan.airline = carrier.name;
+             plans.push_back(plan);
+         }
+     }
+     
+     void saveCursor(vector<int64_t>& cursor) const override {
+         for (const Stream& stream : streams) {
+             cursor.push_back(stream.last);
+         }
+     }
+     
+     void restoreCursor(const vector<int64_t>& cursor) override {
+         if (cursor.size() == 4) {
+             for (int i = 0; i < 4; i++) {
+                 streams[i].last = static_cast<int>(cursor[i]);
+             }
+         }
+     }
+ };
+ 
+ // Movements streamed from a schedule file or a TCP feed. A reader thread
+ // parses ahead of the simulation into a bounded queue, so a day of tens of
+ // thousands of movements is never held in memory at once and the tick never
+ // waits on I/O unless the reader has fallen behind.
+ //
+ // Two formats, told apart by the first bytes:
+ //   CSV:    time,direction,airline,type,emergency[,flightNumber] per line;
+ //           direction north/south/east/west, type commercial/cargo/emergency,
+ //           emergency 0/1. Blank lines, '#' comments and a "time,..." header are skipped.
+ //   Binary: "ACXT", uint32 version 1, then TrafficRecord after TrafficRecord.
+ // A file is read in time order; a TCP feed is live, so ticks only take what
+ // has already arrived.
+ class StreamTraffic : public TrafficSource {
+ public:
+     struct TrafficRecord {
+         int32_t time;
+         uint8_t direction; // Direction
+         uint8_t type;      // FlightType
+         uint8_t emergency;
+         uint8_t reserved;
+         char airline[32];
+         char flightNumber[16];
+     };
+     
+     static constexpr uint32_t BINARY_MAGIC = 0x54584341; // "ACXT"
+     static constexpr uint32_t BINARY_VERSION = 1;
+     
+ private:
+     static constexpr size_t READ_AHEAD = 4096; // Parsed movements kept ahead of the simulation
+     
+     int fd;
+     bool live;
+     string name;
+     
+     mutex queueMutex;
+     condition_variable planReady;
+     condition_variable spaceFree;
+     deque<FlightPlan> ahead;
+     bool finished; // Reader reached the end of the stream
+     bool stopping;
+     thread reader;
+     
+     // Movements handed out, and movements still to pass over after a restore.
+     // Both only touched by the simulation thread.
+     uint64_t taken;
+     uint64_t skip;
+     
+     StreamTraffic(int source, bool isLive, const string& sourceName)
+         : fd(source), live(isLive), name(sourceName), finished(false), stopping(false), taken(0), skip(0) {
+         reader = thread(&StreamTraffic::readerLoop, this);
+     }
+     
+     // Hand one parsed movement to the simulation, waiting while the queue is full
+     bool push(FlightPlan& plan) {
+         unique_lock<mutex> lock(queueMutex);
+         spaceFree.wait(lock, [this] { return ahead.size() < READ_AHEAD || stopping; });
+         if (stopping) {
+             return false;
+         }
+         ahead.push_back(move(plan));
+         planReady.notify_one();
+         return true;
+     }
+     
+     static bool parseDirection(const string& text, Direction& direction) {
+         static const map<string, Direction> names = {
+             {"north", Direction::NORTH}, {"south", Direction::SOUTH}, {"east", Direction::EAST}, {"west", Direction::WEST}
+         };
+         auto it = names.find(text);
+         if (it == names.end()) {
+             return false;
+         }
+         direction = it->second;
+         return true;
+     }
+     
+     static bool parseType(const string& text, FlightType& type) {
+         static const map<string, FlightType> names = {
+             {"commercial", FlightType::COMMERCIAL}, {"cargo", FlightType::CARGO}, {"emergency", FlightType::EMERGENCY}
+         };
+         auto it = names.find(text);
+         if (it == names.end()) {
+             return false;
+         }
+         type = it->second;
+         return true;
+     }
+     
+     // One CSV line; returns false (with a reason) for a malformed one
+     static bool parseLine(const string& line, FlightPlan& plan, string& reason) {
+         vector<string> fields;
+         size_t start = 0;
+         while (true) {
+             size_t comma = line.find(',', start);
+             string field = line.substr(start, comma == string::npos ? string::npos : comma - start);
+             size_t first = field.find_first_not_of(" \t\r");
+             size_t last = field.find_last_not_of(" \t\r");
+             fields.push_back(first == string::npos ? "" : field.substr(first, last - first + 1));
+             if (comma == string::npos) {
+                 break;
+             }
+             start = comma + 1;
+         }
+         if (fields.size() < 5 || fields.size() > 6) {
+             reason = "expected 5 or 6 fields";
+             return false;
+         }
+         
+         char* end = nullptr;
+         long time = strtol(fields[0].c_str(), &end, 10);
+         if (fields[0].empty() || *end != '\0' || time < 0 || time > INT_MAX) {
+             reason = "bad time";
+             return false;
+         }
+         plan.time = static_cast<int>(time);
+         for (string* field : {&fields[1], &fields[3]}) {
+             transform(field->begin(), field->end(), field->begin(), ::tolower);
+         }
+         if (!parseDirection(fields[1], plan.direction)) {
+             reason = "bad direction";
+             return false;
+         }
+         if (fields[2].empty()) {
+             reason = "missing airline";
+             return false;
+         }
+         plan.airline = fields[2];
+         if (!parseType(fields[3], plan.type)) {
+             reason = "bad type";
+             return false;
+         }
+         if (fields[4] != "0" && fields[4] != "1") {
+             reason = "emergency must be 0 or 1";
+             return false;
+         }
+         plan.emergency = (fields[4] == "1");
+         plan.flightNumber = fields.size() == 6 ? fields[5] : "";
+         return true;
+     }
+     
+     static bool parseRecord(const TrafficRecord& record, FlightPlan& plan) {
+         if (record.time < 0 || record.direction > static_cast<uint8_t>(Direction::WEST) ||
+             record.type > static_cast<uint8_t>(FlightType::EMERGENCY)) {
+             return false;
+         }
+         plan.time = record.time;
+         plan.direction = static_cast<Direction>(record.direction);
+         plan.type = static_cast<FlightType>(record.type);
+         plan.emergency = record.emergency != 0;
+         plan.airline.assign(record.airline, strnlen(record.airline, sizeof(record.airline)));
+         plan.flightNumber.assign(record.flightNumber, strnlen(record.flightNumber, sizeof(record.flightNumber)));
+         return !plan.airline.empty();
+     }
+     
+     void readerLoop() {
+         string pending; // Bytes read but not parsed yet
+         char chunk[64 * 1024];
+         bool binary = false;
+         bool formatKnown = false;
+         size_t lineNumber = 0;
+         size_t records = 0;
+         
+         while (true) {
+             ssize_t bytesRead = read(fd, chunk, sizeof(chunk));
+             if (bytesRead < 0 && errno == EINTR) {
+                 continue;
+             }
+             if (bytesRead < 0) {
+                 // The feed ends here like at end of stream, but not silently
+                 int error = errno;
+                 LogLine(LogLevel::ERROR) << "Traffic " << name << ": read failed: " << strerror(error);
+             }
+             bool atEnd = bytesRead <= 0;
+             if (!atEnd) {
+                 pending.append(chunk, bytesRead);
+             }
+             
+             if (!formatKnown && (pending.size() >= 8 || atEnd)) {
+                 uint32_t header[2] = {0, 0};
+                 memcpy(header, pending.data(), min(pending.size(), sizeof(header)));
+                 binary = (header[0] == BINARY_MAGIC);
+                 if (binary) {
+                     if (header[1] != BINARY_VERSION) {
+                         LogLine(LogLevel::ERROR) << "Traffic " << name << ": unsupported binary version " << header[1];
+                         break;
+                     }
+                     pending.erase(0, sizeof(header));
+                 }
+                 formatKnown = true;
+             }
+             
+             size_t offset = 0;
+             if (formatKnown && binary) {
+                 for (; pending.size() - offset >= sizeof(TrafficRecord); offset += sizeof(TrafficRecord)) {
+                     TrafficRecord record;
+                     memcpy(&record, pending.data() + offset, sizeof(record));
+                     FlightPlan plan;
+                     records++;
+                     if (!parseRecord(record, plan)) {
+                         LogLine(LogLevel::WARN) << "Traffic " << name << ": record " << records << " skipped";
+                     } else if (!push(plan)) {
+                         return;
+                     }
+                 }
+             } else if (formatKnown) {
+                 while (true) {
+                     size_t newline = pending.find('\n', offset);
+                     if (newline == string::npos && !(atEnd && offset < pending.size())) {
+                         break;
+                     }
+                     size_t lineEnd = (newline == string::npos) ? pending.size() : newline;
+                     string line = pending.substr(offset, lineEnd - offset);
+                     offset = (newline == string::npos) ? pending.size() : newline + 1;
+                     lineNumber++;
+                     
+                     size_t first = line.find_first_not_of(" \t\r");
+                     if (first == string::npos || line[first] == '#' || line.compare(first, 5, "time,") == 0) {
+                         continue;
+                     }
+                     FlightPlan plan;
+                     string reason;
+                     if (!parseLine(line, plan, reason)) {
+                         LogLine(LogLevel::WARN) << "Traffic " << name << ": line " << lineNumber << " skipped (" << reason << ")";
+                     } else if (!push(plan)) {
+                         return;
+                     }
+                 }
+             }
+             pending.erase(0, offset);
+             
+             if (atEnd) {
+                 break;
+             }
+         }
+         
+         lock_guard<mutex> lock(queueMutex);
+         finished = true;
+         planReady.notify_all();
+     }
+     
+     static int connectTo(const string& host, const string& port, string& error) {
+         addrinfo hints;
+         memset(&hints, 0, sizeof(hints));
+         hints.ai_family = AF_UNSPEC;
+         hints.ai_socktype = SOCK_STREAM;
+         addrinfo* addresses = nullptr;
+         int status = getaddrinfo(host.c_str(), port.c_str(), &hints, &addresses);
+         if (status != 0) {
+             error = gai_strerror(status);
+             return -1;
+         }
+         int fd = -1;
+         for (addrinfo* address = addresses; address && fd == -1; address = address->ai_next) {
+             fd = socket(address->ai_family, address->ai_socktype | SOCK_CLOEXEC, address->ai_protocol);
+             if (fd != -1 && connect(fd, address->ai_addr, address->ai_addrlen) == -1) {
+                 error = strerror(errno);
+                 close(fd);
+                 fd = -1;
+             }
+         }
+         freeaddrinfo(addresses);
+         return fd;
+     }
+     
+ public:
+     // spec is a file path or tcp:HOST:PORT; returns null with error set on failure
+     static unique_ptr<StreamTraffic> open(const string& spec, string& error) {
+         if (spec.compare(0, 4, "tcp:") == 0) {
+             size_t colon = spec.rfind(':');
+             if (colon <= 4) {
+                 error = "expected tcp:HOST:PORT";
+                 return nullptr;
+             }
+             int fd = connectTo(spec.substr(4, colon - 4), spec.substr(colon + 1), error);
+             if (fd == -1) {
+                 return nullptr;
+             }
+             return unique_ptr<StreamTraffic>(new StreamTraffic(fd, true, spec));
+         }
+         
+         int fd = ::open(spec.c_str(), O_RDONLY | O_CLOEXEC);
+         if (fd == -1) {
+             error = strerror(errno);
+             return nullptr;
+         }
+         posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+         return unique_ptr<StreamTraffic>(new StreamTraffic(fd, false, spec));
+     }
+     
+     ~StreamTraffic() {
+         {
+             lock_guard<mutex> lock(queueMutex);
+             stopping = true;
+         }
+         spaceFree.notify_all();
+         if (live) {
+             shutdown(fd, SHUT_RD); // Wake a reader blocked on a quiet feed
+         }
+         reader.join();
+         close(fd);
+     }
+     
+     void takeDue(int now, vector<FlightPlan>& plans) override {
+         unique_lock<mutex> lock(queueMutex);
+         while (true) {
+             // A file is complete, so wait for the reader rather than miss a movement due now
+             if (!live) {
+                 planReady.wait(lock, [this] { return !ahead.empty() || finished; });
+             }
+             if (ahead.empty() || (skip == 0 && ahead.front().time > now)) {
+                 return;
+             }
+             if (skip > 0) {
+                 skip--; // Already flown before the checkpoint
+             } else {
+                 plans.push_back(move(ahead.front()));
+             }
+             ahead.pop_front();
+             taken++;
+             spaceFree.notify_one();
+         }
+     }
+     
+     void saveCursor(vector<int64_t>& cursor) const override {
+         cursor.push_back(static_cast<int64_t>(taken));
+     }
+     
+     // A file is read again from the start, passing over what was already taken
+     void restoreCursor(const vector<int64_t>& cursor) override {
+         if (!live && cursor.size() == 1) {
+             skip = static_cast<uint64_t>(cursor[0]);
+         }
+     }
+ };
+ 
+ // -------- AIRPORT NETWORK --------
+ 
+ // Handoff links of a sharded run (--airports N): one channel for each ordered
+ // pair of airports, created before the forks like the other channels
+ class AirportNetwork {
+ private:
+     int airports;
+     vector<unique_ptr<MessageChannel>> links; // [from * airports + to], none from an airport to itself
+     
+ public:
+     AirportNetwork(Transport transport, int count) : airports(count), links(count * count) {
+         for (int from = 0; from < airports; from++) {
+             for (int to = 0; to < airports; to++) {
+                 if (from != to) {
+                     links[from * airports + to] = MessageChannel::create(transport);
+                 }
+             }
+         }
+     }
+     
+     int size() const {
+         return airports;
+     }
+     
+     MessageChannel* link(int from, int to) const {
+         return links[from * airports + to].get();
+     }
+     
+     // Take one airport's ends: write to every other airport, read from every other one
+     void join(int airport) {
+         for (int from = 0; from < airports; from++) {
+             for (int to = 0; to < airports; to++) {
+                 MessageChannel* channel = link(from, to);
+                 if (!channel) {
+                     continue;
+                 }
+                 if (from == airport) {
+                     channel->useAsWriter();
+                 } else if (to == airport) {
+                     channel->useAsReader();
+                 } else {
+                     channel->detach();
+                 }
+             }
+         }
+     }
+     
+     // For the processes that are not airports
+     void detach() {
+         for (auto& channel : links) {
+             if (channel) {
+                 channel->detach();
+             }
+         }
+     }
+ };
+ 
+ // One airport's side of a sharded run. A departure that reaches cruise is
+ // handed to another airport, picked by flight id, and joins its arrivals
+ // HANDOFF_TRANSIT_TICKS later. The airports meet at a barrier every lag
+ // ticks: each sends a HANDOFF_BARRIER after its handoffs and waits for all
+ // the others', so none runs more than lag ticks ahead. With lag no longer
+ // than the transit, every handoff is in before it is due, and the run is the
+ // same for any lag. A FLIGHT_HANDOFF carries the flight number and airline,
+ // the tick it is due in requestId, and its type and emergency flag in
+ // minSpeed and maxSpeed.
+ class AirspaceHandoff {
+ private:
+     // Barrier tick that hands the summary turn on to the next airport
+     static constexpr uint32_t SUMMARY_TURN = UINT32_MAX;
+     
+     struct Inbound {
+         int origin;
+         FlightPlan plan;
+     };
+     
+     int airport;
+     int airports;
+     int lag;
+     AirportNetwork& network;
+     vector<unique_ptr<FrameWriter>> outboxes; // By destination, null for this airport
+     vector<unique_ptr<FrameReader>> inboxes;  // By origin, null for this airport
+     vector<uint32_t> barrierSeen;             // Latest barrier from each origin
+     vector<Inbound> inbound;                  // Handoffs not yet due, by due tick then origin
+     EventLoop loop;                           // Wakes a barrier wait when an inbox has data
+     uint64_t handedOff;
+     uint64_t arrived;
+     
+     void receive(int origin, const IPCMessage& message) {
+         FlightPlan plan;
+         plan.time = static_cast<int>(message.requestId);
+         plan.direction = origin < airport ? Direction::NORTH : Direction::SOUTH;
+         plan.type = static_cast<FlightType>(message.minSpeed);
+         plan.emergency = message.maxSpeed != 0;
+         plan.airline = string(message.airline, strnlen(message.airline, sizeof(message.airline)));
+         plan.flightNumber = string(message.flightNumber, strnlen(message.flightNumber, sizeof(message.flightNumber)));
+         inbound.push_back({origin, plan});
+     }
+     
+     // Take everything that has arrived from origin, returns false once its link has closed
+     bool pump(int origin) {
+         FrameReader& inbox = *inboxes[origin];
+         if (inbox.isClosed()) {
+             return false;
+         }
+         vector<IPCMessage> batch;
+         while (inbox.read(batch, 0)) {
+             for (const IPCMessage& message : batch) {
+                 if (message.type == MessageType::HANDOFF_BARRIER) {
+                     barrierSeen[origin] = max(barrierSeen[origin], message.requestId);
+                 } else if (message.type == MessageType::FLIGHT_HANDOFF) {
+                     receive(origin, message);
+                 }
+             }
+             batch.clear();
+         }
+         if (inbox.isClosed()) {
+             loop.unwatch(network.link(origin, airport)->readinessFd());
+             return false;
+         }
+         return true;
+     }
+     
+     // Read from origins first..last until each has passed barrier tick. Every
+     // inbox is drained, or its data would keep the wait from sleeping, and our
+     // own links are flushed in between, so two airports never wait on each other.
+     void awaitBarrier(uint32_t tick, int first, int last) {
+         while (true) {
+             bool sent = true;
+             for (auto& outbox : outboxes) {
+                 if (outbox) {
+                     outbox->flush();
+                     sent = sent && outbox->idle();
+                 }
+             }
+             
+             bool waiting = false;
+             bool idle = true;
+             for (int origin = 0; origin < airports; origin++) {
+                 if (origin == airport || pump(origin)) {
+                     continue;
+                 }
+                 if (origin >= first && origin <= last && barrierSeen[origin] < tick) {
+                     LogLine(LogLevel::WARN) << "Airport " << origin + 1 << " left the network, no longer waiting for it";
+                 }
+                 barrierSeen[origin] = SUMMARY_TURN; // Passed every barrier there will be
+             }
+             for (int origin = first; origin <= last; origin++) {
+                 if (origin != airport && barrierSeen[origin] < tick) {
+                     waiting = true;
+                 }
+             }
+             if (!waiting) {
+                 return;
+             }
+             for (int origin = 0; origin < airports; origin++) {
+                 if (origin != airport && !inboxes[origin]->isClosed()) {
+                     idle = network.link(origin, airport)->prepareToSleep() && idle;
+                 }
+             }
+             
+             // Sleep until an inbox has data; only briefly while our own sends are backed up
+             loop.runOnce(!idle ? 0 : (sent ? 100 : 1));
+             for (int origin = 0; origin < airports; origin++) {
+                 if (origin != airport && !inboxes[origin]->isClosed()) {
+                     network.link(origin, airport)->doneSleeping();
+                 }
+             }
+         }
+     }
+     
+     void sendBarrier(uint32_t tick, int destination) {
+         IPCMessage barrier;
+         barrier.type = MessageType::HANDOFF_BARRIER;
+         barrier.requestId = tick;
+         outboxes[destination]->queue(barrier);
+     }
+     
+ public:
+     AirspaceHandoff(AirportNetwork& links, int index, int barrierLag)
+         : airport(index), airports(links.size()), lag(barrierLag), network(links),
+           outboxes(airports), inboxes(airports), barrierSeen(airports, 0), handedOff(0), arrived(0) {
+         for (int other = 0; other < airports; other++) {
+             if (other != airport) {
+                 outboxes[other].reset(new FrameWriter(network.link(airport, other)));
+                 inboxes[other].reset(new FrameReader(network.link(other, airport)));
+                 loop.watch(network.link(other, airport)->readinessFd(), [] {});
+             }
+         }
+     }
+     
+     int getAirport() const {
+         return airport;
+     }
+     
+     int getAirportCount() const {
+         return airports;
+     }
+     
+     uint64_t getHandedOff() const {
+         return handedOff;
+     }
+     
+     uint64_t getArrived() const {
+         return arrived;
+     }
+     
+     // A departure reached cruise at tick now; sent at the next barrier
+     void depart(const Aircraft& flight, int now) {
+         IPCMessage message;
+         message.type = MessageType::FLIGHT_HANDOFF;
+         strncpy(message.airline, flight.airline.c_str(), sizeof(message.airline) - 1);
+         strncpy(message.flightNumber, flight.flightNumber.c_str(), sizeof(message.flightNumber) - 1);
+         message.requestId = now + HANDOFF_TRANSIT_TICKS;
+         message.minSpeed = static_cast<int>(flight.type);
+         message.maxSpeed = flight.isEmergency ? 1 : 0;
+         
+         int destination = (airport + 1 + flight.id % (airports - 1)) % airports;
+         outboxes[destination]->queue(message);
+         handedOff++;
+     }
+     
+     // Append the handed-off arrivals due at or before now
+     void takeDue(int now, vector<FlightPlan>& plans) {
+         size_t due = 0;
+         while (due < inbound.size() && inbound[due].plan.time <= now) {
+             plans.push_back(inbound[due].plan);
+             due++;
+         }
+         inbound.erase(inbound.begin(), inbound.begin() + due);
+         arrived += due;
+     }
+     
+     // After tick now: meet the other airports if a barrier falls on it
+     void synchronize(int now, bool lastTick) {
+         if (now % lag != 0 && !lastTick) {
+             return;
+         }
+         for (int destination = 0; destination < airports; destination++) {
+             if (destination != airport) {
+                 sendBarrier(now, destination);
+             }
+         }
+         awaitBarrier(now, 0, airports - 1);
+         
+         // Links deliver in order, so a stable sort keeps each origin's handoffs as sent
+         stable_sort(inbound.begin(), inbound.end(), [](const Inbound& a, const Inbound& b) {
+             return a.plan.time != b.plan.time ? a.plan.time < b.plan.time : a.origin < b.origin;
+         });
+     }
+     
+     // Airports print their summaries in turn, first to last
+     void waitTurn() {
+         if (airport > 0) {
+             awaitBarrier(SUMMARY_TURN, airport - 1, airport - 1);
+         }
+     }
+     
+     // Pass the turn on and close our links
+     void finish() {
+         if (airport + 1 < airports) {
+             sendBarrier(SUMMARY_TURN, airport + 1);
+         }
+         for (int other = 0; other < airports; other++) {
+             if (outboxes[other]) {
+                 outboxes[other]->drain(1000);
+                 network.link(airport, other)->closeWriter();
+             }
+         }
+     }
+ };
+ 
+ // Wall time of each phase of one FlightScheduler tick, in microseconds;
+ // filled by updateSimulation() when the benchmarks ask for it
+ struct TickPhaseTimes {
+     enum Phase { GENERATE, ASSIGN, UPDATE, MOVE, PHASE_COUNT };
+     double us[PHASE_COUNT];
+     
+     static const char* name(int phase) {
+         static const char* names[PHASE_COUNT] = {"generateFlights", "assignRunways", "updateFlights", "moveCompletedFlights"};
+         return names[phase];
+     }
+ };
+ 
+ // Flight Scheduler
+ class FlightScheduler {
+ private:
+     vector<shared_ptr<Aircraft>> allFlights;
+     vector<shared_ptr<Aircraft>> activeFlights;
+     vector<shared_ptr<Aircraft>> completedFlights;
+     size_t flightsGenerated;
+     // Airlines indexed by their interned name, in name order; names are only
+     // looked up at the display and IPC edge
+     StringInterner airlineSymbols;
+     vector<shared_ptr<Airline>> airlines;
+     vector<uint32_t> spawningAirlines; // Airlines with active flights, candidates for new traffic
+     vector<shared_ptr<AVN>> allAVNs; // Payment status follows the shared table when one is attached
+ 
+     int currentSimulationTime;
+     
+     // Where new flights come from (IntervalTraffic unless a feed is attached)
+     unique_ptr<TrafficSource> traffic;
+     vector<FlightPlan> duePlans;
+     
+     // Mutexes for runway access control
+     mutex runwayAMutex;
+     mutex runwayBMutex;
+     mutex runwayCMutex;
+     
+     // Runway availability flags
+     bool runwayAAvailable;
+     bool runwayBAvailable;
+     bool runwayCAvailable;
+     
+     // Priority queue comparator
+     struct CompareAircraftPriority {
+         bool operator()(const shared_ptr<Aircraft>& a, const shared_ptr<Aircraft>& b) const {
+             // First by priority (higher number = higher priority)
+             if (a->priority != b->priority) {
+                 return a->priority < b->priority;
+             }
+             // Then by scheduled time
+             return a->scheduledTime > b->scheduledTime;
+         }
+     };
+     
+     // Priority queues for runways
+     RunwayQueue<CompareAircraftPriority> runwayAQueue;
+     RunwayQueue<CompareAircraftPriority> runwayBQueue;
+     RunwayQueue<CompareAircraftPriority> runwayCQueue;
+     
+     // Runway occupancy
+     shared_ptr<Aircraft> runwayAOccupant;
+     shared_ptr<Aircraft> runwayBOccupant;
+     shared_ptr<Aircraft> runwayCOccupant;
+     
+     int runwayAFreeTime;
+     int runwayBFreeTime;
+     int runwayCFreeTime;
+     
+     FrameWriter avnChannel; // Framed channel to the AVN Generator, flushed once per tick; refuses notices rather than hold up a tick
+     
+     // Aircraft that left their runway since the last release pass (owned by activeFlights
+     // or, once completed, by completedFlights or retiring)
+     vector<Aircraft*> pendingReleases;
+     
+     // What is kept of a flight retired to the archive
+     struct ArchivedFlight {
+         int id;
+         uint32_t airlineId;
+         char flightNumber[16];
+         FlightType type;
+         Direction direction;
+         bool emergency;
+         bool violated;
+         int completedAt; // Simulation time
+     };
+     
+     // With archiving, completed flights wait here one tick (until pendingReleases
+     // no longer points at them), then shrink to an ArchivedFlight and are freed
+     bool archiveCompleted;
+     vector<shared_ptr<Aircraft>> retiring;
+     vector<ArchivedFlight> flightArchive;
+     
+     void addActiveFlight(const shared_ptr<Aircraft>& flight) {
+         if (!archiveCompleted) {
+             allFlights.push_back(flight);
+         }
+         activeFlights.push_back(flight);
+         flightsGenerated++;
+     }
+     
+     void archiveFlight(const Aircraft& flight) {
+         ArchivedFlight record;
+         memset(&record, 0, sizeof(record));
+         record.id = flight.id;
+         record.airlineId = flight.airlineId;
+         memcpy(record.flightNumber, flight.flightNumber.data(), min(flight.flightNumber.size(), sizeof(record.flightNumber) - 1));
+         record.type = flight.type;
+         record.direction = flight.direction;
+         record.emergency = flight.isEmergency;
+         record.violated = flight.violatedPhases != 0;
+         record.completedAt = currentSimulationTime - 1;
+         flightArchive.push_back(record);
+     }
+     
+     // Optional structure-of-arrays copy of the active flights' hot fields
+     bool useFlightTable;
+     FlightTable fleet;
+     
+     // Random stream for flight generation
+     RandomStream trafficRng;
+     
+     // Worker pool for the per-flight phase update (null when running serially)
+     unique_ptr<ThreadPool> threadPool;
+     bool parallelUpdate;
+     vector<vector<Aircraft*>> workerViolators; // Flights that raised a violation, per worker
+     vector<vector<Aircraft*>> workerReleases;  // Flights that cleared their runway, per worker
+     
+     // Incremental status display and the running count it shows for unpaid AVNs
+     StatusRenderer statusBoard;
+     int unpaidAVNCount;
+     
+     AVNJournal* journal; // Durable record of issued and paid AVNs (null = not journaled)
+     AVNAnalytics analytics;
+     SharedAVNTable* avnTable; // Where the other processes read AVNs (null = not shared)
+     uint32_t paymentsSeen;    // avnTable->payments() when its paid rows were last taken in
+     uint32_t claimsSeen;      // avnTable->claims() when its claimed payments were last taken in
+     
+     static string avnStatusKey(int avnId) {
+         ostringstream key;
+         key << "avn:" << setw(10) << setfill('0') << avnId;
+         return key.str();
+     }
+     
+     void addAVNToStatusBoard(const AVN& avn) {
+         unpaidAVNCount++;
+         showAVNOnStatusBoard(avn);
+     }
+     
+     // (Re)draw an unpaid AVN's row; the first frame lists every unpaid AVN itself
+     void showAVNOnStatusBoard(const AVN& avn) {
+         if (!Logger::enabled(LogLevel::INFO) || !statusBoard.drawn()) {
+             return;
+         }
+         keepAVNRow(avn);
+     }
+     
+     void keepAVNRow(const AVN& avn) {
+         ostringstream row;
+         row << "AVN #" << avn.id << " | " << avn.airline << " flight " << avn.flightNumber 
+             << " | Speed: " << avn.recordedSpeed << " km/h"
+             << " | Amount: PKR " << fixed << setprecision(2) << avn.totalAmount;
+         if (avn.status == PaymentStatus::OVERDUE) {
+             row << " | OVERDUE";
+         }
+         statusBoard.keepItem(StatusRenderer::AVNS, avnStatusKey(avn.id), row.str());
+     }
+     
+     // Reminder, overdue and penalty deadlines of unpaid AVNs. Paid AVNs are
+     // not taken out of the wheel; their deadlines find them paid, here or in
+     // the shared table, and do nothing.
+     enum class DeadlineKind : uint8_t { REMINDER, OVERDUE, ESCALATION };
+     
+     struct AVNDeadline {
+         AVN* avn; // Owned by allAVNs, which never drops an AVN
+         DeadlineKind kind;
+     };
+     
+     TimerWheel<AVNDeadline> avnDeadlines;
+     bool wallClockDeadlines;
+     
+     // Lookahead runway planning: the best-ranked waiting flights, each with the
+     // runway and tick it will be given, laid out on per-runway reservations
+     struct PlannedMovement {
+         shared_ptr<Aircraft> aircraft;
+         RunwayQueue<CompareAircraftPriority>* queue; // Where it waits
+         Runway homeRunway;                          // That queue's runway
+         Runway runway;
+         int start;
+     };
+     
+     // Flights planned ahead; at about one movement per runway every half
+     // minute this is well over a simulated quarter hour of runway time
+     static constexpr size_t RUNWAY_PLAN_FLIGHTS = 48;
+     
+     RunwayPlanning runwayPlanning;
+     vector<PlannedMovement> runwayPlan; // Best-ranked first
+     vector<PlannedMovement> runwayCandidates;
+     RunwaySlots runwaySlots[3];         // By Runway value
+     bool runwayPlanStale;               // Plan again from scratch before the next dispatch
+     
+     // Runway movements so far and the ticks flights waited for them once ready, for either engine
+     uint64_t runwayMovements;
+     uint64_t runwayDelayTicks;
+     
+     AirspaceHandoff* handoff; // Link to the other airports of a sharded run (null = one airport)
+     
+     // Deadline clock: simulated seconds, or seconds since the epoch
+     uint64_t deadlineNow() const {
+         return wallClockDeadlines ? static_cast<uint64_t>(time(nullptr)) : static_cast<uint64_t>(currentSimulationTime);
+     }
+     
+     void scheduleDeadlines(AVN& avn) {
+         if (avn.status == PaymentStatus::PAID) {
+             return;
+         }
+         uint64_t now = deadlineNow();
+         if (avn.status == PaymentStatus::OVERDUE) {
+             avnDeadlines.schedule(now + AVN_ESCALATION_INTERVAL, {&avn, DeadlineKind::ESCALATION});
+             return;
+         }
+         uint64_t due = wallClockDeadlines ? static_cast<uint64_t>(avn.dueDate) : now + AVN_PAYMENT_WINDOW;
+         avnDeadlines.schedule(due - AVN_REMINDER_LEAD, {&avn, DeadlineKind::REMINDER});
+         avnDeadlines.schedule(due, {&avn, DeadlineKind::OVERDUE});
+     }
+     
+     // Penalties already added to an AVN's amount
+     static int escalationsApplied(const AVN& avn) {
+         double penalty = avn.fineAmount * AVN_LATE_PENALTY_PERCENTAGE;
+         return static_cast<int>(lround((avn.totalAmount - avn.fineAmount - avn.serviceFee) / penalty));
+     }
+     
+     // Record a payment everywhere the scheduler keeps the AVN; recorded when the journal has it already
+     void avnPaid(AVN& avn, double amount, bool recorded = false) {
+         if (avn.status == PaymentStatus::PAID) {
+             return;
+         }
+         unpaidAVNCount--;
+         statusBoard.dropItem(avnStatusKey(avn.id));
+         analytics.recordPaid(avn.id, currentSimulationTime);
+         if (avnTable) {
+             avnTable->setStatus(avn.id, PaymentStatus::PAID);
+         }
+         if (journal && !recorded) {
+             journal->recordPaid(avn.id, amount);
+         }
+         avn.status = PaymentStatus::PAID;
+     }
+     
+     // Change an unpaid AVN's status or amount everywhere it is kept. The shared
+     // table goes first: if the AVN was paid there meanwhile, the change is
+     // dropped, the payment taken in instead, and false returned.
+     bool changeAVN(AVN& avn, PaymentStatus status, double totalAmount) {
+         if (avnTable && !avnTable->setStatus(avn.id, status, totalAmount) && avnTable->paid(avn.id)) {
+             avnPaid(avn, avn.totalAmount);
+             return false;
+         }
+         avn.status = status;
+         avn.totalAmount = totalAmount;
+         showAVNOnStatusBoard(avn);
+         analytics.recordAmount(avn.id, avn.totalAmount);
+         if (journal) {
+             journal->recordUpdated(avn);
+         }
+         return true;
+     }
+     
+     void onAVNDeadline(const AVNDeadline& deadline) {
+         AVN& avn = *deadline.avn;
+         // Payments made through the portal land in the shared table, not here
+         if (avnTable && avn.status != PaymentStatus::PAID && avnTable->paid(avn.id)) {
+             avnPaid(avn, avn.totalAmount);
+         }
+         if (avn.status == PaymentStatus::PAID) {
+             return;
+         }
+         
+         switch (deadline.kind) {
+             case DeadlineKind::REMINDER:
+                 LogLine(LogLevel::EVENT) << "Reminder: AVN #" << avn.id << " (" << avn.airline << " flight " << avn.flightNumber
+                      << ") is due in " << AVN_REMINDER_LEAD / 3600 << " hours - PKR " << fixed << setprecision(2) << avn.totalAmount;
+                 break;
+                 
+             case DeadlineKind::OVERDUE:
+                 if (!changeAVN(avn, PaymentStatus::OVERDUE, avn.totalAmount)) {
+                     break;
+                 }
+                 avnDeadlines.schedule(deadlineNow() + AVN_ESCALATION_INTERVAL, {&avn, DeadlineKind::ESCALATION});
+                 LogLine(LogLevel::EVENT) << "AVN #" << avn.id << " (" << avn.airline << ") is OVERDUE - PKR "
+                      << fixed << setprecision(2) << avn.totalAmount;
+                 break;
+                 
+             case DeadlineKind::ESCALATION: {
+                 int applied = escalationsApplied(avn);
+                 if (applied >= AVN_MAX_ESCALATIONS) {
+                     break;
+                 }
+                 if (!changeAVN(avn, avn.status, avn.totalAmount + avn.fineAmount * AVN_LATE_PENALTY_PERCENTAGE)) {
+                     break;
+                 }
+                 if (applied + 1 < AVN_MAX_ESCALATIONS) {
+                     avnDeadlines.schedule(deadlineNow() + AVN_ESCALATION_INTERVAL, {&avn, DeadlineKind::ESCALATION});
+                 }
+                 LogLine(LogLevel::EVENT) << "AVN #" << avn.id << " (" << avn.airline << ") late penalty " << applied + 1
+                      << " of " << AVN_MAX_ESCALATIONS << " - now PKR " << fixed << setprecision(2) << avn.totalAmount;
+                 break;
+             }
+         }
+     }
+     
+     // Everything a flight carries from tick to tick; the airline name comes
+     // from airlineId and the flight number is written after the record
+     struct FlightRecord {
+         int32_t id;
+         uint8_t kind;          // 0 arrival, 1 departure
+         uint8_t list;          // FlightList
+         uint8_t phase;         // ArrivalState / DepartureState value
+         uint8_t violatedMask;  // Bit per phase that already had a violation
+         uint8_t type;
+         uint8_t direction;
+         uint8_t runway;
+         uint8_t flags;         // 1 emergency, 2 active violation, 4 holding violation speed
+         int32_t phaseTime;
+         int32_t priority;
+         int32_t speed;
+         int32_t violationSpeed;
+         int32_t violationMinSpeed;
+         int32_t violationMaxSpeed;
+         int32_t queuedAt;
+         uint32_t airlineId;
+         int64_t scheduledNs;   // system_clock, since the epoch
+         int64_t actualNs;
+         uint64_t rngCounter;
+     };
+     
+     // Which of the scheduler's lists a flight is in
+     enum FlightList : uint8_t { ACTIVE_FLIGHT, COMPLETED_FLIGHT, RETIRING_FLIGHT };
+     
+     static constexpr int32_t NO_FLIGHT = -1;
+     
+     static int64_t sinceEpochNs(chrono::system_clock::time_point time) {
+         return chrono::duration_cast<chrono::nanoseconds>(time.time_since_epoch()).count();
+     }
+     
+     static chrono::system_clock::time_point fromEpochNs(int64_t ns) {
+         return chrono::system_clock::time_point(chrono::duration_cast<chrono::system_clock::duration>(chrono::nanoseconds(ns)));
+     }
+     
+     FlightRecord toRecord(const Aircraft& flight, FlightList list) const {
+         FlightRecord record;
+         memset(&record, 0, sizeof(record));
+         record.id = flight.id;
+         record.kind = dynamic_cast<const ArrivalFlight*>(&flight) ? 0 : 1;
+         record.list = list;
+         record.phase = flight.getPhaseCode();
+         record.violatedMask = flight.violatedPhases;
+         record.type = static_cast<uint8_t>(flight.type);
+         record.direction = static_cast<uint8_t>(flight.direction);
+         record.runway = static_cast<uint8_t>(flight.assignedRunway);
+         record.flags = (flight.isEmergency ? 1 : 0) | (flight.hasActiveViolation ? 2 : 0) | (flight.maintainViolationSpeed ? 4 : 0);
+         record.phaseTime = flight.getPhaseTime();
+         record.priority = flight.priority;
+         record.speed = flight.currentSpeed;
+         record.violationSpeed = flight.violationSpeed;
+         record.violationMinSpeed = flight.violationMinSpeed;
+         record.violationMaxSpeed = flight.violationMaxSpeed;
+         record.queuedAt = flight.queuedAt;
+         record.airlineId = flight.airlineId;
+         record.scheduledNs = sinceEpochNs(flight.scheduledTime);
+         record.actualNs = sinceEpochNs(flight.actualTime);
+         record.rngCounter = flight.rng.getCounter();
+         return record;
+     }
+     
+     shared_ptr<Aircraft> fromRecord(const FlightRecord& record, const string& flightNumber) {
+         const string& airline = airlines[record.airlineId]->name;
+         FlightType type = static_cast<FlightType>(record.type);
+         Direction direction = static_cast<Direction>(record.direction);
+         chrono::system_clock::time_point scheduled = fromEpochNs(record.scheduledNs);
+         
+         shared_ptr<Aircraft> flight;
+         if (record.kind == 0) {
+             flight = makePooled<ArrivalFlight>(flightNumber, airline, type, direction, record.priority, scheduled);
+         } else {
+             flight = makePooled<DepartureFlight>(flightNumber, airline, type, direction, record.priority, scheduled);
+         }
+         flight->id = record.id;
+         flight->airlineId = record.airlineId;
+         flight->restorePhase(record.phase, record.phaseTime);
+         flight->violatedPhases = record.violatedMask;
+         flight->assignedRunway = static_cast<Runway>(record.runway);
+         flight->isEmergency = record.flags & 1;
+         flight->hasActiveViolation = record.flags & 2;
+         flight->maintainViolationSpeed = record.flags & 4;
+         flight->currentSpeed = record.speed;
+         flight->violationSpeed = record.violationSpeed;
+         flight->violationMinSpeed = record.violationMinSpeed;
+         flight->violationMaxSpeed = record.violationMaxSpeed;
+         flight->queuedAt = record.queuedAt;
+         flight->actualTime = fromEpochNs(record.actualNs);
+         flight->rng = RandomStream(simulationSeed, AIRCRAFT_STREAM_BASE + record.id);
+         flight->rng.setCounter(record.rngCounter);
+         return flight;
+     }
+     
+     static void putQueue(CheckpointWriter& out, const RunwayQueue<CompareAircraftPriority>& queue) {
+         vector<int32_t> ids;
+         for (const auto& flight : queue.items()) {
+             ids.push_back(flight->id);
+         }
+         out.putVector(ids);
+     }
+     
+     static int32_t idOf(const shared_ptr<Aircraft>& flight) {
+         return flight ? flight->id : NO_FLIGHT;
+     }
+     
+     // Take over an AVN issued in an earlier run (journal or checkpoint)
+     void adoptAVN(const shared_ptr<AVN>& avn) {
+         if (Airline* airline = findAirline(avn->airline)) {
+             airline->addViolation(avn);
+         }
+         allAVNs.push_back(avn);
+         if (avnTable) {
+             avnTable->publish(avn->toRecord(), avn->airline);
+         }
+         if (avn->status != PaymentStatus::PAID) {
+             addAVNToStatusBoard(*avn);
+         }
+         Aircraft::reserveAvnIds(avn->id);
+     }
+     
+ public:
+     FlightScheduler(MessageChannel* avnLink, const SimulationOptions& options = SimulationOptions()) : flightsGenerated(0), currentSimulationTime(0), 
+     runwayAAvailable(true), runwayBAvailable(true), runwayCAvailable(true),
+     runwayAFreeTime(0), runwayBFreeTime(0), runwayCFreeTime(0),
+     avnChannel(avnLink, FrameWriter::REFUSE), archiveCompleted(options.archiveCompleted),
+     useFlightTable(options.useFlightTable), trafficRng(simulationSeed, TRAFFIC_STREAM), parallelUpdate(false),
+     statusBoard(options.statusRate), unpaidAVNCount(0), journal(nullptr), avnTable(nullptr), paymentsSeen(0), claimsSeen(0),
+     avnDeadlines(options.wallClockDeadlines ? static_cast<uint64_t>(time(nullptr)) : 0),
+     wallClockDeadlines(options.wallClockDeadlines), runwayPlanning(options.runwayPlanning),
+     runwayPlanStale(true), runwayMovements(0), runwayDelayTicks(0), handoff(nullptr) {
+     if (options.threads > 1) {
+         threadPool.reset(new ThreadPool(options.threads));
+     }
+     
+     // Initialize airlines
+     vector<shared_ptr<Airline>> carriers = {
+         make_shared<Airline>("PIA", 6, 4),
+         make_shared<Airline>("AirBlue", 4, 4),
+         make_shared<Airline>("FedEx", 3, 2, AirlineKind::CARGO),
+         make_shared<Airline>("Pakistan Airforce", 2, 1, AirlineKind::MILITARY),
+         make_shared<Airline>("Blue Dart", 2, 2, AirlineKind::CARGO),
+         make_shared<Airline>("AghaKhan Air Ambulance", 2, 1, AirlineKind::MEDICAL)
+     };
+     // Ids follow name order, so picks from the traffic stream match a name-keyed map;
+     // airlines first seen in a traffic feed are appended after these
+     sort(carriers.begin(), carriers.end(), [](const shared_ptr<Airline>& a, const shared_ptr<Airline>& b) {
+         return a->name < b->name;
+     });
+     for (const auto& airline : carriers) {
+         airlineSymbols.intern(airline->name);
+         if (airline->activeFlights > 0) {
+             spawningAirlines.push_back(airlines.size());
+         }
+         airlines.push_back(airline);
+     }
+     traffic.reset(new IntervalTraffic(trafficRng, airlines, spawningAirlines));
+     }
+     
+     // Replace the built-in interval traffic, e.g. with a StreamTraffic feed
+     void setTrafficSource(unique_ptr<TrafficSource> source) {
+         traffic = move(source);
+     }
+     
+     void updateSimulation(TickPhaseTimes* times = nullptr) {
+         currentSimulationTime++;
+         
+         // Phase timing costs two clock reads per phase, so only when asked
+         TickPhaseTimes metricTimes;
+         if (!times && Metrics::enabled()) {
+             times = &metricTimes;
+         }
+         auto tickStart = times ? chrono::steady_clock::now() : chrono::steady_clock::time_point();
+         auto lapStart = tickStart;
+         auto lap = [&](TickPhaseTimes::Phase phase) {
+             if (times) {
+                 auto now = chrono::steady_clock::now();
+                 times->us[phase] = chrono::duration<double, micro>(now - lapStart).count();
+                 lapStart = now;
+             }
+         };
+         
+         // Generate new flights
+         generateFlights();
+         lap(TickPhaseTimes::GENERATE);
+         
+         // Assign runways
+         assignRunways();
+         lap(TickPhaseTimes::ASSIGN);
+         
+         // Update active flights
+         updateFlights();
+         lap(TickPhaseTimes::UPDATE);
+         
+         // Move completed flights
+         moveCompletedFlights();
+         lap(TickPhaseTimes::MOVE);
+         
+         // Fire AVN reminders, overdue transitions and penalties that came due
+         takeInPayments();
+         avnDeadlines.advance(deadlineNow(), [this](const AVNDeadline& deadline) { onAVNDeadline(deadline); });
+         
+         // Send this tick's AVN notices in one batch
+         avnChannel.flush();
+         
+         if (Metrics::enabled()) {
+             recordTickMetrics(*times, chrono::duration<double, micro>(chrono::steady_clock::now() - tickStart).count());
+         }
+     }
+     
+     void recordTickMetrics(const TickPhaseTimes& times, double tickUs) {
+         Metrics::add(Metric::TICKS);
+         Metrics::record(Distribution::TICK_NS, tickUs * 1000);
+         Metrics::record(Distribution::GENERATE_NS, times.us[TickPhaseTimes::GENERATE] * 1000);
+         Metrics::record(Distribution::ASSIGN_NS, times.us[TickPhaseTimes::ASSIGN] * 1000);
+         Metrics::record(Distribution::UPDATE_NS, times.us[TickPhaseTimes::UPDATE] * 1000);
+         Metrics::record(Distribution::MOVE_NS, times.us[TickPhaseTimes::MOVE] * 1000);
+         Metrics::record(Distribution::RUNWAY_A_QUEUE, runwayAQueue.size());
+         Metrics::record(Distribution::RUNWAY_B_QUEUE, runwayBQueue.size());
+         Metrics::record(Distribution::RUNWAY_C_QUEUE, runwayCQueue.size());
+         if (!runwayAAvailable) {
+             Metrics::add(Metric::RUNWAY_A_BUSY_TICKS);
+         }
+         if (!runwayBAvailable) {
+             Metrics::add(Metric::RUNWAY_B_BUSY_TICKS);
+         }
+         if (!runwayCAvailable) {
+             Metrics::add(Metric::RUNWAY_C_BUSY_TICKS);
+         }
+     }
+     
+     // Synthetic load for the benchmarks: count flights at once, round-robin over
+     // the four directions, typed and queued the way IntervalTraffic does it
+     void injectTraffic(size_t count) {
+         static const int emergencyPercent[] = {NORTH_EMERGENCY_PROBABILITY, SOUTH_EMERGENCY_PROBABILITY,
+                                                EAST_EMERGENCY_PROBABILITY, WEST_EMERGENCY_PROBABILITY};
+         for (size_t i = 0; i < count; i++) {
+             uniform_int_distribution<> emergencyDist(1, 100);
+             
+             FlightPlan plan;
+             plan.time = currentSimulationTime;
+             plan.direction = static_cast<Direction>(i % 4);
+             plan.emergency = (emergencyDist(trafficRng) <= emergencyPercent[i % 4]);
+             plan.airlineId = pickAirline();
+             const Airline& carrier = *airlines[plan.airlineId];
+             plan.airline = carrier.name;
+             plan.type = (carrier.kind == AirlineKind::CARGO) ? FlightType::CARGO : FlightType::COMMERCIAL;
+             if (plan.emergency) {
+                 plan.type = FlightType::EMERGENCY;
+             }
+             spawnFlight(plan, false);
+         }
+     }
+     
+     // Give the AVN Generator up to timeoutMs to take any notices still backlogged
+     void drainAVNNotices(int timeoutMs) {
+         avnChannel.drain(timeoutMs);
+     }
+     
+     int getCurrentTime() const {
+         return currentSimulationTime;
+     }
+     
+     // Airline for a new flight, drawn from the traffic stream
+     uint32_t pickAirline() {
+         uniform_int_distribution<> airlineDist(0, spawningAirlines.size() - 1);
+         return spawningAirlines[airlineDist(trafficRng)];
+     }
+     
+     Airline* findAirline(const string& name) const {
+         uint32_t airlineId;
+         return airlineSymbols.find(name, airlineId) ? airlines[airlineId].get() : nullptr;
+     }
+     
+     // Id of an airline named in a traffic feed, adding it if this is its first flight
+     uint32_t airlineFor(const FlightPlan& plan) {
+         if (plan.airlineId != FlightPlan::UNKNOWN_AIRLINE) {
+             return plan.airlineId;
+         }
+         uint32_t airlineId;
+         if (airlineSymbols.find(plan.airline, airlineId)) {
+             return airlineId;
+         }
+         AirlineKind kind = (plan.type == FlightType::CARGO) ? AirlineKind::CARGO : AirlineKind::COMMERCIAL;
+         airlineId = airlineSymbols.intern(plan.airline);
+         airlines.push_back(make_shared<Airline>(plan.airline, 0, 0, kind));
+         return airlineId;
+     }
+     
+     // Turn one scheduled movement into a flight in its runway queue
+     void spawnFlight(const FlightPlan& plan, bool log = true) {
+         uint32_t airlineId = airlineFor(plan);
+         const Airline& carrier = *airlines[airlineId];
+         bool arrival = (plan.direction == Direction::NORTH || plan.direction == Direction::SOUTH);
+         
+         // Create flight number
+         string flightNumber = plan.flightNumber;
+         if (flightNumber.empty()) {
+             flightNumber = carrier.flightPrefix + to_string((arrival ? 1000 : 2000) + flightsGenerated);
+         }
+         
+         // Set priority (emergency = 3, cargo = 2, commercial = 1)
+         int priority = (plan.emergency) ? 3 : ((plan.type == FlightType::CARGO) ? 2 : 1);
+         
+         shared_ptr<Aircraft> flight;
+         if (arrival) {
+             flight = makePooled<ArrivalFlight>(flightNumber, carrier.name, plan.type, plan.direction, priority,
+                                                chrono::system_clock::now());
+         } else {
+             flight = makePooled<DepartureFlight>(flightNumber, carrier.name, plan.type, plan.direction, priority,
+                                                  chrono::system_clock::now());
+         }
+         flight->isEmergency = plan.emergency;
+         flight->airlineId = airlineId;
+         trackFlight(*flight);
+         
+         addActiveFlight(flight);
+         
+         // Arrivals queue for runway A, departures for runway B
+         if (arrival) {
+             runwayAQueue.push(flight);
+             planNewFlight(flight, &runwayAQueue, Runway::RWY_A);
+         } else {
+             runwayBQueue.push(flight);
+             planNewFlight(flight, &runwayBQueue, Runway::RWY_B);
+         }
+         
+         if (log) {
+             static const char* labels[] = {"North Arrival", "South Arrival", "East Departure", "West Departure"};
+             LogLine(LogLevel::EVENT) << "\nNew " << labels[static_cast<int>(plan.direction)] << ": " << flight->getSummary();
+         }
+     }
+     
+     void generateFlights() {
+         duePlans.clear();
+         traffic->takeDue(currentSimulationTime, duePlans);
+         if (handoff) {
+             handoff->takeDue(currentSimulationTime, duePlans);
+         }
+         for (const FlightPlan& plan : duePlans) {
+             spawnFlight(plan);
+         }
+     }
+     
+     bool isRunwayFree(Runway runway) const {
+         switch (runway) {
+             case Runway::RWY_A: return runwayAAvailable && currentSimulationTime >= runwayAFreeTime;
+             case Runway::RWY_B: return runwayBAvailable && currentSimulationTime >= runwayBFreeTime;
+             case Runway::RWY_C: return runwayCAvailable && currentSimulationTime >= runwayCFreeTime;
+             default: return false;
+         }
+     }
+     
+     // Put an aircraft on a runway if it is free, returns false if it was taken
+     bool occupyRunway(const shared_ptr<Aircraft>& aircraft, Runway runway, const char* note) {
+         mutex& runwayMutex = (runway == Runway::RWY_A) ? runwayAMutex :
+                              (runway == Runway::RWY_B) ? runwayBMutex : runwayCMutex;
+         lock_guard<mutex> lock(runwayMutex);
+         
+         if (!isRunwayFree(runway)) {
+             return false;
+         }
+         
+         if (runway == Runway::RWY_A) {
+             runwayAAvailable = false;
+             runwayAOccupant = aircraft;
+         } else if (runway == Runway::RWY_B) {
+             runwayBAvailable = false;
+             runwayBOccupant = aircraft;
+         } else {
+             runwayCAvailable = false;
+             runwayCOccupant = aircraft;
+         }
+         aircraft->assignedRunway = runway;
+         if (aircraft->tableRow >= 0) {
+             fleet.setRunway(aircraft->tableRow, runway);
+         }
+         Metrics::add(Metric::FLIGHTS_DISPATCHED);
+         Metrics::record(Distribution::RUNWAY_WAIT_TICKS, currentSimulationTime - aircraft->queuedAt);
+         int delay = runwayDelay(*aircraft);
+         Metrics::record(Distribution::RUNWAY_DELAY_TICKS, delay);
+         runwayMovements++;
+         runwayDelayTicks += delay;
+         
+         LogLine(LogLevel::EVENT) << "Assigned " << aircraft->getRunwayString() << note << " to " << aircraft->flightNumber 
+              << " (" << aircraft->airline << ")";
+         return true;
+     }
+     
+     static bool usesHomeRunway(const Aircraft& aircraft, Runway homeRunway) {
+         return (homeRunway == Runway::RWY_A) ?
+             (aircraft.direction == Direction::NORTH || aircraft.direction == Direction::SOUTH) :
+             (aircraft.direction == Direction::EAST || aircraft.direction == Direction::WEST);
+     }
+     
+     // Try the runways open to this aircraft in order of preference
+     bool tryAssignRunway(const shared_ptr<Aircraft>& aircraft, Runway homeRunway) {
+         // RWY-C queue only ever uses RWY-C
+         if (homeRunway == Runway::RWY_C) {
+             return occupyRunway(aircraft, Runway::RWY_C, "");
+         }
+         
+         // Try RWY-C for emergency or cargo flights
+         if (aircraft->type == FlightType::EMERGENCY || aircraft->type == FlightType::CARGO) {
+             if (occupyRunway(aircraft, Runway::RWY_C, "")) {
+                 return true;
+             }
+         }
+         
+         // Try RWY-A for North/South arrivals, RWY-B for East/West departures
+         if (usesHomeRunway(*aircraft, homeRunway) && occupyRunway(aircraft, homeRunway, "")) {
+             return true;
+         }
+         
+         // Try RWY-C as fallback for non-cargo flights
+         if (aircraft->type != FlightType::CARGO) {
+             return occupyRunway(aircraft, Runway::RWY_C, " (fallback)");
+         }
+         return false;
+     }
+     
+     // Dispatch waiting aircraft from the top of a queue while a runway it can use is free.
+     // Every aircraft in a queue can use the same runways, so once the top one cannot be
+     // placed nobody below it can either and the rest of the queue is left untouched.
+     void dispatchQueue(RunwayQueue<CompareAircraftPriority>& queue, Runway homeRunway) {
+         while (!queue.empty() && (isRunwayFree(homeRunway) || isRunwayFree(Runway::RWY_C))) {
+             shared_ptr<Aircraft> aircraft = queue.top();
+             
+             // Already holding a runway, nothing left to wait for
+             if (aircraft->assignedRunway != Runway::NONE) {
+                 queue.pop();
+                 continue;
+             }
+             
+             if (!tryAssignRunway(aircraft, homeRunway)) {
+                 break;
+             }
+             queue.pop();
+         }
+     }
+     
+     // Phase and time in it, from the flight table when that is what advances them
+     uint8_t phaseOf(const Aircraft& flight) const {
+         return flight.tableRow >= 0 ? fleet.getState(flight.tableRow) : flight.getPhaseCode();
+     }
+     
+     int phaseTimeOf(const Aircraft& flight) const {
+         return flight.tableRow >= 0 ? fleet.getStateTime(flight.tableRow) : flight.getPhaseTime();
+     }
+     
+     // Ticks a waiting flight has been ready to leave its runway phase
+     int runwayDelay(const Aircraft& flight) const {
+         return max(0, phaseTimeOf(flight) - runwayReadyTime(flight.getPhaseKind()));
+     }
+     
+     // Tick a runway can next be given out, from its current occupant's phase
+     int runwayFreeAt(Runway runway) const {
+         const shared_ptr<Aircraft>& occupant = (runway == Runway::RWY_A) ? runwayAOccupant :
+                                                (runway == Runway::RWY_B) ? runwayBOccupant : runwayCOccupant;
+         if (isRunwayFree(runway)) {
+             return currentSimulationTime;
+         }
+         if (!occupant) {
+             return currentSimulationTime + 1;
+         }
+         return currentSimulationTime + ticksUntilRunwayFree(occupant->getPhaseKind(), phaseOf(*occupant), phaseTimeOf(*occupant));
+     }
+     
+     // Best-ranked first: queue priority order, then the older flight
+     static bool ranksAbove(const shared_ptr<Aircraft>& a, const shared_ptr<Aircraft>& b) {
+         CompareAircraftPriority ranksBelow;
+         if (ranksBelow(b, a) != ranksBelow(a, b)) {
+             return ranksBelow(b, a);
+         }
+         return a->id < b->id;
+     }
+     
+     // The RUNWAY_PLAN_FLIGHTS best-ranked waiting flights of all three queues
+     void collectRunwayCandidates() {
+         runwayCandidates.clear();
+         vector<shared_ptr<Aircraft>> waiting;
+         vector<pair<RunwayQueue<CompareAircraftPriority>*, int>> holding;
+         pair<RunwayQueue<CompareAircraftPriority>*, Runway> queues[] = {
+             {&runwayAQueue, Runway::RWY_A}, {&runwayBQueue, Runway::RWY_B}, {&runwayCQueue, Runway::RWY_C}
+         };
+         for (const auto& queue : queues) {
+             waiting.clear();
+             queue.first->top(RUNWAY_PLAN_FLIGHTS, waiting);
+             for (const auto& aircraft : waiting) {
+                 // Already holding a runway, nothing left to wait for
+                 if (aircraft->assignedRunway != Runway::NONE) {
+                     holding.push_back({queue.first, aircraft->id});
+                     continue;
+                 }
+                 runwayCandidates.push_back({aircraft, queue.first, queue.second, Runway::NONE, 0});
+             }
+         }
+         for (const auto& entry : holding) {
+             entry.first->remove(entry.second);
+         }
+         
+         sort(runwayCandidates.begin(), runwayCandidates.end(), [](const PlannedMovement& a, const PlannedMovement& b) {
+             return ranksAbove(a.aircraft, b.aircraft);
+         });
+         if (runwayCandidates.size() > RUNWAY_PLAN_FLIGHTS) {
+             runwayCandidates.resize(RUNWAY_PLAN_FLIGHTS);
+         }
+     }
+     
+     // Give a waiting flight the runway, among those it may use, where its whole
+     // movement fits soonest after it is ready; ties go to the greedy engine's preference
+     void planMovement(PlannedMovement movement) {
+         const Aircraft& aircraft = *movement.aircraft;
+         Runway choices[2];
+         int count = 0;
+         bool prefersC = aircraft.type == FlightType::EMERGENCY || aircraft.type == FlightType::CARGO;
+         if (movement.homeRunway == Runway::RWY_C || prefersC) {
+             choices[count++] = Runway::RWY_C;
+         }
+         if (movement.homeRunway != Runway::RWY_C && usesHomeRunway(aircraft, movement.homeRunway)) {
+             choices[count++] = movement.homeRunway;
+         }
+         // RWY-C as fallback for non-cargo flights
+         if (movement.homeRunway != Runway::RWY_C && !prefersC) {
+             choices[count++] = Runway::RWY_C;
+         }
+         
+         uint8_t kind = aircraft.getPhaseKind();
+         int ready = currentSimulationTime + max(0, runwayReadyTime(kind) - phaseTimeOf(aircraft));
+         int length = runwayOccupancy(kind);
+         movement.start = INT_MAX;
+         for (int i = 0; i < count; i++) {
+             int start = runwaySlots[static_cast<int>(choices[i])].earliestFit(ready, length);
+             if (start < movement.start) {
+                 movement.start = start;
+                 movement.runway = choices[i];
+             }
+         }
+         if (movement.runway == Runway::NONE) {
+             return;
+         }
+         runwaySlots[static_cast<int>(movement.runway)].reserve(movement.start, length);
+         runwayPlan.push_back(movement);
+     }
+     
+     void replanRunways() {
+         runwayPlan.clear();
+         for (Runway runway : {Runway::RWY_A, Runway::RWY_B, Runway::RWY_C}) {
+             runwaySlots[static_cast<int>(runway)].reset(runwayFreeAt(runway));
+         }
+         collectRunwayCandidates();
+         for (const PlannedMovement& candidate : runwayCandidates) {
+             planMovement(candidate);
+         }
+         runwayPlanStale = false;
+         Metrics::add(Metric::RUNWAY_REPLANS);
+     }
+     
+     bool isPlanned(const Aircraft& aircraft) const {
+         for (const PlannedMovement& movement : runwayPlan) {
+             if (movement.aircraft.get() == &aircraft) {
+                 return true;
+             }
+         }
+         return false;
+     }
+     
+     // Refill the plan after movements left it. The flights added rank below
+     // everything already planned, so appending them gives the same plan as
+     // planning again from scratch.
+     void topUpRunwayPlan() {
+         collectRunwayCandidates();
+         for (const PlannedMovement& candidate : runwayCandidates) {
+             if (runwayPlan.size() >= RUNWAY_PLAN_FLIGHTS) {
+                 break;
+             }
+             if (!isPlanned(*candidate.aircraft)) {
+                 planMovement(candidate);
+             }
+         }
+     }
+     
+     // A flight joined a runway queue. One ranking below everything planned is
+     // appended (or left out when the plan is full); anything better, such as
+     // an emergency, means planning again before the next dispatch.
+     void planNewFlight(const shared_ptr<Aircraft>& flight, RunwayQueue<CompareAircraftPriority>* queue, Runway homeRunway) {
+         if (runwayPlanning != RunwayPlanning::LOOKAHEAD || runwayPlanStale) {
+             return;
+         }
+         if (!runwayPlan.empty() && ranksAbove(flight, runwayPlan.back().aircraft)) {
+             runwayPlanStale = true;
+             return;
+         }
+         if (runwayPlan.size() < RUNWAY_PLAN_FLIGHTS) {
+             planMovement({flight, queue, homeRunway, Runway::NONE, 0});
+         }
+     }
+     
+     // Hand out the runways whose planned start has come. A runway that is not
+     // free when the plan said it would be means the plan is redone next tick.
+     void dispatchPlannedRunways() {
+         if (runwayPlanStale) {
+             replanRunways();
+         }
+         
+         bool moved = false;
+         for (size_t i = 0; i < runwayPlan.size();) {
+             PlannedMovement& movement = runwayPlan[i];
+             if (movement.start > currentSimulationTime) {
+                 i++;
+                 continue;
+             }
+             const char* note = (movement.runway == Runway::RWY_C && movement.homeRunway != Runway::RWY_C &&
+                                 movement.aircraft->type == FlightType::COMMERCIAL) ? " (fallback)" : "";
+             if (!movement.queue->contains(movement.aircraft->id) ||
+                 !occupyRunway(movement.aircraft, movement.runway, note)) {
+                 runwayPlanStale = true;
+                 i++;
+                 continue;
+             }
+             movement.queue->remove(movement.aircraft->id);
+             runwayPlan.erase(runwayPlan.begin() + i);
+             moved = true;
+         }
+         
+         if (moved && !runwayPlanStale) {
+             topUpRunwayPlan();
+         }
+         for (RunwaySlots& slots : runwaySlots) {
+             slots.expire(currentSimulationTime);
+         }
+     }
+     
+     void assignRunways() {
+         if (runwayPlanning == RunwayPlanning::LOOKAHEAD) {
+             dispatchPlannedRunways();
+         } else if (isRunwayFree(Runway::RWY_A) || isRunwayFree(Runway::RWY_B) || isRunwayFree(Runway::RWY_C)) {
+             // Greedy, skipping the queues entirely while every runway is occupied
+             // Process runway A queue (North/South arrivals)
+             dispatchQueue(runwayAQueue, Runway::RWY_A);
+             
+             // Process runway B queue (East/West departures)
+             dispatchQueue(runwayBQueue, Runway::RWY_B);
+             
+             // Process runway C queue (emergency/cargo overflow)
+             dispatchQueue(runwayCQueue, Runway::RWY_C);
+         }
+     
+         // Release runways cleared since the last tick
+         for (Aircraft* flight : pendingReleases) {
+             releaseRunway(*flight);
+         }
+         pendingReleases.clear();
+     }
+     
+     void releaseRunway(Aircraft& flight) {
+         Runway runway = flight.assignedRunway;
+         if (runway == Runway::NONE) {
+             return;
+         }
+         flight.assignedRunway = Runway::NONE;
+         if (flight.tableRow >= 0) {
+             fleet.setRunway(flight.tableRow, Runway::NONE);
+         }
+     
+         if (runway == Runway::RWY_A) {
+             lock_guard<mutex> lock(runwayAMutex);
+             runwayAAvailable = true;
+             runwayAOccupant = nullptr;
+             runwayAFreeTime = currentSimulationTime;
+             LogLine(LogLevel::EVENT) << "Released RWY-A from " << flight.flightNumber << " (" << flight.airline << ")";
+         } else if (runway == Runway::RWY_B) {
+             lock_guard<mutex> lock(runwayBMutex);
+             runwayBAvailable = true;
+             runwayBOccupant = nullptr;
+             runwayBFreeTime = currentSimulationTime;
+             LogLine(LogLevel::EVENT) << "Released RWY-B from " << flight.flightNumber << " (" << flight.airline << ")";
+         } else if (runway == Runway::RWY_C) {
+             lock_guard<mutex> lock(runwayCMutex);
+             runwayCAvailable = true;
+             runwayCOccupant = nullptr;
+             runwayCFreeTime = currentSimulationTime;
+             LogLine(LogLevel::EVENT) << "Released RWY-C from " << flight.flightNumber << " (" << flight.airline << ")";
+         }
+     }
+     
+     // Subscribe to a new flight's phase transitions and give it a flight table row
+     void trackFlight(Aircraft& flight) {
+         flight.queuedAt = currentSimulationTime;
+         flight.setEventListener([this](Aircraft& aircraft, FlightEvent event) {
+             onFlightEvent(aircraft, event);
+         });
+         
+         if (useFlightTable) {
+             fleet.add(flight);
+         }
+     }
+     
+     // A cleared runway is handed back at the next assignRunways(), same as the old per-tick scan
+     void onFlightEvent(Aircraft& aircraft, FlightEvent event) {
+         if (event == FlightEvent::RUNWAY_CLEARED && aircraft.assignedRunway != Runway::NONE) {
+             if (parallelUpdate) {
+                 workerReleases[ThreadPool::currentWorker()].push_back(&aircraft);
+             } else {
+                 pendingReleases.push_back(&aircraft);
+             }
+         }
+     }
+     
+     // Below this many flights per thread the pool costs more than it saves
+     static constexpr size_t PARALLEL_MIN_FLIGHTS_PER_THREAD = 64;
+     
+     bool shouldRunParallel(size_t flights) const {
+         return threadPool && flights >= threadPool->size() * PARALLEL_MIN_FLIGHTS_PER_THREAD;
+     }
+     
+     void updateFlights() {
+         if (useFlightTable) {
+             updateFlightTable();
+             return;
+         }
+         
+         if (shouldRunParallel(activeFlights.size())) {
+             updateFlightsParallel();
+             return;
+         }
+         
+         for (auto& flight : activeFlights) {
+             flight->updateStatus(currentSimulationTime);
+             issueViolationNotice(*flight);
+         }
+     }
+     
+     // Each aircraft's state machine only touches its own fields, so updateStatus()
+     // runs across the pool. Runway releases and violations are collected per worker
+     // and merged afterwards in flight order, the order a serial pass produces.
+     void updateFlightsParallel() {
+         size_t threads = threadPool->size();
+         workerViolators.resize(threads);
+         workerReleases.resize(threads);
+         
+         parallelUpdate = true;
+         threadPool->parallelFor(activeFlights.size(), [this](size_t begin, size_t end) {
+             vector<Aircraft*>& violators = workerViolators[ThreadPool::currentWorker()];
+             for (size_t i = begin; i < end; i++) {
+                 Aircraft& flight = *activeFlights[i];
+                 flight.updateStatus(currentSimulationTime);
+                 if (flight.hasActiveViolation && !flight.currentViolation) {
+                     violators.push_back(&flight);
+                 }
+             }
+         });
+         parallelUpdate = false;
+         
+         for (auto& releases : workerReleases) {
+             pendingReleases.insert(pendingReleases.end(), releases.begin(), releases.end());
+             releases.clear();
+         }
+         for (auto& violators : workerViolators) {
+             for (Aircraft* flight : violators) {
+                 issueViolationNotice(*flight);
+             }
+             violators.clear();
+         }
+     }
+     
+     // Columnar phase update, then write back only the rows that changed and
+     // issue the AVNs for the violator bitmap, in row order
+     void updateFlightTable() {
+         fleet.update(shouldRunParallel(fleet.size()) ? threadPool.get() : nullptr);
+         
+         for (uint32_t row : fleet.getChangedRows()) {
+             Aircraft& flight = fleet.writeBack(row);
+             uint8_t changes = fleet.getChanges(row);
+             
+             if (changes & FlightTable::CHANGED_STATE) {
+                 onFlightEvent(flight, FlightEvent::STATE_CHANGED);
+                 if (fleet.clearedRunway(row)) {
+                     onFlightEvent(flight, FlightEvent::RUNWAY_CLEARED);
+                 } else if (fleet.reachedFinalState(row)) {
+                     onFlightEvent(flight, FlightEvent::COMPLETED);
+                 }
+             }
+         }
+         
+         const vector<uint64_t>& violators = fleet.getViolators();
+         for (size_t word = 0; word < violators.size(); word++) {
+             for (uint64_t bits = violators[word]; bits != 0; bits &= bits - 1) {
+                 size_t row = word * VIOLATION_BITMAP_ROWS + __builtin_ctzll(bits);
+                 Aircraft& flight = fleet.getOwner(row);
+                 flight.raiseViolation(fleet.getLimitMin(row), fleet.getLimitMax(row));
+                 issueViolationNotice(flight);
+                 fleet.recordViolation(row);
+             }
+         }
+     }
+     
+     // Issue the AVN for a flight's newly raised violation and pass it on to its
+     // airline, the AVN list and the AVN Generator
+     void issueViolationNotice(Aircraft& flight) {
+         if (flight.hasActiveViolation && !flight.currentViolation) {
+             flight.issueAVN();
+         }
+         
+         // Check if flight has active violation
+         if (flight.hasActiveViolation && flight.currentViolation) {
+             // Add violation to airline's record
+             if (flight.airlineId < airlines.size()) {
+                 airlines[flight.airlineId]->addViolation(flight.currentViolation);
+                 
+                 // Add to the global list of AVNs
+                 allAVNs.push_back(flight.currentViolation);
+                 Metrics::add(Metric::AVNS_ISSUED);
+                 addAVNToStatusBoard(*flight.currentViolation);
+                 scheduleDeadlines(*flight.currentViolation);
+                 analytics.recordIssued(*flight.currentViolation, flight.getStateString(), currentSimulationTime);
+                 if (avnTable) {
+                     avnTable->publish(flight.currentViolation->toRecord(), flight.airline);
+                 }
+                 if (journal) {
+                     journal->recordIssued(*flight.currentViolation);
+                 }
+                 
+                 // Notify AVN Generator with a new IPC message
+                 IPCMessage message;
+                 message.type = MessageType::AVN_CREATED;
+                 message.avnId = flight.currentViolation->id;
+                 strncpy(message.airline, flight.airline.c_str(), sizeof(message.airline) - 1);
+                 message.airline[sizeof(message.airline) - 1] = '\0';
+                 strncpy(message.flightNumber, flight.flightNumber.c_str(), sizeof(message.flightNumber) - 1);
+                 message.flightNumber[sizeof(message.flightNumber) - 1] = '\0';
+                 message.amount = flight.currentViolation->totalAmount; // Forwarded as is if the AVN stayed private
+                 message.minSpeed = flight.currentViolation->permissibleSpeedMin;
+                 message.maxSpeed = flight.currentViolation->permissibleSpeedMax;
+                 strncpy(message.details, (flight.type == FlightType::COMMERCIAL) ? "COMMERCIAL" : "CARGO", sizeof(message.details) - 1);
+                 message.details[sizeof(message.details) - 1] = '\0';
+                 
+                 if (!avnChannel.queue(message)) {
+                     // Counted as IPC_REFUSED; name the AVN so the gap can be traced
+                     LogLine(LogLevel::WARN) << "AVN #" << message.avnId << " (" << flight.flightNumber
+                                             << ") not sent to the AVN Generator: backlog full";
+                 }
+                 
+                 // Reset violation flag and clear current violation
+                 flight.hasActiveViolation = false;
+                 flight.currentViolation.reset();
+             }
+         }
+     }
+     
+     void moveCompletedFlights() {
+         // Last tick's completed flights have cleared the release pass by now
+         for (const auto& flight : retiring) {
+             archiveFlight(*flight);
+         }
+         retiring.clear();
+         
+         // Compact the active list in place; flights are moved, never copied
+         size_t kept = 0;
+         for (size_t i = 0; i < activeFlights.size(); i++) {
+             shared_ptr<Aircraft>& flight = activeFlights[i];
+             if (flight->isCompleted()) {
+                 LogLine(LogLevel::EVENT) << "\nFlight completed: " << flight->flightNumber 
+                      << " (" << flight->airline << ")";
+                 if (handoff && flight->getPhaseKind() == DEPARTURE_PHASES) {
+                     handoff->depart(*flight, currentSimulationTime);
+                 }
+                 
+                 (archiveCompleted ? retiring : completedFlights).push_back(move(flight));
+             } else {
+                 if (kept != i) {
+                     activeFlights[kept] = move(flight);
+                 }
+                 kept++;
+             }
+         }
+         activeFlights.resize(kept);
+         if (useFlightTable) {
+             fleet.removeCompleted();
+         }
+     }
+     
+     // Queue the changes since the last status frame as one INFO block, so it is
+     // never interleaved with event lines. Frames are skipped while the refresh
+     // rate cap has not elapsed; the next one covers everything since.
+     void printStatus() {
+         if (!Logger::enabled(LogLevel::INFO) || !statusBoard.due()) {
+             return;
+         }
+         
+         statusBoard.beginFrame();
+         statusBoard.set(StatusRenderer::SUMMARY, "time", "Simulation Time: " + to_string(currentSimulationTime) + " seconds");
+         statusBoard.set(StatusRenderer::SUMMARY, "active", "Active Flights: " + to_string(activeFlights.size()));
+         statusBoard.set(StatusRenderer::SUMMARY, "completed", "Completed Flights: " + to_string(getCompletedFlightCount()));
+         
+         // Runway status
+         statusBoard.set(StatusRenderer::RUNWAYS, "runwayA", string("Runway A: ") + (runwayAOccupant ? runwayAOccupant->flightNumber + " (" + runwayAOccupant->airline + ")" : "Free"));
+         statusBoard.set(StatusRenderer::RUNWAYS, "runwayB", string("Runway B: ") + (runwayBOccupant ? runwayBOccupant->flightNumber + " (" + runwayBOccupant->airline + ")" : "Free"));
+         statusBoard.set(StatusRenderer::RUNWAYS, "runwayC", string("Runway C: ") + (runwayCOccupant ? runwayCOccupant->flightNumber + " (" + runwayCOccupant->airline + ")" : "Free"));
+         
+         // Queue status
+         statusBoard.set(StatusRenderer::QUEUES, "queueA", "Runway A Queue: " + to_string(runwayAQueue.size()) + " flights waiting");
+         statusBoard.set(StatusRenderer::QUEUES, "queueB", "Runway B Queue: " + to_string(runwayBQueue.size()) + " flights waiting");
+         statusBoard.set(StatusRenderer::QUEUES, "queueC", "Runway C Queue: " + to_string(runwayCQueue.size()) + " flights waiting");
+         
+         // Active flights
+         for (const auto& flight : activeFlights) {
+             ostringstream key;
+             key << "flight:" << setw(10) << setfill('0') << flight->id;
+             statusBoard.item(StatusRenderer::FLIGHTS, key.str(), flight->getSummary());
+         }
+         
+         // Unpaid AVNs are kept on the board as they are issued and paid
+         if (!statusBoard.drawn()) {
+             for (const auto& avn : allAVNs) {
+                 if (avn->status != PaymentStatus::PAID) {
+                     keepAVNRow(*avn);
+                 }
+             }
+         }
+         if (allAVNs.empty()) {
+             statusBoard.set(StatusRenderer::AVNS, "avns", "No AVNs issued yet.");
+         } else if (unpaidAVNCount == 0) {
+             statusBoard.set(StatusRenderer::AVNS, "avns", "All AVNs have been paid.");
+         } else {
+             statusBoard.set(StatusRenderer::AVNS, "avns", to_string(unpaidAVNCount) + " of " + to_string(allAVNs.size()) + " AVNs unpaid");
+         }
+         
+         const string text = statusBoard.endFrame();
+         if (!text.empty()) {
+             Logger::instance().write(text.data(), text.size());
+         }
+     }
+     
+     void processAVNPayment(int avnId, double amount) {
+         for (auto& avn : allAVNs) {
+             if (avn->id == avnId) {
+                 if (amount >= avn->totalAmount) {
+                     avnPaid(*avn, amount);
+                     
+                     lock_guard<mutex> lock(cout_mutex);
+                     cout << "\nPayment processed for AVN #" << avnId << " - PKR " << fixed << setprecision(2) << amount << endl;
+                     cout << "AVN status updated to PAID." << endl;
+                 } else {
+                     lock_guard<mutex> lock(cout_mutex);
+                     cout << "\nInsufficient payment for AVN #" << avnId << ". Required: PKR " << fixed << setprecision(2) << avn->totalAmount << endl;
+                 }
+                 return;
+             }
+         }
+         
+         lock_guard<mutex> lock(cout_mutex);
+         cout << "\nAVN #" << avnId << " not found." << endl;
+     }
+     
+     void displayAVNDetails(int avnId) {
+         for (const auto& avn : allAVNs) {
+             if (avn->id == avnId) {
+                 avn->printDetails();
+                 return;
+             }
+         }
+         
+         lock_guard<mutex> lock(cout_mutex);
+         cout << "\nAVN #" << avnId << " not found." << endl;
+     }
      
-     bool isCompleted() const override {
-         return state == DepartureState::CRUISE;
+     void displayAirlineViolations(const string& airlineName) {
+         if (Airline* airline = findAirline(airlineName)) {
+             airline->printViolations();
+         } else {
+             lock_guard<mutex> lock(cout_mutex);
+             cout << "\nAirline '" << airlineName << "' not found." << endl;
+         }
      }
- };
- 
- // Flight Scheduler
- class FlightScheduler {
- private:
-     vector<shared_ptr<Aircraft>> allFlights;
-     vector<shared_ptr<Aircraft>> activeFlights;
-     vector<shared_ptr<Aircraft>> completedFlights;
-     map<string, shared_ptr<Airline>> airlines;
-     vector<shared_ptr<AVN>> allAVNs;
- 
-     int currentSimulationTime;
-     int lastNorthArrival;
-     int lastSouthArrival;
-     int lastEastDeparture;
-     int lastWestDeparture;
      
-     // Mutexes for runway access control
-     mutex runwayAMutex;
-     mutex runwayBMutex;
-     mutex runwayCMutex;
+     const vector<shared_ptr<AVN>>& getAllAVNs() const {
+         return allAVNs;
+     }
      
-     // Runway availability flags
-     bool runwayAAvailable;
-     bool runwayBAvailable;
-     bool runwayCAvailable;
+     void displayAnalytics() const {
+         analytics.printDashboard();
+     }
      
-     // Priority queue comparator
-     struct CompareAircraftPriority {
-         bool operator()(const shared_ptr<Aircraft>& a, const shared_ptr<Aircraft>& b) {
-             // First by priority (higher number = higher priority)
-             if (a->priority != b->priority) {
-                 return a->priority < b->priority;
-             }
-             // Then by scheduled time
-             return a->scheduledTime > b->scheduledTime;
+     void attachJournal(AVNJournal* avnJournal) {
+         journal = avnJournal;
+         if (avnTable) {
+             // Portal payments wait in the table until they are journaled here
+             avnTable->deferPayments();
          }
-     };
-     
-     // Priority queues for runways
-     priority_queue<shared_ptr<Aircraft>, vector<shared_ptr<Aircraft>>, CompareAircraftPriority> runwayAQueue;
-     priority_queue<shared_ptr<Aircraft>, vector<shared_ptr<Aircraft>>, CompareAircraftPriority> runwayBQueue;
-     priority_queue<shared_ptr<Aircraft>, vector<shared_ptr<Aircraft>>, CompareAircraftPriority> runwayCQueue;
+     }
      
-     // Runway occupancy
-     shared_ptr<Aircraft> runwayAOccupant;
-     shared_ptr<Aircraft> runwayBOccupant;
-     shared_ptr<Aircraft> runwayCOccupant;
+     void attachSharedTable(SharedAVNTable* table) {
+         avnTable = table;
+     }
      
-     int runwayAFreeTime;
-     int runwayBFreeTime;
-     int runwayCFreeTime;
+     void attachHandoff(AirspaceHandoff* airspace) {
+         handoff = airspace;
+     }
      
-     int avnWritePipe; // Pipe to communicate with AVN Generator
+     // Take in AVNs paid through the portal since last called; only looks
+     // through the AVNs when some row of the shared table was paid or claimed
+     // meanwhile. Claimed payments are journaled and synced before their rows
+     // turn PAID, which is what lets the portal confirm them.
+     void takeInPayments() {
+         if (!avnTable) {
+             return;
+         }
+         uint32_t payments = avnTable->payments();
+         uint32_t claims = avnTable->claims();
+         if (payments == paymentsSeen && claims == claimsSeen) {
+             return;
+         }
+         paymentsSeen = payments;
+         claimsSeen = claims;
+         
+         vector<pair<AVN*, double>> claimed;
+         for (const auto& avn : allAVNs) {
+             double amount;
+             if (avn->status == PaymentStatus::PAID) {
+                 continue;
+             }
+             if (avnTable->paid(avn->id)) {
+                 avnPaid(*avn, avn->totalAmount);
+             } else if (avnTable->claimOf(avn->id, amount)) {
+                 claimed.emplace_back(avn.get(), amount);
+             }
+         }
+         if (claimed.empty()) {
+             return;
+         }
+         if (journal) {
+             for (const auto& claim : claimed) {
+                 journal->recordPaid(claim.first->id, claim.second);
+             }
+             journal->sync();
+         }
+         for (const auto& claim : claimed) {
+             avnPaid(*claim.first, claim.second, true);
+         }
+     }
      
- public:
-     FlightScheduler(int avnPipe) : currentSimulationTime(0), 
-     lastNorthArrival(0), lastSouthArrival(0),
-     lastEastDeparture(0), lastWestDeparture(0),
-     runwayAFreeTime(0), runwayBFreeTime(0), runwayCFreeTime(0),
-     avnWritePipe(avnPipe),
-     runwayAAvailable(true), runwayBAvailable(true), runwayCAvailable(true) {
-     // Initialize airlines
-     airlines["PIA"] = make_shared<Airline>("PIA", 6, 4);
-     airlines["AirBlue"] = make_shared<Airline>("AirBlue", 4, 4);
-     airlines["FedEx"] = make_shared<Airline>("FedEx", 3, 2);
-     airlines["Pakistan Airforce"] = make_shared<Airline>("Pakistan Airforce", 2, 1);
-     airlines["Blue Dart"] = make_shared<Airline>("Blue Dart", 2, 2);
-     airlines["AghaKhan Air Ambulance"] = make_shared<Airline>("AghaKhan Air Ambulance", 2, 1);
+     // Take over AVNs recovered from a journal, before the first tick
+     void restoreAVNs(const vector<shared_ptr<AVN>>& avns) {
+         for (const auto& avn : avns) {
+             adoptAVN(avn);
+             analytics.recordIssued(*avn, "Unknown", -1);
+             if (avn->status != PaymentStatus::PAID) {
+                 scheduleDeadlines(*avn);
+             }
+         }
      }
      
-     void updateSimulation() {
-         currentSimulationTime++;
+     // Write the complete scheduler state between two ticks to path. AVNs and
+     // flights go in full; the status board and metrics are display state and
+     // start over on restore.
+     bool saveCheckpoint(const string& path, string& error) {
+         if (useFlightTable) {
+             fleet.writeBackAll();
+         }
          
-         // Generate new flights
-         generateFlights();
+         CheckpointWriter out;
+         out.put(static_cast<int32_t>(currentSimulationTime));
+         out.put(static_cast<uint64_t>(flightsGenerated));
+         out.put(static_cast<int32_t>(Aircraft::getNextId()));
+         out.put(static_cast<int32_t>(Aircraft::getNextAvnId()));
+         out.put(trafficRng.getCounter());
+         out.put(static_cast<uint8_t>(wallClockDeadlines));
          
-         // Assign runways
-         assignRunways();
+         vector<int64_t> cursor;
+         traffic->saveCursor(cursor);
+         out.putVector(cursor);
          
-         // Update active flights
-         updateFlights();
+         // Airlines in id order
+         out.put(static_cast<uint32_t>(airlines.size()));
+         for (const auto& airline : airlines) {
+             out.putString(airline->name);
+             out.put(static_cast<int32_t>(airline->totalAircrafts));
+             out.put(static_cast<int32_t>(airline->activeFlights));
+             out.put(static_cast<uint8_t>(airline->kind));
+         }
          
-         // Move completed flights
-         moveCompletedFlights();
-     }
-     
-     int getCurrentTime() const {
-         return currentSimulationTime;
+         // AVNs in issue order, with their analytics row
+         unordered_map<const AVN*, int32_t> avnIndex;
+         out.put(static_cast<uint64_t>(allAVNs.size()));
+         for (const auto& avn : allAVNs) {
+             avnIndex[avn.get()] = static_cast<int32_t>(avnIndex.size());
+             string phase = "Unknown";
+             int issueTick = -1;
+             int paidTick = -1;
+             analytics.getTimeline(avn->id, phase, issueTick, paidTick);
+             out.put(avn->toRecord());
+             out.putString(avn->airline);
+             out.putString(phase);
+             out.put(static_cast<int32_t>(issueTick));
+             out.put(static_cast<int32_t>(paidTick));
+         }
+         
+         // Flights: active (in update order), completed (in completion order), then retiring
+         vector<pair<const Aircraft*, FlightList>> flights;
+         for (const auto& flight : activeFlights) {
+             flights.push_back({flight.get(), ACTIVE_FLIGHT});
+         }
+         for (const auto& flight : completedFlights) {
+             flights.push_back({flight.get(), COMPLETED_FLIGHT});
+         }
+         for (const auto& flight : retiring) {
+             flights.push_back({flight.get(), RETIRING_FLIGHT});
+         }
+         out.put(static_cast<uint64_t>(flights.size()));
+         for (const auto& entry : flights) {
+             out.put(toRecord(*entry.first, entry.second));
+             out.putString(entry.first->flightNumber);
+         }
+         
+         // Runways
+         putQueue(out, runwayAQueue);
+         putQueue(out, runwayBQueue);
+         putQueue(out, runwayCQueue);
+         for (const auto* occupant : {&runwayAOccupant, &runwayBOccupant, &runwayCOccupant}) {
+             out.put(idOf(*occupant));
+         }
+         for (bool available : {runwayAAvailable, runwayBAvailable, runwayCAvailable}) {
+             out.put(static_cast<uint8_t>(available));
+         }
+         for (int freeTime : {runwayAFreeTime, runwayBFreeTime, runwayCFreeTime}) {
+             out.put(static_cast<int32_t>(freeTime));
+         }
+         out.put(runwayMovements);
+         out.put(runwayDelayTicks);
+         vector<int32_t> releases;
+         for (const Aircraft* flight : pendingReleases) {
+             releases.push_back(flight->id);
+         }
+         out.putVector(releases);
+         
+         out.putVector(flightArchive);
+         
+         // AVN deadlines, with each AVN as its position in allAVNs
+         avnDeadlines.save(out, [&avnIndex](CheckpointWriter& writer, const AVNDeadline& deadline) {
+             auto it = avnIndex.find(deadline.avn);
+             writer.put(it == avnIndex.end() ? int32_t(-1) : it->second);
+             writer.put(deadline.kind);
+         });
+         
+         return CheckpointImage::write(path, out, currentSimulationTime, error);
      }
      
-     void generateFlights() {
-         // North arrivals (every 3 minutes)
-         if (currentSimulationTime - lastNorthArrival >= ARRIVAL_NORTH_INTERVAL || currentSimulationTime == 1) {
-             lastNorthArrival = currentSimulationTime;
-             
-             // Determine if this is an emergency
-             uniform_int_distribution<> emergencyDist(1, 100);
-             bool isEmergency = (emergencyDist(gen) <= NORTH_EMERGENCY_PROBABILITY);
-             
-             // Select airline randomly
-             vector<string> airlineNames;
-             for (const auto& pair : airlines) {
-                 if (pair.second->activeFlights > 0) {
-                     airlineNames.push_back(pair.first);
-                 }
+     // Put a fresh scheduler (no ticks run yet) in the state a checkpoint recorded.
+     // The traffic source and attachments must already be in place.
+     bool restoreCheckpoint(const CheckpointImage& image, string& error) {
+         CheckpointReader in = image.reader();
+         
+         currentSimulationTime = in.get<int32_t>();
+         flightsGenerated = in.get<uint64_t>();
+         int nextFlightId = in.get<int32_t>();
+         int nextAvnId = in.get<int32_t>();
+         trafficRng.setCounter(in.get<uint64_t>());
+         if (in.get<uint8_t>() != static_cast<uint8_t>(wallClockDeadlines)) {
+             error = "checkpoint was taken with the other --avn-clock";
+             return false;
+         }
+         
+         vector<int64_t> cursor;
+         in.getVector(cursor);
+         traffic->restoreCursor(cursor);
+         
+         // Airlines replace the built-in ones, keeping their ids
+         uint32_t airlineCount = in.get<uint32_t>();
+         if (!in.fits(airlineCount, sizeof(uint32_t) + 9)) {
+             error = "truncated airline table";
+             return false;
+         }
+         airlineSymbols = StringInterner();
+         airlines.clear();
+         spawningAirlines.clear();
+         for (uint32_t i = 0; i < airlineCount; i++) {
+             string name = in.getString();
+             int totalAircrafts = in.get<int32_t>();
+             int active = in.get<int32_t>();
+             AirlineKind kind = static_cast<AirlineKind>(in.get<uint8_t>());
+             airlineSymbols.intern(name);
+             if (active > 0) {
+                 spawningAirlines.push_back(airlines.size());
              }
-             
-             uniform_int_distribution<> airlineDist(0, airlineNames.size() - 1);
-             string airline = airlineNames[airlineDist(gen)];
-             
-             // Determine flight type
-             FlightType type = FlightType::COMMERCIAL;
-             if (airline == "FedEx" || airline == "Blue Dart") {
-                 type = FlightType::CARGO;
+             airlines.push_back(make_shared<Airline>(name, totalAircrafts, active, kind));
+         }
+         
+         uint64_t avnCount = in.get<uint64_t>();
+         if (!in.fits(avnCount, sizeof(AVNRecord))) {
+             error = "truncated AVN list";
+             return false;
+         }
+         for (uint64_t i = 0; i < avnCount; i++) {
+             AVNRecord record = in.get<AVNRecord>();
+             string airline = in.getString();
+             string phase = in.getString();
+             int issueTick = in.get<int32_t>();
+             int paidTick = in.get<int32_t>();
+             auto avn = makePooled<AVN>(record, airline);
+             adoptAVN(avn);
+             analytics.recordIssued(*avn, phase, issueTick, paidTick);
+         }
+         
+         uint64_t flightCount = in.get<uint64_t>();
+         if (!in.fits(flightCount, sizeof(FlightRecord))) {
+             error = "truncated flight list";
+             return false;
+         }
+         unordered_map<int, shared_ptr<Aircraft>> flightById;
+         vector<shared_ptr<Aircraft>> everyFlight;
+         for (uint64_t i = 0; i < flightCount; i++) {
+             FlightRecord record = in.get<FlightRecord>();
+             string flightNumber = in.getString();
+             if (!in.ok() || record.airlineId >= airlines.size() || record.list > RETIRING_FLIGHT ||
+                 record.phase > FlightTable::FINAL_STATE) {
+                 error = "bad flight record";
+                 return false;
              }
-             if (isEmergency || airline == "Pakistan Airforce") {
-                 type = FlightType::EMERGENCY;
+             shared_ptr<Aircraft> flight = fromRecord(record, flightNumber);
+             flight->setEventListener([this](Aircraft& aircraft, FlightEvent event) {
+                 onFlightEvent(aircraft, event);
+             });
+             switch (record.list) {
+                 case ACTIVE_FLIGHT:
+                     activeFlights.push_back(flight);
+                     if (useFlightTable) {
+                         fleet.add(*flight);
+                     }
+                     break;
+                 case COMPLETED_FLIGHT:
+                     completedFlights.push_back(flight);
+                     break;
+                 case RETIRING_FLIGHT:
+                     retiring.push_back(flight);
+                     break;
+                 default:
+                     break;
              }
-             
-             // Create flight number
-             stringstream ssFlightNum;
-             ssFlightNum << airline.substr(0, 2) << "-" << (1000 + allFlights.size());
-             string flightNumber = ssFlightNum.str();
-             
-             // Set priority (emergency = 3, cargo = 2, commercial = 1)
-             int priority = (isEmergency) ? 3 : ((type == FlightType::CARGO) ? 2 : 1);
-             
-             // Create arrival flight
-             auto flight = make_shared<ArrivalFlight>(
-                 flightNumber, airline, type, Direction::NORTH, priority,
-                 chrono::system_clock::now()
-             );
-             flight->isEmergency = isEmergency;
-             
-             allFlights.push_back(flight);
-             activeFlights.push_back(flight);
-             
-             // Add to runway A queue (north arrivals)
-             runwayAQueue.push(flight);
-             
-             lock_guard<mutex> lock(cout_mutex);
-             cout << "\nNew North Arrival: " << flight->getSummary() << endl;
+             flightById[flight->id] = flight;
+             everyFlight.push_back(flight);
+         }
+         // allFlights is in creation order, which ids follow
+         if (!archiveCompleted) {
+             sort(everyFlight.begin(), everyFlight.end(), [](const shared_ptr<Aircraft>& a, const shared_ptr<Aircraft>& b) {
+                 return a->id < b->id;
+             });
+             allFlights = move(everyFlight);
          }
          
-         // South arrivals (every 2 minutes)
-         if (currentSimulationTime - lastSouthArrival >= ARRIVAL_SOUTH_INTERVAL || currentSimulationTime == 2) {
-             lastSouthArrival = currentSimulationTime;
-             
-             // Determine if this is an emergency
-             uniform_int_distribution<> emergencyDist(1, 100);
-             bool isEmergency = (emergencyDist(gen) <= SOUTH_EMERGENCY_PROBABILITY);
-             
-             // Select airline randomly
-             vector<string> airlineNames;
-             for (const auto& pair : airlines) {
-                 if (pair.second->activeFlights > 0) {
-                     airlineNames.push_back(pair.first);
+         auto flightFor = [&flightById](int32_t id) -> shared_ptr<Aircraft> {
+             auto it = flightById.find(id);
+             return it == flightById.end() ? nullptr : it->second;
+         };
+         
+         for (auto* queue : {&runwayAQueue, &runwayBQueue, &runwayCQueue}) {
+             vector<int32_t> ids;
+             in.getVector(ids);
+             for (int32_t id : ids) {
+                 shared_ptr<Aircraft> flight = flightFor(id);
+                 if (!flight) {
+                     error = "queued flight missing";
+                     return false;
                  }
+                 queue->push(flight);
              }
-             
-             uniform_int_distribution<> airlineDist(0, airlineNames.size() - 1);
-             string airline = airlineNames[airlineDist(gen)];
-             
-             // Determine flight type
-             FlightType type = FlightType::COMMERCIAL;
-             if (airline == "FedEx" || airline == "Blue Dart") {
-                 type = FlightType::CARGO;
+         }
+         for (auto* occupant : {&runwayAOccupant, &runwayBOccupant, &runwayCOccupant}) {
+             *occupant = flightFor(in.get<int32_t>());
+         }
+         for (bool* available : {&runwayAAvailable, &runwayBAvailable, &runwayCAvailable}) {
+             *available = in.get<uint8_t>() != 0;
+         }
+         for (int* freeTime : {&runwayAFreeTime, &runwayBFreeTime, &runwayCFreeTime}) {
+             *freeTime = in.get<int32_t>();
+         }
+         runwayMovements = in.get<uint64_t>();
+         runwayDelayTicks = in.get<uint64_t>();
+         runwayPlanStale = true;
+         vector<int32_t> releases;
+         in.getVector(releases);
+         for (int32_t id : releases) {
+             shared_ptr<Aircraft> flight = flightFor(id);
+             if (!flight) {
+                 error = "released flight missing";
+                 return false;
+             }
+             pendingReleases.push_back(flight.get());
+         }
+         
+         in.getVector(flightArchive);
+         
+         bool deadlinesRead = avnDeadlines.load(in, [this](CheckpointReader& reader, AVNDeadline& deadline) {
+             int32_t index = reader.get<int32_t>();
+             deadline.kind = reader.get<DeadlineKind>();
+             deadline.avn = (index >= 0 && static_cast<size_t>(index) < allAVNs.size()) ? allAVNs[index].get() : nullptr;
+             return index < 0 || deadline.avn != nullptr;
+         });
+         
+         if (!deadlinesRead || !in.ok() || !in.atEnd()) {
+             error = "truncated or corrupt image";
+             return false;
+         }
+         Aircraft::restoreIdCounters(nextFlightId, nextAvnId);
+         return true;
+     }
+     
+     const vector<shared_ptr<Airline>>& getAirlines() const {
+         return airlines;
+     }
+
+     // Flights given a runway so far, and the mean ticks they waited for it once ready
+     uint64_t getRunwayMovements() const {
+         return runwayMovements;
+     }
+     
+     double getAverageRunwayDelay() const {
+         return runwayMovements ? static_cast<double>(runwayDelayTicks) / runwayMovements : 0.0;
+     }
+     
+     size_t getQueuedFlightCount() const {
+         return runwayAQueue.size() + runwayBQueue.size() + runwayCQueue.size();
+     }
+     
+     // Ticks the flights still waiting have been ready for a runway, in total
+     uint64_t getQueuedRunwayDelay() const {
+         uint64_t ticks = 0;
+         for (const auto* queue : {&runwayAQueue, &runwayBQueue, &runwayCQueue}) {
+             for (const auto& flight : queue->items()) {
+                 ticks += runwayDelay(*flight);
              }
-             if (isEmergency || airline == "AghaKhan Air Ambulance") {
-                 type = FlightType::EMERGENCY;
+         }
+         return ticks;
+     }
+     
+     size_t getActiveFlightCount() const {
+         return activeFlights.size();
+     }
+
+     size_t getCompletedFlightCount() const {
+         return completedFlights.size() + retiring.size() + flightArchive.size();
+     }
+ };
+ 
+ // AVN Generator Process
+ class AVNGenerator {
+ private:
+     SharedAVNTable* avnTable; // The AVNs themselves, filled by the ATC Controller
+     vector<MessageChannel*> inputs; // One per airport's ATC Controller, then StripePay's
+     FrameWriter output; // Replies to the Airline Portal, flushed after each batch
+     vector<IPCMessage> unrecorded; // Confirmations held back until the controller records the payment
+     
+     // Send the held back confirmations whose rows have turned PAID
+     void confirmRecorded() {
+         auto recorded = [this](const IPCMessage& confirmation) {
+             if (!avnTable->paid(confirmation.avnId)) {
+                 return false;
              }
-             
-             // Create flight number
-             stringstream ssFlightNum;
-             ssFlightNum << airline.substr(0, 2) << "-" << (1000 + allFlights.size());
-             string flightNumber = ssFlightNum.str();
-             
-             // Set priority (emergency = 3, cargo = 2, commercial = 1)
-             int priority = (isEmergency) ? 3 : ((type == FlightType::CARGO) ? 2 : 1);
-                         
-             // Create arrival flight
-             auto flight = make_shared<ArrivalFlight>(
-                 flightNumber, airline, type, Direction::SOUTH, priority,
-                 chrono::system_clock::now()
-             );
-             flight->isEmergency = isEmergency;
-             
-             allFlights.push_back(flight);
-             activeFlights.push_back(flight);
-             
-             // Add to runway A queue (south arrivals)
-             runwayAQueue.push(flight);
-             
-             lock_guard<mutex> lock(cout_mutex);
-             cout << "\nNew South Arrival: " << flight->getSummary() << endl;
+             confirmPayment(confirmation);
+             return true;
+         };
+         unrecorded.erase(remove_if(unrecorded.begin(), unrecorded.end(), recorded), unrecorded.end());
+     }
+     
+     void confirmPayment(const IPCMessage& confirmation) {
+         output.queue(confirmation);
+         LogLine(LogLevel::EVENT) << "[AVN Generator] Payment confirmed for AVN #" << confirmation.avnId 
+              << " - PKR " << fixed << setprecision(2) << confirmation.amount;
+     }
+     
+     // Several inputs (a sharded run, or StripePay when the portal runs):
+     // sleep on all of their links and drain whichever have batches, until
+     // every one has closed
+     void runMany() {
+         EventLoop loop;
+         vector<unique_ptr<FrameReader>> readers;
+         for (MessageChannel* input : inputs) {
+             readers.emplace_back(new FrameReader(input));
+             loop.watch(input->readinessFd(), [] {});
          }
          
-         // East departures (every 2.5 minutes)
-         if (currentSimulationTime - lastEastDeparture >= DEPARTURE_EAST_INTERVAL || currentSimulationTime == 3) {
-             lastEastDeparture = currentSimulationTime;
-             
-             // Determine if this is an emergency
-             uniform_int_distribution<> emergencyDist(1, 100);
-             bool isEmergency = (emergencyDist(gen) <= EAST_EMERGENCY_PROBABILITY);
-             
-             // Select airline randomly
-             vector<string> airlineNames;
-             for (const auto& pair : airlines) {
-                 if (pair.second->activeFlights > 0) {
-                     airlineNames.push_back(pair.first);
+         vector<IPCMessage> batch;
+         size_t open = readers.size();
+         while (open > 0) {
+             bool idle = true;
+             for (size_t i = 0; i < inputs.size(); i++) {
+                 if (!readers[i]->isClosed()) {
+                     idle = inputs[i]->prepareToSleep() && idle;
                  }
              }
+             loop.runOnce(idle ? 100 : 0);
              
-             uniform_int_distribution<> airlineDist(0, airlineNames.size() - 1);
-             string airline = airlineNames[airlineDist(gen)];
-             
-             // Determine flight type
-             FlightType type = FlightType::COMMERCIAL;
-             if (airline == "FedEx" || airline == "Blue Dart") {
-                 type = FlightType::CARGO;
-             }
-             if (isEmergency || airline == "Pakistan Airforce") {
-                 type = FlightType::EMERGENCY;
+             for (size_t i = 0; i < inputs.size(); i++) {
+                 FrameReader& reader = *readers[i];
+                 if (reader.isClosed()) {
+                     continue;
+                 }
+                 inputs[i]->doneSleeping();
+                 while (reader.read(batch, 0)) {
+                     for (const IPCMessage& message : batch) {
+                         processMessage(message);
+                     }
+                     batch.clear();
+                 }
+                 if (reader.isClosed()) {
+                     loop.unwatch(inputs[i]->readinessFd());
+                     open--;
+                 }
              }
-             
-             // Create flight number
-             stringstream ssFlightNum;
-             ssFlightNum << airline.substr(0, 2) << "-" << (2000 + allFlights.size());
-             string flightNumber = ssFlightNum.str();
-             
-             // Set priority (emergency = 3, cargo = 2, commercial = 1)
-             int priority = (isEmergency) ? 3 : ((type == FlightType::CARGO) ? 2 : 1);
-             
-             // Create departure flight
-             auto flight = make_shared<DepartureFlight>(
-                 flightNumber, airline, type, Direction::EAST, priority,
-                 chrono::system_clock::now()
-             );
-             flight->isEmergency = isEmergency;
-             
-             allFlights.push_back(flight);
-             activeFlights.push_back(flight);
-             
-             // Add to runway B queue (east departures)
-             runwayBQueue.push(flight);
-             
-             lock_guard<mutex> lock(cout_mutex);
-             cout << "\nNew East Departure: " << flight->getSummary() << endl;
+             confirmRecorded();
+             output.flush();
+         }
+     }
+     
+ public:
+     AVNGenerator(const vector<MessageChannel*>& in, MessageChannel* out, SharedAVNTable* table) 
+         : avnTable(table), inputs(in), output(out) {}
+     
+     void run() {
+         if (inputs.size() > 1) {
+             runMany();
+             output.drain(1000);
+             return;
          }
          
-         // West departures (every 4 minutes)
-         if (currentSimulationTime - lastWestDeparture >= DEPARTURE_WEST_INTERVAL || currentSimulationTime == 4) {
-             lastWestDeparture = currentSimulationTime;
-             
-             // Determine if this is an emergency
-             uniform_int_distribution<> emergencyDist(1, 100);
-             bool isEmergency = (emergencyDist(gen) <= WEST_EMERGENCY_PROBABILITY);
-             
-             // Select airline randomly
-             vector<string> airlineNames;
-             for (const auto& pair : airlines) {
-                 if (pair.second->activeFlights > 0) {
-                     airlineNames.push_back(pair.first);
-                 }
+         // Framed batches from the ATC Controller, drained a batch per read
+         FrameReader reader(inputs[0]);
+         vector<IPCMessage> batch;
+         
+         while (reader.read(batch)) {
+             for (const IPCMessage& message : batch) {
+                 processMessage(message);
              }
-             
-             uniform_int_distribution<> airlineDist(0, airlineNames.size() - 1);
-             string airline = airlineNames[airlineDist(gen)];
-             
-             // Determine flight type
-             FlightType type = FlightType::COMMERCIAL;
-             if (airline == "FedEx" || airline == "Blue Dart") {
-                 type = FlightType::CARGO;
+             batch.clear();
+             output.flush();
+         }
+         output.drain(1000);
+     }
+     
+     void processMessage(const IPCMessage& message) {
+         switch (message.type) {
+             case MessageType::AVN_CREATED: {
+                 // The controller published the AVN before sending the notice. One
+                 // the table had no room for is passed on as the controller sent it.
+                 IPCMessage response = avnTable->describe(message.avnId);
+                 if (strcmp(response.details, "NOT_FOUND") == 0) {
+                     LogLine(LogLevel::WARN) << "[AVN Generator] AVN #" << message.avnId << " is not in the shared table, forwarding the notice";
+                     response = message;
+                     strncpy(response.details, "UNPAID", sizeof(response.details) - 1);
+                 }
+                 
+                 // Send notification to Airline Portal
+                 response.type = MessageType::AVN_CREATED;
+                 output.queue(response);
+                 Metrics::add(Metric::AVN_NOTICES);
+                 
+                 LogLine(LogLevel::EVENT) << "[AVN Generator] Created AVN #" << response.avnId << " for " 
+                      << response.airline << " flight " << response.flightNumber 
+                      << " - PKR " << fixed << setprecision(2) << response.amount;
+                 break;
              }
-             if (isEmergency) {
-                 type = FlightType::EMERGENCY;
+                 
+             case MessageType::PAYMENT_CONFIRMATION: {
+                 IPCMessage details = avnTable->describe(message.avnId);
+                 IPCMessage response;
+                 response.type = MessageType::PAYMENT_CONFIRMATION;
+                 response.requestId = message.requestId;
+                 response.avnId = message.avnId;
+                 memcpy(response.airline, details.airline, sizeof(response.airline));
+                 response.amount = message.amount;
+                 
+                 // Update the AVN's status where every process sees it. A claimed
+                 // payment is confirmed once the controller has recorded it; any
+                 // other is confirmed at once, so the portal is never left waiting.
+                 SharedAVNTable::Claim claim = avnTable->claimPayment(message.avnId, message.amount);
+                 if (claim == SharedAVNTable::Claim::CLAIMED) {
+                     unrecorded.push_back(response);
+                     break;
+                 }
+                 if (claim == SharedAVNTable::Claim::NOT_FOUND) {
+                     LogLine(LogLevel::WARN) << "[AVN Generator] AVN #" << message.avnId << " is not in the shared table, status not recorded";
+                 } else if (claim == SharedAVNTable::Claim::ALREADY_PAID) {
+                     // Tell the portal instead of confirming a second payment
+                     LogLine(LogLevel::WARN) << "[AVN Generator] AVN #" << message.avnId << " was already paid, payment of PKR "
+                          << fixed << setprecision(2) << message.amount << " not applied";
+                     strncpy(response.details, "ALREADY_PAID", sizeof(response.details) - 1);
+                     output.queue(response);
+                     break;
+                 }
+                 confirmPayment(response);
+                 break;
              }
-             
-             // Create flight number
-             stringstream ssFlightNum;
-             ssFlightNum << airline.substr(0, 2) << "-" << (2000 + allFlights.size());
-             string flightNumber = ssFlightNum.str();
-             
-             // Set priority (emergency = 3, cargo = 2, commercial = 1)
-             int priority = (isEmergency) ? 3 : ((type == FlightType::CARGO) ? 2 : 1);
-             
-             // Create departure flight
-             auto flight = make_shared<DepartureFlight>(
-                 flightNumber, airline, type, Direction::WEST, priority,
-                 chrono::system_clock::now()
-             );
-             flight->isEmergency = isEmergency;
-             
-             allFlights.push_back(flight);
-             activeFlights.push_back(flight);
-             
-             // Add to runway B queue (west departures)
-             runwayBQueue.push(flight);
-             
-             lock_guard<mutex> lock(cout_mutex);
-             cout << "\nNew West Departure: " << flight->getSummary() << endl;
+                 
+             case MessageType::QUERY_AVN: {
+                 // The benchmark's IPC round trip; the portal reads the shared table itself.
+                 // Answer even when the AVN is unknown so the requester is not left waiting
+                 IPCMessage response = avnTable->describe(message.avnId);
+                 response.requestId = message.requestId;
+                 output.queue(response);
+                 break;
+             }
+                 
+             default:
+                 break;
          }
      }
+ };
+ 
+ // Airline Portal Process. Runs on an EventLoop over stdin and the AVN
+ // Generator's channel, so replies are shown the moment they arrive and
+ // several requests can be outstanding at once. Each request carries an id;
+ // the reply with the same id runs the callback registered for it.
+ class AirlinePortal {
+ private:
+     // What the next line typed on stdin answers
+     enum class InputState { MENU, AIRLINE_NAME, PAY_AVN_ID, PAY_AMOUNT, DETAILS_AVN_ID };
      
-     void assignRunways() {
-         // Temporary queues to hold unassigned flights
-         priority_queue<shared_ptr<Aircraft>, vector<shared_ptr<Aircraft>>, CompareAircraftPriority> tempAQueue;
-         priority_queue<shared_ptr<Aircraft>, vector<shared_ptr<Aircraft>>, CompareAircraftPriority> tempBQueue;
-         priority_queue<shared_ptr<Aircraft>, vector<shared_ptr<Aircraft>>, CompareAircraftPriority> tempCQueue;
-     
-         // Process runway A queue (North/South arrivals)
-         while (!runwayAQueue.empty()) {
-             shared_ptr<Aircraft> aircraft = runwayAQueue.top();
-             runwayAQueue.pop();
+     MessageChannel* inputChannel;
+     FrameReader fromAVNGenerator; // New AVNs and payment confirmations
+     FrameWriter toStripePay;
+     const SharedAVNTable* avnTable; // AVNs are read here directly, never asked for over IPC
      
-             // Skip if already assigned a runway
-             if (aircraft->assignedRunway != Runway::NONE) {
-                 tempAQueue.push(aircraft);
-                 continue;
-             }
+     EventLoop loop;
+     InputState state;
+     string typed;              // Stdin bytes not yet ending in a newline
+     int payingAVN;             // AVN being paid once the amount is entered
+     bool stdinClosed;
+     bool quit;
      
-             bool assigned = false;
+     uint32_t nextRequestId;
      
-             // Try RWY-C for emergency or cargo flights
-             if (aircraft->type == FlightType::EMERGENCY || aircraft->type == FlightType::CARGO) {
-                 lock_guard<mutex> lock(runwayCMutex);
-                 if (runwayCAvailable && currentSimulationTime >= runwayCFreeTime) {
-                     runwayCAvailable = false;
-                     runwayCOccupant = aircraft;
-                     aircraft->assignedRunway = Runway::RWY_C;
-                     assigned = true;
-                     lock_guard<mutex> coutLock(cout_mutex);
-                     cout << "Assigned RWY-C to " << aircraft->flightNumber << " (" << aircraft->airline << ")" << endl;
-                 }
+     void showListing(const AVNListingHeader& summary, const vector<AVNRecord>& listing) {
+         string airline(summary.airline, strnlen(summary.airline, sizeof(summary.airline)));
+         {
+             lock_guard<mutex> lock(cout_mutex);
+             cout << "\n===== AVNs for " << airline << " =====\n";
+             if (listing.empty()) {
+                 cout << "No AVNs found for this airline.\n";
              }
-     
-             // Try RWY-A for North/South arrivals
-             if (!assigned && (aircraft->direction == Direction::NORTH || aircraft->direction == Direction::SOUTH)) {
-                 lock_guard<mutex> lock(runwayAMutex);
-                 if (runwayAAvailable && currentSimulationTime >= runwayAFreeTime) {
-                     runwayAAvailable = false;
-                     runwayAOccupant = aircraft;
-                     aircraft->assignedRunway = Runway::RWY_A;
-                     assigned = true;
-                     lock_guard<mutex> coutLock(cout_mutex);
-                     cout << "Assigned RWY-A to " << aircraft->flightNumber << " (" << aircraft->airline << ")" << endl;
-                 }
+             for (const AVNRecord& avn : listing) {
+                 cout << "AVN #" << avn.id << " | " << string(avn.flightNumber, strnlen(avn.flightNumber, sizeof(avn.flightNumber)))
+                      << " | PKR " << fixed << setprecision(2) << avn.totalAmount 
+                      << " | " << SharedAVNTable::statusCode(avn.status) << "\n";
              }
+             cout << summary.totalCount << " AVNs, " << summary.unpaidCount << " unpaid, PKR "
+                  << fixed << setprecision(2) << summary.outstanding << " outstanding\n";
+             cout << "========================" << endl;
+         }
+     }
      
-             // Try RWY-C as fallback for non-cargo flights
-             if (!assigned && aircraft->type != FlightType::CARGO) {
-                 lock_guard<mutex> lock(runwayCMutex);
-                 if (runwayCAvailable && currentSimulationTime >= runwayCFreeTime) {
-                     runwayCAvailable = false;
-                     runwayCOccupant = aircraft;
-                     aircraft->assignedRunway = Runway::RWY_C;
-                     assigned = true;
-                     lock_guard<mutex> coutLock(cout_mutex);
-                     cout << "Assigned RWY-C (fallback) to " << aircraft->flightNumber << " (" << aircraft->airline << ")" << endl;
-                 }
+     // Read everything the AVN Generator has sent so far without waiting
+     void pumpReplies() {
+         vector<IPCMessage> batch;
+         while (fromAVNGenerator.read(batch, 0)) {
+             for (const IPCMessage& message : batch) {
+                 showMessage(message);
              }
+             batch.clear();
+         }
+     }
      
-             // If not assigned, re-queue
-             if (!assigned) {
-                 tempAQueue.push(aircraft);
+     void onStdinReadable() {
+         char chunk[1024];
+         ssize_t bytesRead = read(STDIN_FILENO, chunk, sizeof(chunk));
+         if (bytesRead <= 0) {
+             stdinClosed = true;
+             loop.unwatch(STDIN_FILENO);
+             return;
+         }
+         typed.append(chunk, bytesRead);
+         
+         size_t end;
+         while ((end = typed.find('\n')) != string::npos) {
+             string line = typed.substr(0, end);
+             typed.erase(0, end + 1);
+             if (!quit) {
+                 handleLine(line);
              }
          }
+     }
      
-         // Process runway B queue (East/West departures)
-         while (!runwayBQueue.empty()) {
-             shared_ptr<Aircraft> aircraft = runwayBQueue.top();
-             runwayBQueue.pop();
+     void prompt(const char* text) {
+         lock_guard<mutex> lock(cout_mutex);
+         cout << text << flush;
+     }
      
-             // Skip if already assigned a runway
-             if (aircraft->assignedRunway != Runway::NONE) {
-                 tempBQueue.push(aircraft);
-                 continue;
-             }
+     void handleLine(const string& line) {
+         switch (state) {
+             case InputState::MENU:
+                 switch (atoi(line.c_str())) {
+                     case 1:
+                         state = InputState::AIRLINE_NAME;
+                         prompt("Enter airline name: ");
+                         break;
+                     case 2:
+                         state = InputState::PAY_AVN_ID;
+                         prompt("Enter AVN ID to pay: ");
+                         break;
+                     case 3:
+                         state = InputState::DETAILS_AVN_ID;
+                         prompt("Enter AVN ID: ");
+                         break;
+                     case 4:
+                         prompt("Exiting Airline Portal.\n");
+                         quit = true;
+                         break;
+                     default:
+                         prompt("Invalid choice. Please try again.\n");
+                         displayMenu();
+                         break;
+                 }
+                 break;
+                 
+             case InputState::AIRLINE_NAME:
+                 viewAirlineAVNs(line);
+                 state = InputState::MENU;
+                 displayMenu();
+                 break;
+                 
+             case InputState::PAY_AVN_ID:
+                 payAVN(atoi(line.c_str()));
+                 break;
+                 
+             case InputState::PAY_AMOUNT:
+                 sendPayment(payingAVN, atof(line.c_str()));
+                 state = InputState::MENU;
+                 displayMenu();
+                 break;
+                 
+             case InputState::DETAILS_AVN_ID:
+                 viewAVNDetails(atoi(line.c_str()));
+                 state = InputState::MENU;
+                 displayMenu();
+                 break;
+         }
+     }
      
-             bool assigned = false;
+ public:
+     AirlinePortal(MessageChannel* read, MessageChannel* stripePay, const SharedAVNTable* table) 
+         : inputChannel(read), fromAVNGenerator(read), toStripePay(stripePay, FrameWriter::REFUSE), avnTable(table),
+           state(InputState::MENU), payingAVN(0), stdinClosed(false), quit(false), nextRequestId(1) {}
      
-             // Try RWY-C for emergency or cargo flights
-             if (aircraft->type == FlightType::EMERGENCY || aircraft->type == FlightType::CARGO) {
-                 lock_guard<mutex> lock(runwayCMutex);
-                 if (runwayCAvailable && currentSimulationTime >= runwayCFreeTime) {
-                     runwayCAvailable = false;
-                     runwayCOccupant = aircraft;
-                     aircraft->assignedRunway = Runway::RWY_C;
-                     assigned = true;
-                     lock_guard<mutex> coutLock(cout_mutex);
-                     cout << "Assigned RWY-C to " << aircraft->flightNumber << " (" << aircraft->airline << ")" << endl;
-                 }
-             }
+     void run() {
+         loop.watch(STDIN_FILENO, [this] { onStdinReadable(); });
+         loop.watch(inputChannel->readinessFd(), [this] { pumpReplies(); });
+         
+         displayMenu();
+         while (!quit && !stdinClosed && !fromAVNGenerator.isClosed()) {
+             // Sleep only if nothing arrived since the last pump
+             bool idle = inputChannel->prepareToSleep();
+             loop.runOnce(idle ? 100 : 0);
+             inputChannel->doneSleeping();
+             
+             pumpReplies();
+             toStripePay.flush();
+         }
+         
+         toStripePay.drain(1000);
+     }
      
-             // Try RWY-B for East/West departures
-             if (!assigned && (aircraft->direction == Direction::EAST || aircraft->direction == Direction::WEST)) {
-                 lock_guard<mutex> lock(runwayBMutex);
-                 if (runwayBAvailable && currentSimulationTime >= runwayBFreeTime) {
-                     runwayBAvailable = false;
-                     runwayBOccupant = aircraft;
-                     aircraft->assignedRunway = Runway::RWY_B;
-                     assigned = true;
-                     lock_guard<mutex> coutLock(cout_mutex);
-                     cout << "Assigned RWY-B to " << aircraft->flightNumber << " (" << aircraft->airline << ")" << endl;
-                 }
-             }
+     void displayMenu() {
+         lock_guard<mutex> lock(cout_mutex);
+         cout << "\n===== AIRLINE PORTAL =====\n";
+         cout << "1. View Airline AVNs\n";
+         cout << "2. Pay AVN\n";
+         cout << "3. View AVN Details\n";
+         cout << "4. Exit\n";
+         cout << "Enter your choice: " << flush;
+     }
      
-             // Try RWY-C as fallback for non-cargo flights
-             if (!assigned && aircraft->type != FlightType::CARGO) {
-                 lock_guard<mutex> lock(runwayCMutex);
-                 if (runwayCAvailable && currentSimulationTime >= runwayCFreeTime) {
-                     runwayCAvailable = false;
-                     runwayCOccupant = aircraft;
-                     aircraft->assignedRunway = Runway::RWY_C;
-                     assigned = true;
-                     lock_guard<mutex> coutLock(cout_mutex);
-                     cout << "Assigned RWY-C (fallback) to " << aircraft->flightNumber << " (" << aircraft->airline << ")" << endl;
-                 }
-             }
+     void viewAirlineAVNs(const string& airline) {
+         AVNListingHeader summary;
+         vector<AVNRecord> listing;
+         avnTable->listAirline(airline, summary, listing);
+         showListing(summary, listing);
+     }
      
-             // If not assigned, re-queue
-             if (!assigned) {
-                 tempBQueue.push(aircraft);
-             }
+     void payAVN(int avnId) {
+         // Show the AVN first, then ask for the amount if there is one
+         IPCMessage details = avnTable->describe(avnId);
+         showAVN(details, avnId);
+         if (strcmp(details.details, "NOT_FOUND") != 0) {
+             payingAVN = avnId;
+             state = InputState::PAY_AMOUNT;
+             prompt("Enter payment amount (PKR): ");
+         } else {
+             state = InputState::MENU;
+             displayMenu();
          }
+     }
      
-         // Process runway C queue (emergency/cargo overflow)
-         while (!runwayCQueue.empty()) {
-             shared_ptr<Aircraft> aircraft = runwayCQueue.top();
-             runwayCQueue.pop();
+     void sendPayment(int avnId, double amount) {
+         // Send payment request to StripePay; the confirmation comes back through the AVN Generator
+         IPCMessage paymentRequest;
+         paymentRequest.type = MessageType::PAYMENT_REQUEST;
+         paymentRequest.avnId = avnId;
+         paymentRequest.amount = amount;
+         paymentRequest.requestId = nextRequestId++;
+         
+         lock_guard<mutex> lock(cout_mutex);
+         if (!toStripePay.queue(paymentRequest)) {
+             cout << "StripePay is busy, payment for AVN #" << avnId << " not sent. Please try again." << endl;
+             return;
+         }
+         toStripePay.flush();
+         cout << "Payment request sent for AVN #" << avnId << " - PKR " << fixed << setprecision(2) << amount << endl;
+     }
      
-             // Skip if already assigned a runway
-             if (aircraft->assignedRunway != Runway::NONE) {
-                 tempCQueue.push(aircraft);
-                 continue;
-             }
+     void viewAVNDetails(int avnId) {
+         showAVN(avnTable->describe(avnId), avnId);
+     }
      
-             bool assigned = false;
+     void showAVN(const IPCMessage& reply, int avnId) {
+         lock_guard<mutex> lock(cout_mutex);
+         if (strcmp(reply.details, "NOT_FOUND") == 0) {
+             cout << "\nAVN #" << avnId << " not found." << endl;
+         } else {
+             cout << "\n===== AVN #" << reply.avnId << " =====\n";
+             cout << "Airline: " << reply.airline << endl;
+             cout << "Flight: " << reply.flightNumber << endl;
+             cout << "Amount: PKR " << fixed << setprecision(2) << reply.amount << endl;
+             cout << "Status: " << reply.details << endl;
+             cout << "========================" << endl;
+         }
+     }
      
-             // Try RWY-C for all flights in this queue
-             lock_guard<mutex> lock(runwayCMutex);
-             if (runwayCAvailable && currentSimulationTime >= runwayCFreeTime) {
-                 runwayCAvailable = false;
-                 runwayCOccupant = aircraft;
-                 aircraft->assignedRunway = Runway::RWY_C;
-                 assigned = true;
-                 lock_guard<mutex> coutLock(cout_mutex);
-                 cout << "Assigned RWY-C to " << aircraft->flightNumber << " (" << aircraft->airline << ")" << endl;
-             }
+     // What the AVN Generator sends: new AVNs and payment confirmations
+     void showMessage(const IPCMessage& message) {
+         lock_guard<mutex> lock(cout_mutex);
+         switch (message.type) {
+             case MessageType::AVN_CREATED:
+                 cout << "\n[Airline Portal] New AVN #" << message.avnId << " created for " 
+                      << message.airline << " flight " << message.flightNumber 
+                      << " - PKR " << fixed << setprecision(2) << message.amount << endl;
+                 break;
+                 
+             case MessageType::PAYMENT_CONFIRMATION:
+                 if (strcmp(message.details, "ALREADY_PAID") == 0) {
+                     cout << "\n[Airline Portal] AVN #" << message.avnId << " was already paid, payment of PKR "
+                          << fixed << setprecision(2) << message.amount << " not applied" << endl;
+                     break;
+                 }
+                 cout << "\n[Airline Portal] Payment confirmed for AVN #" << message.avnId 
+                      << " - PKR " << fixed << setprecision(2) << message.amount << endl;
+                 break;
+                 
+             default:
+                 break;
+         }
+     }
+ };
+ 
+ // StripePay Process. Requests are read off the channel into a bounded queue
+ // and settled by a pool of workers, so slow payments overlap instead of
+ // queuing behind each other. Confirmations go back as each one completes,
+ // out of order and matched to their request by requestId. When the queue is full
+ // the reader stops taking requests until a worker frees a slot, so the
+ // backlog builds up on the sender's side instead.
+ class StripePay {
+ private:
+     struct PaymentJob {
+         IPCMessage request;
+         chrono::steady_clock::time_point received;
+     };
      
-             // If not assigned, re-queue
-             if (!assigned) {
-                 tempCQueue.push(aircraft);
+     // Latency of completed payments, from receipt to confirmation
+     struct LatencyStats {
+         static constexpr size_t WINDOW = 1024; // Recent samples kept for percentiles
+         
+         uint64_t count;
+         double totalMs;
+         double maxMs;
+         vector<double> recent;
+         
+         LatencyStats() : count(0), totalMs(0.0), maxMs(0.0) {}
+         
+         void record(double ms) {
+             if (recent.size() < WINDOW) {
+                 recent.push_back(ms);
+             } else {
+                 recent[count % WINDOW] = ms;
+             }
+             count++;
+             totalMs += ms;
+             maxMs = max(maxMs, ms);
+         }
+         
+         double percentile(double fraction) const {
+             if (recent.empty()) {
+                 return 0.0;
              }
+             vector<double> sorted(recent);
+             size_t rank = min(sorted.size() - 1, static_cast<size_t>(fraction * sorted.size()));
+             nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+             return sorted[rank];
          }
+     };
      
-         // Restore unassigned flights to queues
-         runwayAQueue = tempAQueue;
-         runwayBQueue = tempBQueue;
-         runwayCQueue = tempCQueue;
+     MessageChannel* input;
+     FrameWriter output;
+     mutex outputMutex;
      
-         // Check for runway release
-         for (auto& flight : activeFlights) {
-             if (flight->assignedRunway != Runway::NONE) {
-                 bool releaseRunway = false;
-     
-                 // Check arrival flights
-                 if (auto arrival = dynamic_pointer_cast<ArrivalFlight>(flight)) {
-                     if (arrival->getState() == ArrivalState::TAXI || 
-                         arrival->getState() == ArrivalState::AT_GATE) {
-                         releaseRunway = true;
-                     }
-                 }
+     deque<PaymentJob> jobs;
+     mutex jobsMutex;
+     condition_variable jobReady;
+     condition_variable slotFree;
+     bool inputClosed;
      
-                 // Check departure flights
-                 if (auto departure = dynamic_pointer_cast<DepartureFlight>(flight)) {
-                     if (departure->getState() == DepartureState::CLIMB || 
-                         departure->getState() == DepartureState::CRUISE) {
-                         releaseRunway = true;
-                     }
-                 }
+     LatencyStats latency;
+     mutex latencyMutex;
      
-                 if (releaseRunway) {
-                     Runway runway = flight->assignedRunway;
-                     flight->assignedRunway = Runway::NONE;
-     
-                     if (runway == Runway::RWY_A) {
-                         lock_guard<mutex> lock(runwayAMutex);
-                         runwayAAvailable = true;
-                         runwayAOccupant = nullptr;
-                         runwayAFreeTime = currentSimulationTime;
-                         lock_guard<mutex> coutLock(cout_mutex);
-                         cout << "Released RWY-A from " << flight->flightNumber << " (" << flight->airline << ")" << endl;
-                     } else if (runway == Runway::RWY_B) {
-                         lock_guard<mutex> lock(runwayBMutex);
-                         runwayBAvailable = true;
-                         runwayBOccupant = nullptr;
-                         runwayBFreeTime = currentSimulationTime;
-                         lock_guard<mutex> coutLock(cout_mutex);
-                         cout << "Released RWY-B from " << flight->flightNumber << " (" << flight->airline << ")" << endl;
-                     } else if (runway == Runway::RWY_C) {
-                         lock_guard<mutex> lock(runwayCMutex);
-                         runwayCAvailable = true;
-                         runwayCOccupant = nullptr;
-                         runwayCFreeTime = currentSimulationTime;
-                         lock_guard<mutex> coutLock(cout_mutex);
-                         cout << "Released RWY-C from " << flight->flightNumber << " (" << flight->airline << ")" << endl;
-                     }
+     int processingSeconds; // Simulated settlement time per payment
+     
+     void worker() {
+         while (true) {
+             PaymentJob job;
+             {
+                 unique_lock<mutex> lock(jobsMutex);
+                 jobReady.wait(lock, [this] { return !jobs.empty() || inputClosed; });
+                 if (jobs.empty()) {
+                     return;
                  }
+                 job = jobs.front();
+                 jobs.pop_front();
              }
+             slotFree.notify_one();
+             
+             processPayment(job);
          }
      }
      
-     void updateFlights() {
-         for (auto& flight : activeFlights) {
-             flight->updateStatus(currentSimulationTime);
+ public:
+     StripePay(MessageChannel* in, MessageChannel* out, int settleSeconds = PAYMENT_PROCESSING_SECONDS)
+         : input(in), output(out), inputClosed(false), processingSeconds(settleSeconds) {}
+     
+     void run() {
+         vector<thread> workers;
+         for (int i = 0; i < STRIPE_PAY_WORKERS; i++) {
+             workers.emplace_back(&StripePay::worker, this);
+         }
+         
+         // Read payment requests until the channel closes
+         FrameReader reader(input);
+         vector<IPCMessage> batch;
+         deque<PaymentJob> held; // Read from the channel but not yet given a queue slot
+         
+         while (!reader.isClosed() || !held.empty()) {
+             // Back-pressure: a frame can hold more requests than there are free
+             // slots, so admit only as many as fit and hold the rest. Nothing more
+             // is read while any are held, which leaves new requests in the channel.
+             {
+                 unique_lock<mutex> lock(jobsMutex);
+                 slotFree.wait(lock, [this] { return jobs.size() < static_cast<size_t>(STRIPE_PAY_QUEUE_LIMIT); });
+                 while (!held.empty() && jobs.size() < static_cast<size_t>(STRIPE_PAY_QUEUE_LIMIT)) {
+                     jobs.push_back(held.front());
+                     held.pop_front();
+                 }
+             }
+             jobReady.notify_all();
              
-             // Check if flight has active violation
-             if (flight->hasActiveViolation && flight->currentViolation) {
-                 // Add violation to airline's record
-                 auto airlineIt = airlines.find(flight->airline);
-                 if (airlineIt != airlines.end()) {
-                     airlineIt->second->addViolation(flight->currentViolation);
-                     
-                     // Add to the global list of AVNs
-                     allAVNs.push_back(flight->currentViolation);
-                     
-                     // Notify AVN Generator with a new IPC message
-                     IPCMessage message;
-                     message.type = MessageType::AVN_CREATED;
-                     message.avnId = flight->currentViolation->id;
-                     strncpy(message.airline, flight->airline.c_str(), sizeof(message.airline) - 1);
-                     message.airline[sizeof(message.airline) - 1] = '\0';
-                     strncpy(message.flightNumber, flight->flightNumber.c_str(), sizeof(message.flightNumber) - 1);
-                     message.flightNumber[sizeof(message.flightNumber) - 1] = '\0';
-                     message.amount = flight->currentSpeed;  // Send current speed as amount
-                     message.minSpeed = flight->currentViolation->permissibleSpeedMin;
-                     message.maxSpeed = flight->currentViolation->permissibleSpeedMax;
-                     strncpy(message.details, (flight->type == FlightType::COMMERCIAL) ? "COMMERCIAL" : "CARGO", sizeof(message.details) - 1);
-                     message.details[sizeof(message.details) - 1] = '\0';
-                     
-                     write(avnWritePipe, &message, sizeof(message));
-                     
-                     // Reset violation flag and clear current violation
-                     flight->hasActiveViolation = false;
-                     flight->currentViolation.reset();
+             // Time out now and then to retry confirmations the Airline Portal has not taken yet
+             if (held.empty() && reader.read(batch, 100)) {
+                 auto now = chrono::steady_clock::now();
+                 for (const IPCMessage& message : batch) {
+                     if (message.type == MessageType::PAYMENT_REQUEST) {
+                         held.push_back({message, now});
+                     }
                  }
+                 batch.clear();
              }
+             
+             lock_guard<mutex> lock(outputMutex);
+             output.flush();
          }
-     }
-     
-     void moveCompletedFlights() {
-         vector<shared_ptr<Aircraft>> stillActive;
          
-         for (auto& flight : activeFlights) {
-             if (flight->isCompleted()) {
-                 completedFlights.push_back(flight);
-                 
-                 lock_guard<mutex> lock(cout_mutex);
-                 cout << "\nFlight completed: " << flight->flightNumber 
-                      << " (" << flight->airline << ")" << endl;
-             } else {
-                 stillActive.push_back(flight);
-             }
+         // Let the workers settle everything already accepted
+         {
+             lock_guard<mutex> lock(jobsMutex);
+             inputClosed = true;
          }
+         jobReady.notify_all();
+         for (auto& worker : workers) {
+             worker.join();
+         }
+         output.drain(1000);
          
-         // Update active flights list
-         activeFlights = stillActive;
+         if (latency.count > 0) {
+             LogLine(LogLevel::INFO) << "[StripePay] " << latency.count << " payments, latency mean "
+                  << fixed << setprecision(1) << latency.totalMs / latency.count << " ms, p95 "
+                  << latency.percentile(0.95) << " ms, max " << latency.maxMs << " ms";
+         }
      }
      
-     void printStatus() {
-         lock_guard<mutex> lock(cout_mutex);
+     void processPayment(const PaymentJob& job) {
+         const IPCMessage& request = job.request;
+         double queuedMs = chrono::duration<double, milli>(chrono::steady_clock::now() - job.received).count();
          
-         cout << "\n======== AIRCONTROLX STATUS ========" << endl;
-         cout << "Simulation Time: " << currentSimulationTime << " seconds" << endl;
-         cout << "Active Flights: " << activeFlights.size() << endl;
-         cout << "Completed Flights: " << completedFlights.size() << endl;
+         LogLine(LogLevel::EVENT) << "[StripePay] Processing payment for AVN #" << request.avnId 
+              << " - PKR " << fixed << setprecision(2) << request.amount;
          
-         // Runway status
-         cout << "\n--- RUNWAY STATUS ---" << endl;
-         cout << "Runway A: " << (runwayAOccupant ? runwayAOccupant->flightNumber + " (" + runwayAOccupant->airline + ")" : "Free") << endl;
-         cout << "Runway B: " << (runwayBOccupant ? runwayBOccupant->flightNumber + " (" + runwayBOccupant->airline + ")" : "Free") << endl;
-         cout << "Runway C: " << (runwayCOccupant ? runwayCOccupant->flightNumber + " (" + runwayCOccupant->airline + ")" : "Free") << endl;
+         // Simulate payment processing
+         this_thread::sleep_for(chrono::seconds(processingSeconds));
          
-         // Queue status
-         cout << "\n--- QUEUE STATUS ---" << endl;
-         cout << "Runway A Queue: " << runwayAQueue.size() << " flights waiting" << endl;
-         cout << "Runway B Queue: " << runwayBQueue.size() << " flights waiting" << endl;
+         // Send confirmation
+         IPCMessage confirmation;
+         confirmation.type = MessageType::PAYMENT_CONFIRMATION;
+         confirmation.requestId = request.requestId;
+         confirmation.avnId = request.avnId;
+         confirmation.amount = request.amount;
          
-         // Active flights
-         cout << "\n--- ACTIVE FLIGHTS ---" << endl;
-         for (const auto& flight : activeFlights) {
-             cout << flight->getSummary() << endl;
-         }
-         
-         // Active violations
-        //  cout << "\n--- ACTIVE VIOLATIONS ---" << endl;
-        //  bool hasViolations = false;
-        //  for (const auto& flight : activeFlights) {
-        //      if (flight->hasActiveViolation) {
-        //          cout << "Flight " << flight->flightNumber << " (" << flight->airline << ") - Speed: " 
-        //               << flight->currentSpeed << " km/h" << endl;
-        //          hasViolations = true;
-        //      }
-        //  }
-         
-        //  if (!hasViolations) {
-        //      cout << "No active violations." << endl;
-        //  }
-        
-        cout << "\n--- ACTIVE AVNs ---" << endl;
-        if (allAVNs.empty()) {
-            cout << "No AVNs issued yet." << endl;
-        } else {
-            bool hasUnpaidAVNs = false;
-            for (const auto& avn : allAVNs) {
-                if (avn->status == PaymentStatus::UNPAID) {
-                    cout << "AVN #" << avn->id << " | " << avn->airline << " flight " << avn->flightNumber 
-                        << " | Speed: " << avn->recordedSpeed << " km/h"
-                        << " | Amount: PKR " << fixed << setprecision(2) << avn->totalAmount << endl;
-                    hasUnpaidAVNs = true;
-                }
-            }
-            
-            if (!hasUnpaidAVNs) {
-                cout << "All AVNs have been paid." << endl;
-            }
-        }
-         cout << "=====================================" << endl;
+         {
+             lock_guard<mutex> lock(outputMutex);
+             output.queue(confirmation);
+             output.flush();
+         }
+         
+         double totalMs = chrono::duration<double, milli>(chrono::steady_clock::now() - job.received).count();
+         {
+             lock_guard<mutex> lock(latencyMutex);
+             latency.record(totalMs);
+         }
+         Metrics::add(Metric::PAYMENTS_SETTLED);
+         Metrics::record(Distribution::PAYMENT_LATENCY_US, static_cast<uint64_t>(totalMs * 1000));
+         
+         LogLine(LogLevel::EVENT) << "[StripePay] Payment confirmed for AVN #" << request.avnId 
+              << " - PKR " << fixed << setprecision(2) << request.amount
+              << " (queued " << setprecision(0) << queuedMs << " ms, total " << totalMs << " ms)";
      }
-     
-     void processAVNPayment(int avnId, double amount) {
-         for (auto& avn : allAVNs) {
-             if (avn->id == avnId) {
-                 if (amount >= avn->totalAmount) {
-                     avn->status = PaymentStatus::PAID;
-                     
-                     lock_guard<mutex> lock(cout_mutex);
-                     cout << "\nPayment processed for AVN #" << avnId << " - PKR " << fixed << setprecision(2) << amount << endl;
-                     cout << "AVN status updated to PAID." << endl;
-                 } else {
-                     lock_guard<mutex> lock(cout_mutex);
-                     cout << "\nInsufficient payment for AVN #" << avnId << ". Required: PKR " << fixed << setprecision(2) << avn->totalAmount << endl;
-                 }
-                 return;
+ };
+ 
+ // Print command-line usage
+ void printUsage(const char* program) {
+     cerr << "Usage: " << program << " [--headless] [--ticks N] [--time-dilation X] [--flight-table] [--threads N] [--seed N] [--log-level L] [--status-rate HZ] [--transport T] [--journal PATH] [--analytics] [--avn-clock C] [--archive-completed] [--benchmark FILE] [--metrics-dir DIR] [--traffic SRC] [--checkpoint FILE] [--checkpoint-at T] [--restore FILE] [--branches N] [--runway-planner P] [--airports N] [--handoff-lag K] [--portal]" << endl;
+     cerr << "  --headless          Run the simulation without menus and exit when done" << endl;
+     cerr << "  --ticks N           Number of simulation ticks in headless mode (default " << SIMULATION_TIME << ")" << endl;
+     cerr << "  --time-dilation X   Simulated seconds per real second in headless mode (default 0 = as fast as possible)" << endl;
+     cerr << "  --flight-table      Run the per-tick phase update over a structure-of-arrays flight table" << endl;
+     cerr << "  --threads N         Worker threads for the per-flight phase update (default 1, 0 = all cores)" << endl;
+     cerr << "  --seed N            Seed for a reproducible run (default: random)" << endl;
+     cerr << "  --log-level L       off, error, warn, info or event (default event)" << endl;
+     cerr << "  --transport T       pipe or shm (shared memory rings), default pipe" << endl;
+     cerr << "  --status-rate HZ    Cap status frames per second; in headless mode also turns the status display on" << endl;
+     cerr << "  --journal PATH      Keep AVNs in an append-only journal and restore them from it on start" << endl;
+     cerr << "  --analytics         Print the AVN analytics dashboard after a headless run" << endl;
+     cerr << "  --avn-clock C       sim or wall: clock for AVN reminders, overdue and penalties (default sim)" << endl;
+     cerr << "  --archive-completed Keep only a compact record of completed flights, for long runs" << endl;
+     cerr << "  --benchmark FILE    Time the tick phases and IPC paths, write a JSON report to FILE (- = stdout)" << endl;
+     cerr << "  --metrics-dir DIR   Each process writes DIR/<role>-<pid>.json every second and on SIGUSR1" << endl;
+     cerr << "  --traffic SRC       Take flights from a CSV or binary schedule file, or a tcp:HOST:PORT feed" << endl;
+     cerr << "  --checkpoint FILE   Save the complete simulation state to FILE after a headless run" << endl;
+     cerr << "  --checkpoint-at T   Save it after simulation tick T instead" << endl;
+     cerr << "  --restore FILE      Start from a checkpoint; --ticks then counts from its tick" << endl;
+     cerr << "  --branches N        Fork N runs off the restored checkpoint, branch K with seed + K - 1, output in FILE.branch-K.log" << endl;
+     cerr << "  --runway-planner P  greedy or lookahead: how runways are given to queued flights (default greedy)" << endl;
+     cerr << "  --airports N        Simulate N airports (up to " << MAX_AIRPORTS << "), one process each; departures hand off to another airport" << endl;
+     cerr << "  --handoff-lag K     Ticks an airport may run ahead of the others between handoff barriers (1 to "
+          << HANDOFF_TRANSIT_TICKS << ", default " << DEFAULT_HANDOFF_LAG << ")" << endl;
+     cerr << "  --portal            Run the Airline Portal on this terminal during a headless run; the run ends when it exits" << endl;
+ }
+
+ // Parse command-line options, returns false on invalid input
+ bool parseOptions(int argc, char* argv[], SimulationOptions& options) {
+     for (int i = 1; i < argc; i++) {
+         string arg = argv[i];
+
+         if (arg == "--headless") {
+             options.headless = true;
+         } else if (arg == "--ticks" && i + 1 < argc) {
+             options.ticks = atoi(argv[++i]);
+             if (options.ticks <= 0) {
+                 cerr << "--ticks must be a positive number" << endl;
+                 return false;
+             }
+         } else if (arg == "--flight-table") {
+             options.useFlightTable = true;
+         } else if (arg == "--seed" && i + 1 < argc) {
+             const char* text = argv[++i];
+             char* end;
+             errno = 0;
+             options.seed = strtoull(text, &end, 10);
+             // strtoull takes a sign and wraps negatives around, so only digits are accepted
+             if (!isdigit(static_cast<unsigned char>(text[0])) || *end != '\0' || errno == ERANGE) {
+                 cerr << "--seed must be a non-negative number below 2^64" << endl;
+                 return false;
+             }
+             options.hasSeed = true;
+         } else if (arg == "--log-level" && i + 1 < argc) {
+             // Applied right away so every forked process inherits it
+             LogLevel level;
+             if (!Logger::parseLevel(argv[++i], level)) {
+                 cerr << "Unknown log level: " << argv[i] << endl;
+                 return false;
+             }
+             Logger::setLevel(level);
+         } else if (arg == "--threads" && i + 1 < argc) {
+             options.threads = atoi(argv[++i]);
+             if (options.threads < 0) {
+                 cerr << "--threads cannot be negative" << endl;
+                 return false;
+             }
+             if (options.threads == 0) {
+                 options.threads = max(1u, thread::hardware_concurrency());
+             }
+         } else if (arg == "--transport" && i + 1 < argc) {
+             string transport = argv[++i];
+             if (transport == "pipe") {
+                 options.transport = Transport::PIPE;
+             } else if (transport == "shm") {
+                 options.transport = Transport::SHARED_MEMORY;
+             } else {
+                 cerr << "Unknown transport: " << transport << endl;
+                 return false;
+             }
+         } else if (arg == "--status-rate" && i + 1 < argc) {
+             options.statusRate = atof(argv[++i]);
+             if (options.statusRate <= 0) {
+                 cerr << "--status-rate must be a positive number" << endl;
+                 return false;
+             }
+         } else if (arg == "--avn-clock" && i + 1 < argc) {
+             string clock = argv[++i];
+             if (clock == "sim") {
+                 options.wallClockDeadlines = false;
+             } else if (clock == "wall") {
+                 options.wallClockDeadlines = true;
+             } else {
+                 cerr << "Unknown AVN clock: " << clock << endl;
+                 return false;
              }
+         } else if (arg == "--archive-completed") {
+             options.archiveCompleted = true;
+         } else if (arg == "--metrics-dir" && i + 1 < argc) {
+             options.metricsDir = argv[++i];
+         } else if (arg == "--traffic" && i + 1 < argc) {
+             options.trafficSource = argv[++i];
+         } else if (arg == "--checkpoint" && i + 1 < argc) {
+             options.checkpointPath = argv[++i];
+         } else if (arg == "--checkpoint-at" && i + 1 < argc) {
+             options.checkpointAt = atoi(argv[++i]);
+             if (options.checkpointAt <= 0) {
+                 cerr << "--checkpoint-at must be a positive tick" << endl;
+                 return false;
+             }
+         } else if (arg == "--restore" && i + 1 < argc) {
+             options.restorePath = argv[++i];
+         } else if (arg == "--branches" && i + 1 < argc) {
+             options.branches = atoi(argv[++i]);
+             if (options.branches <= 0) {
+                 cerr << "--branches must be a positive number" << endl;
+                 return false;
+             }
+         } else if (arg == "--runway-planner" && i + 1 < argc) {
+             string planner = argv[++i];
+             if (planner == "greedy") {
+                 options.runwayPlanning = RunwayPlanning::GREEDY;
+             } else if (planner == "lookahead") {
+                 options.runwayPlanning = RunwayPlanning::LOOKAHEAD;
+             } else {
+                 cerr << "Unknown runway planner: " << planner << endl;
+                 return false;
+             }
+         } else if (arg == "--airports" && i + 1 < argc) {
+             options.airports = atoi(argv[++i]);
+             if (options.airports < 1 || options.airports > MAX_AIRPORTS) {
+                 cerr << "--airports must be between 1 and " << MAX_AIRPORTS << endl;
+                 return false;
+             }
+         } else if (arg == "--handoff-lag" && i + 1 < argc) {
+             // Longer than the transit and a handoff could arrive after it is due
+             options.handoffLag = atoi(argv[++i]);
+             if (options.handoffLag < 1 || options.handoffLag > HANDOFF_TRANSIT_TICKS) {
+                 cerr << "--handoff-lag must be between 1 and " << HANDOFF_TRANSIT_TICKS << endl;
+                 return false;
+             }
+         } else if (arg == "--portal") {
+             options.portal = true;
+         } else if (arg == "--benchmark" && i + 1 < argc) {
+             options.benchmarkPath = argv[++i];
+         } else if (arg == "--analytics") {
+             options.analytics = true;
+         } else if (arg == "--journal" && i + 1 < argc) {
+             options.journalPath = argv[++i];
+         } else if (arg == "--time-dilation" && i + 1 < argc) {
+             options.timeDilation = atof(argv[++i]);
+             if (options.timeDilation < 0) {
+                 cerr << "--time-dilation cannot be negative" << endl;
+                 return false;
+             }
+         } else {
+             cerr << "Unknown or incomplete option: " << arg << endl;
+             return false;
          }
-         
-         lock_guard<mutex> lock(cout_mutex);
-         cout << "\nAVN #" << avnId << " not found." << endl;
      }
      
-     void displayAVNDetails(int avnId) {
-         for (const auto& avn : allAVNs) {
-             if (avn->id == avnId) {
-                 avn->printDetails();
-                 return;
+     if ((!options.checkpointPath.empty() || options.checkpointAt > 0) && (!options.headless || options.checkpointPath.empty())) {
+         cerr << "--checkpoint FILE is needed for --checkpoint-at, and only applies to --headless runs" << endl;
+         return false;
+     }
+     if (options.branches > 0 && (options.restorePath.empty() || !options.headless)) {
+         cerr << "--branches needs --restore and --headless" << endl;
+         return false;
+     }
+     if (!options.restorePath.empty() && !options.journalPath.empty()) {
+         // Both would bring back AVNs; the checkpoint already holds every one
+         cerr << "--restore cannot be combined with --journal" << endl;
+         return false;
+     }
+     if (options.portal && !options.headless) {
+         // The menus would read the same terminal
+         cerr << "--portal needs --headless" << endl;
+         return false;
+     }
+     if (options.airports > 1 && (!options.headless || !options.journalPath.empty() || !options.trafficSource.empty() ||
+                                  !options.checkpointPath.empty() || !options.restorePath.empty())) {
+         // Each of these belongs to a single scheduler
+         cerr << "--airports needs --headless and cannot be combined with --journal, --traffic, --checkpoint or --restore" << endl;
+         return false;
+     }
+     return true;
+ }
+
+ // Save the scheduler between two ticks
+ void writeCheckpoint(FlightScheduler& scheduler, const string& path) {
+     auto start = chrono::steady_clock::now();
+     string error;
+     if (!scheduler.saveCheckpoint(path, error)) {
+         LogLine(LogLevel::ERROR) << "Cannot write checkpoint " << path << ": " << error;
+         return;
+     }
+     LogLine(LogLevel::INFO) << "Checkpoint at tick " << scheduler.getCurrentTime() << " written to " << path << " in "
+                             << fixed << setprecision(1) << chrono::duration<double, milli>(chrono::steady_clock::now() - start).count() << " ms";
+ }
+
+ // Fork one process per branch off the checkpoint the caller has mapped; each
+ // runs the rest of main as a simulation of its own, sharing the image pages
+ // copy-on-write. Branch K reseeds every random stream with seed + K - 1,
+ // so branch 1 carries on the original run exactly. Returns K in a branch; the
+ // parent waits for all of them and returns 0, or -1 if any failed.
+ int forkBranches(const SimulationOptions& options) {
+     uint64_t baseSeed = simulationSeed;
+     vector<pid_t> pids;
+     cout.flush(); // Or every branch repeats what is buffered
+     
+     for (int branch = 1; branch <= options.branches; branch++) {
+         string logPath = options.restorePath + ".branch-" + to_string(branch) + ".log";
+         pid_t pid = fork();
+         if (pid == 0) {
+             int fd = ::open(logPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+             if (fd == -1) {
+                 cerr << "Cannot create " << logPath << ": " << strerror(errno) << endl;
+                 _exit(1);
              }
+             dup2(fd, STDOUT_FILENO);
+             close(fd);
+             simulationSeed = baseSeed + branch - 1;
+             return branch;
          }
-         
-         lock_guard<mutex> lock(cout_mutex);
-         cout << "\nAVN #" << avnId << " not found." << endl;
+         if (pid < 0) {
+             cerr << "Cannot fork branch " << branch << ": " << strerror(errno) << endl;
+             break;
+         }
+         pids.push_back(pid);
      }
      
-     void displayAirlineViolations(const string& airlineName) {
-         auto airlineIt = airlines.find(airlineName);
-         if (airlineIt != airlines.end()) {
-             airlineIt->second->printViolations();
-         } else {
-             lock_guard<mutex> lock(cout_mutex);
-             cout << "\nAirline '" << airlineName << "' not found." << endl;
+     bool failed = pids.size() < static_cast<size_t>(options.branches);
+     for (size_t i = 0; i < pids.size(); i++) {
+         int status = 0;
+         waitpid(pids[i], &status, 0);
+         bool clean = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+         failed = failed || !clean;
+         cout << "Branch " << i + 1 << " (seed " << baseSeed + i << "): " << (clean ? "done" : "FAILED")
+              << ", output in " << options.restorePath << ".branch-" << i + 1 << ".log" << endl;
+     }
+     return failed ? -1 : 0;
+ }
+
+ // Run the simulation back to back without the menu or the 1 second tick sleep.
+ // With a time dilation factor each tick is paced to 1/X real seconds instead.
+ // In a sharded run the airports meet at handoff barriers between ticks and
+ // print their summaries one after another.
+ void runHeadlessSimulation(FlightScheduler& scheduler, const SimulationOptions& options, AirspaceHandoff* handoff = nullptr) {
+     auto startTime = chrono::steady_clock::now();
+     auto nextTick = startTime;
+     auto tickPeriod = chrono::duration_cast<chrono::steady_clock::duration>(
+         chrono::duration<double>(options.timeDilation > 0 ? 1.0 / options.timeDilation : 0.0));
+
+     for (int tick = 0; tick < options.ticks; tick++) {
+         scheduler.updateSimulation();
+         if (handoff) {
+             handoff->synchronize(scheduler.getCurrentTime(), tick + 1 == options.ticks);
+         }
+         if (options.statusRate > 0) {
+             scheduler.printStatus();
+         }
+         if (scheduler.getCurrentTime() == options.checkpointAt) {
+             writeCheckpoint(scheduler, options.checkpointPath);
+         }
+
+         if (options.timeDilation > 0) {
+             nextTick += tickPeriod;
+             this_thread::sleep_until(nextTick);
+         }
+     }
+
+     if (!options.checkpointPath.empty() && options.checkpointAt < 0) {
+         writeCheckpoint(scheduler, options.checkpointPath);
+     }
+
+     double elapsed = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+
+     Logger::instance().flush();
+     if (handoff) {
+         handoff->waitTurn();
+     }
+     {
+         lock_guard<mutex> lock(cout_mutex);
+         cout << "\n======== HEADLESS RUN SUMMARY ========" << endl;
+         if (handoff) {
+             cout << "Airport: " << handoff->getAirport() + 1 << " of " << handoff->getAirportCount() << endl;
          }
+         cout << "Seed: " << simulationSeed << endl;
+         cout << "Ticks Simulated: " << options.ticks << endl;
+         cout << "Wall Time: " << fixed << setprecision(3) << elapsed << " seconds" << endl;
+         cout << "Ticks/Second: " << fixed << setprecision(1) << (elapsed > 0 ? options.ticks / elapsed : 0.0) << endl;
+         cout << "Active Flights: " << scheduler.getActiveFlightCount() << endl;
+         cout << "Completed Flights: " << scheduler.getCompletedFlightCount() << endl;
+         cout << "AVNs Issued: " << scheduler.getAllAVNs().size() << endl;
+         cout << "Runway Planner: " << (options.runwayPlanning == RunwayPlanning::LOOKAHEAD ? "lookahead" : "greedy") << endl;
+         cout << "Runway Movements: " << scheduler.getRunwayMovements() << " (" << fixed << setprecision(1)
+              << (scheduler.getCurrentTime() > 0 ? scheduler.getRunwayMovements() * 3600.0 / scheduler.getCurrentTime() : 0.0)
+              << " per hour)" << endl;
+         cout << "Average Runway Delay: " << fixed << setprecision(2) << scheduler.getAverageRunwayDelay() << " ticks" << endl;
+         if (handoff) {
+             cout << "Flights Handed Off: " << handoff->getHandedOff() << endl;
+             cout << "Handoff Arrivals: " << handoff->getArrived() << endl;
+         }
+         cout << "======================================" << endl;
      }
      
-     const vector<shared_ptr<AVN>>& getAllAVNs() const {
-         return allAVNs;
+     if (options.analytics) {
+         scheduler.displayAnalytics();
      }
      
-     const map<string, shared_ptr<Airline>>& getAirlines() const {
-         return airlines;
+     if (handoff) {
+         Logger::instance().flush();
+         cout.flush();
+         handoff->finish();
      }
- };
+ }
+
+ // Wait for a child to exit on its own, then terminate it if it has not within 2 seconds
+ void stopChildProcess(pid_t pid) {
+     if (pid <= 0) {
+         return;
+     }
+     for (int attempt = 0; attempt < 200; attempt++) {
+         if (waitpid(pid, nullptr, WNOHANG) == pid) {
+             return;
+         }
+         this_thread::sleep_for(chrono::milliseconds(10));
+     }
+     kill(pid, SIGTERM);
+     waitpid(pid, nullptr, 0);
+ }
+
+ // -------- BENCHMARKS --------
  
- // AVN Generator Process
- class AVNGenerator {
+ // Samples of one measurement, in microseconds, summarised for the JSON report
+ class BenchmarkSamples {
  private:
-     vector<shared_ptr<AVN>> avns;
-     int nextAVNId;
-     int readPipe;
-     int writePipe;
+     vector<double> values;
      
  public:
-     AVNGenerator(int read, int write) 
-         : nextAVNId(1000), readPipe(read), writePipe(write) {}
+     void add(double us) {
+         values.push_back(us);
+     }
      
-     void run() {
-         while (true) {
-             // Read messages from pipe
-             IPCMessage message;
-             ssize_t bytesRead = read(readPipe, &message, sizeof(message));
-             
-             if (bytesRead <= 0) {
-                 // Error or pipe closed
-                 break;
-             }
-             
-             processMessage(message);
-         }
+     size_t count() const {
+         return values.size();
      }
      
-     void processMessage(const IPCMessage& message) {
-         switch (message.type) {
-             case MessageType::AVN_CREATED: {
-                 // Create a new AVN based on the message
-                 FlightType flightType = (strncmp(message.details, "COMMERCIAL", sizeof(message.details)) == 0) ? 
-                                        FlightType::COMMERCIAL : FlightType::CARGO;
-                 
-                 // Create a new AVN with proper speed information
-                 auto newAVN = make_shared<AVN>(
-                     nextAVNId++,
-                     string(message.airline),
-                     string(message.flightNumber),
-                     flightType,
-                     static_cast<int>(message.amount),  // Recorded speed
-                     message.minSpeed,  // Permissible min speed
-                     message.maxSpeed   // Permissible max speed
-                 );
-                 
-                 // Store the AVN
-                 avns.push_back(newAVN);
-                 
-                 // Send notification to Airline Portal
-                 IPCMessage response;
-                 response.type = MessageType::AVN_CREATED;
-                 response.avnId = newAVN->id;
-                 strncpy(response.airline, newAVN->airline.c_str(), sizeof(response.airline) - 1);
-                 response.airline[sizeof(response.airline) - 1] = '\0';
-                 strncpy(response.flightNumber, newAVN->flightNumber.c_str(), sizeof(response.flightNumber) - 1);
-                 response.flightNumber[sizeof(response.flightNumber) - 1] = '\0';
-                 response.amount = newAVN->totalAmount;
-                 strncpy(response.details, (newAVN->status == PaymentStatus::PAID) ? "PAID" : "UNPAID", sizeof(response.details) - 1);
-                 response.details[sizeof(response.details) - 1] = '\0';
-                 
-                 write(writePipe, &response, sizeof(response));
-                 
-                 lock_guard<mutex> lock(cout_mutex);
-                 cout << "[AVN Generator] Created AVN #" << newAVN->id << " for " 
-                      << newAVN->airline << " flight " << newAVN->flightNumber 
-                      << " - PKR " << fixed << setprecision(2) << newAVN->totalAmount << endl;
-                 break;
-             }
-                 
-             case MessageType::PAYMENT_CONFIRMATION: {
-                 // Find the AVN and update its status
-                 for (auto& avn : avns) {
-                     if (avn->id == message.avnId) {
-                         avn->status = PaymentStatus::PAID;
-                         
-                         // Send confirmation to Airline Portal
-                         IPCMessage response;
-                         response.type = MessageType::PAYMENT_CONFIRMATION;
-                         response.avnId = avn->id;
-                         strncpy(response.airline, avn->airline.c_str(), sizeof(response.airline) - 1);
-                         response.airline[sizeof(response.airline) - 1] = '\0';
-                         response.amount = message.amount;
-                         
-                         write(writePipe, &response, sizeof(response));
-                         
-                         lock_guard<mutex> lock(cout_mutex);
-                         cout << "[AVN Generator] Payment confirmed for AVN #" << avn->id 
-                              << " - PKR " << fixed << setprecision(2) << message.amount << endl;
-                         break;
-                     }
-                 }
-                 break;
-             }
-                 
-             case MessageType::QUERY_AVN: {
-                 // Find the AVN and send its details
-                 for (const auto& avn : avns) {
-                     if (avn->id == message.avnId) {
-                         IPCMessage response;
-                         response.type = MessageType::QUERY_AVN;
-                         response.avnId = avn->id;
-                         strncpy(response.airline, avn->airline.c_str(), sizeof(response.airline) - 1);
-                         response.airline[sizeof(response.airline) - 1] = '\0';
-                         strncpy(response.flightNumber, avn->flightNumber.c_str(), sizeof(response.flightNumber) - 1);
-                         response.flightNumber[sizeof(response.flightNumber) - 1] = '\0';
-                         response.amount = avn->totalAmount;
-                         strncpy(response.details, (avn->status == PaymentStatus::PAID) ? "PAID" : "UNPAID", sizeof(response.details) - 1);
-                         response.details[sizeof(response.details) - 1] = '\0';
-                         
-                         write(writePipe, &response, sizeof(response));
-                         break;
-                     }
-                 }
-                 break;
-             }
-                 
-             case MessageType::QUERY_AIRLINE: {
-                 // Find all AVNs for the airline
-                 stringstream ss;
-                 int count = 0;
-                 
-                 for (const auto& avn : avns) {
-                     if (avn->airline == string(message.airline)) {
-                         ss << "AVN #" << avn->id << " | " << avn->flightNumber 
-                            << " | PKR " << fixed << setprecision(2) << avn->totalAmount 
-                            << " | " << ((avn->status == PaymentStatus::PAID) ? "PAID" : "UNPAID") << "\n";
-                         count++;
-                     }
-                 }
-                 
-                 IPCMessage response;
-                 response.type = MessageType::QUERY_AIRLINE;
-                 strncpy(response.airline, message.airline, sizeof(response.airline) - 1);
-                 response.airline[sizeof(response.airline) - 1] = '\0';
-                 string detailsStr = ss.str();
-                 strncpy(response.details, detailsStr.c_str(), sizeof(response.details) - 1);
-                 response.details[sizeof(response.details) - 1] = '\0';
-                 
-                 write(writePipe, &response, sizeof(response));
-                 
-                 lock_guard<mutex> lock(cout_mutex);
-                 cout << "[AVN Generator] Queried " << count << " AVNs for " << message.airline << endl;
-                 break;
-             }
-                 
-             default:
-                 break;
+     double mean() const {
+         double total = 0.0;
+         for (double value : values) {
+             total += value;
          }
+         return values.empty() ? 0.0 : total / values.size();
      }
- };
- 
- // Airline Portal Process
- class AirlinePortal {
- private:
-     int readPipe;
-     int writePipe;
-     int stripePayPipe;
-     map<string, vector<shared_ptr<AVN>>> airlineAVNs;
-     
- public:
-     AirlinePortal(int read, int write, int stripePay) 
-         : readPipe(read), writePipe(write), stripePayPipe(stripePay) {}
      
-     void run() {
-         while (true) {
-             displayMenu();
-             
-             int choice;
-             cin >> choice;
-             
-             switch (choice) {
-                 case 1:
-                     viewAirlineAVNs();
-                     break;
-                     
-                 case 2:
-                     payAVN();
-                     break;
-                     
-                 case 3:
-                     viewAVNDetails();
-                     break;
-                     
-                 case 4:
-                     cout << "Exiting Airline Portal." << endl;
-                     return;
-                     
-                 default:
-                     cout << "Invalid choice. Please try again." << endl;
-                     break;
-             }
-             
-             // Process any incoming messages
-             processIncomingMessages();
+     double percentile(double fraction) const {
+         if (values.empty()) {
+             return 0.0;
          }
+         vector<double> sorted(values);
+         size_t rank = min(sorted.size() - 1, static_cast<size_t>(fraction * sorted.size()));
+         nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+         return sorted[rank];
      }
      
-     void displayMenu() {
-         lock_guard<mutex> lock(cout_mutex);
-         cout << "\n===== AIRLINE PORTAL =====\n";
-         cout << "1. View Airline AVNs\n";
-         cout << "2. Pay AVN\n";
-         cout << "3. View AVN Details\n";
-         cout << "4. Exit\n";
-         cout << "Enter your choice: ";
+     void writeJson(ostream& out) const {
+         double maxUs = values.empty() ? 0.0 : *max_element(values.begin(), values.end());
+         out << "{\"samples\": " << values.size() << fixed << setprecision(3)
+             << ", \"meanUs\": " << mean() << ", \"p50Us\": " << percentile(0.50)
+             << ", \"p99Us\": " << percentile(0.99) << ", \"maxUs\": " << maxUs << "}";
      }
+ };
+ 
+ const size_t BENCHMARK_FLIGHT_COUNTS[] = {10, 1000, 100000, 1000000};
+ const int BENCHMARK_ROUND_TRIPS = 2000;
+ const int BENCHMARK_PAYMENT_ROUND_TRIPS = 500;
+ const int BENCHMARK_THROUGHPUT_MESSAGES = 200000;
+ const size_t BENCHMARK_PLANNER_FLIGHTS = 400; // Injected at once, well past what the runways clear in an hour
+ const int BENCHMARK_PLANNER_TICKS = 3600;
+ 
+ // Enough ticks for a stable mean with few flights, a handful with a million
+ int benchmarkTicks(size_t flights) {
+     return max<int>(5, min<size_t>(500, 2000000 / flights));
+ }
+ 
+ // Tick phases with the given number of flights injected up front. No AVN
+ // Generator is attached; notices stay in the scheduler's channel backlog.
+ void benchmarkScheduler(size_t flights, const SimulationOptions& options, ostream& out) {
+     FlightScheduler scheduler(nullptr, options);
+     auto injectStart = chrono::steady_clock::now();
+     scheduler.injectTraffic(flights);
+     double injectMs = chrono::duration<double, milli>(chrono::steady_clock::now() - injectStart).count();
      
-     void viewAirlineAVNs() {
-         string airline;
-         lock_guard<mutex> lock(cout_mutex);
-         cout << "Enter airline name: ";
-         cin >> airline;
-         
-         // Request AVNs for the airline
-         IPCMessage request;
-         request.type = MessageType::QUERY_AIRLINE;
-         strncpy(request.airline, airline.c_str(), sizeof(request.airline) - 1);
-         request.airline[sizeof(request.airline) - 1] = '\0';
-         
-         write(writePipe, &request, sizeof(request));
-         
-         // Wait for response
-         sleep(1);
-         processIncomingMessages();
+     int ticks = benchmarkTicks(flights);
+     BenchmarkSamples phases[TickPhaseTimes::PHASE_COUNT];
+     BenchmarkSamples wholeTicks;
+     for (int tick = 0; tick < ticks; tick++) {
+         TickPhaseTimes times;
+         auto start = chrono::steady_clock::now();
+         scheduler.updateSimulation(&times);
+         wholeTicks.add(chrono::duration<double, micro>(chrono::steady_clock::now() - start).count());
+         for (int phase = 0; phase < TickPhaseTimes::PHASE_COUNT; phase++) {
+             phases[phase].add(times.us[phase]);
+         }
      }
      
-     void payAVN() {
-         int avnId;
-         lock_guard<mutex> lock(cout_mutex);
-         cout << "Enter AVN ID to pay: ";
-         cin >> avnId;
-         
-         // Query AVN details first
-         IPCMessage request;
-         request.type = MessageType::QUERY_AVN;
-         request.avnId = avnId;
-         
-         write(writePipe, &request, sizeof(request));
-         
-         // Wait for response
-         sleep(1);
-         processIncomingMessages();
-         
-         // Now request payment
-         double amount;
-         lock_guard<mutex> lock2(cout_mutex);
-         cout << "Enter payment amount (PKR): ";
-         cin >> amount;
-         
-         // Send payment request to StripePay
-         IPCMessage paymentRequest;
-         paymentRequest.type = MessageType::PAYMENT_REQUEST;
-         paymentRequest.avnId = avnId;
-         paymentRequest.amount = amount;
-         
-         write(stripePayPipe, &paymentRequest, sizeof(paymentRequest));
-         
-         lock_guard<mutex> lock3(cout_mutex);
-         cout << "Payment request sent for AVN #" << avnId << " - PKR " << fixed << setprecision(2) << amount << endl;
+     out << "    {\"flights\": " << flights << ", \"ticks\": " << ticks
+         << ", \"injectMs\": " << fixed << setprecision(3) << injectMs
+         << ", \"activeAfter\": " << scheduler.getActiveFlightCount()
+         << ", \"avnsIssued\": " << scheduler.getAllAVNs().size() << ",\n     \"tick\": ";
+     wholeTicks.writeJson(out);
+     for (int phase = 0; phase < TickPhaseTimes::PHASE_COUNT; phase++) {
+         out << ",\n     \"" << TickPhaseTimes::name(phase) << "\": ";
+         phases[phase].writeJson(out);
      }
+     out << "}";
+ }
+ 
+ // The same injected rush under each runway planner: movements, the mean delay
+ // once ready (flights still queued count with what they have waited so far),
+ // and the assign phase's cost per tick
+ void benchmarkRunwayPlanning(const SimulationOptions& options, ostream& out) {
+     int firstFlightId = Aircraft::getNextId();
+     int firstAvnId = Aircraft::getNextAvnId();
      
-     void viewAVNDetails() {
-         int avnId;
-         lock_guard<mutex> lock(cout_mutex);
-         cout << "Enter AVN ID: ";
-         cin >> avnId;
-         
-         // Request AVN details
-         IPCMessage request;
-         request.type = MessageType::QUERY_AVN;
-         request.avnId = avnId;
+     out << "{\"flights\": " << BENCHMARK_PLANNER_FLIGHTS << ", \"ticks\": " << BENCHMARK_PLANNER_TICKS;
+     for (RunwayPlanning planning : {RunwayPlanning::GREEDY, RunwayPlanning::LOOKAHEAD}) {
+         // Same flight ids, so the same random streams, for both planners
+         Aircraft::restoreIdCounters(firstFlightId, firstAvnId);
+         SimulationOptions plannerOptions = options;
+         plannerOptions.runwayPlanning = planning;
+         FlightScheduler scheduler(nullptr, plannerOptions);
+         scheduler.injectTraffic(BENCHMARK_PLANNER_FLIGHTS);
          
-         write(writePipe, &request, sizeof(request));
+         BenchmarkSamples assign;
+         for (int tick = 0; tick < BENCHMARK_PLANNER_TICKS; tick++) {
+             TickPhaseTimes times;
+             scheduler.updateSimulation(&times);
+             assign.add(times.us[TickPhaseTimes::ASSIGN]);
+         }
          
-         // Wait for response
-         sleep(1);
-         processIncomingMessages();
+         uint64_t movements = scheduler.getRunwayMovements();
+         size_t queued = scheduler.getQueuedFlightCount();
+         double delayTicks = scheduler.getAverageRunwayDelay() * movements + scheduler.getQueuedRunwayDelay();
+         out << ",\n     \"" << (planning == RunwayPlanning::LOOKAHEAD ? "lookahead" : "greedy") << "\": {\"movements\": "
+             << movements << ", \"movementsPerHour\": " << fixed << setprecision(1)
+             << movements * 3600.0 / BENCHMARK_PLANNER_TICKS
+             << ", \"averageDelayTicks\": " << setprecision(2) << (movements + queued ? delayTicks / (movements + queued) : 0.0)
+             << ", \"stillQueued\": " << queued << ",\n       \"assignRunways\": ";
+         assign.writeJson(out);
+         out << "}";
      }
-     
-     void processIncomingMessages() {
-         // Check if there are messages to read
-         fd_set readSet;
-         FD_ZERO(&readSet);
-         FD_SET(readPipe, &readSet);
-         
-         struct timeval timeout;
-         timeout.tv_sec = 0;
-         timeout.tv_usec = 100000; // 100ms timeout
-         
-         while (select(readPipe + 1, &readSet, NULL, NULL, &timeout) > 0) {
-             IPCMessage message;
-             ssize_t bytesRead = read(readPipe, &message, sizeof(message));
-             
-             if (bytesRead <= 0) {
-                 break;
+     out << "}";
+ }
+ 
+ // Send one request at a time and wait for the reply with its id
+ bool measureRoundTrips(FrameWriter& writer, FrameReader& reader, IPCMessage request, int count, BenchmarkSamples& samples) {
+     vector<IPCMessage> batch;
+     for (int i = 0; i < count; i++) {
+         request.requestId = i + 1;
+         auto start = chrono::steady_clock::now();
+         writer.send(request);
+         bool answered = false;
+         while (!answered) {
+             batch.clear();
+             if (!reader.read(batch, 5000)) {
+                 return false;
              }
-             
-             lock_guard<mutex> lock(cout_mutex);
-             switch (message.type) {
-                 case MessageType::AVN_CREATED:
-                     cout << "\n[Airline Portal] New AVN #" << message.avnId << " created for " 
-                          << message.airline << " flight " << message.flightNumber 
-                          << " - PKR " << fixed << setprecision(2) << message.amount << endl;
-                     break;
-                     
-                 case MessageType::PAYMENT_CONFIRMATION:
-                     cout << "\n[Airline Portal] Payment confirmed for AVN #" << message.avnId 
-                          << " - PKR " << fixed << setprecision(2) << message.amount << endl;
-                     break;
-                     
-                 case MessageType::QUERY_AVN:
-                     cout << "\n===== AVN #" << message.avnId << " =====\n";
-                     cout << "Airline: " << message.airline << endl;
-                     cout << "Flight: " << message.flightNumber << endl;
-                     cout << "Amount: PKR " << fixed << setprecision(2) << message.amount << endl;
-                     cout << "Status: " << message.details << endl;
-                     cout << "========================" << endl;
-                     break;
-                     
-                 case MessageType::QUERY_AIRLINE:
-                     cout << "\n===== AVNs for " << message.airline << " =====\n";
-                     if (message.details[0] == '\0') {
-                         cout << "No AVNs found for this airline." << endl;
-                     } else {
-                         cout << message.details;
-                     }
-                     cout << "========================" << endl;
-                     break;
-                     
-                 default:
-                     break;
+             for (const IPCMessage& reply : batch) {
+                 answered = answered || reply.requestId == request.requestId;
              }
-             
-             // Check if there are more messages
-             FD_ZERO(&readSet);
-             FD_SET(readPipe, &readSet);
-             timeout.tv_sec = 0;
-             timeout.tv_usec = 100000;
          }
+         samples.add(chrono::duration<double, micro>(chrono::steady_clock::now() - start).count());
      }
- };
+     return true;
+ }
  
- // StripePay Process
- class StripePay {
- private:
-     int readPipe;
-     int writePipe;
+ // QUERY_AVN to a forked AVN Generator and back, over the configured transport
+ bool benchmarkAVNGeneratorRoundTrip(Transport transport, BenchmarkSamples& samples) {
+     auto requests = MessageChannel::create(transport);
+     auto replies = MessageChannel::create(transport);
+     SharedAVNTable table;
      
- public:
-     StripePay(int read, int write) : readPipe(read), writePipe(write) {}
+     pid_t pid = fork();
+     if (pid == 0) {
+         requests->useAsReader();
+         replies->useAsWriter();
+         AVNGenerator avnGenerator({requests.get()}, replies.get(), &table);
+         avnGenerator.run();
+         replies->closeWriter();
+         Logger::instance().shutdown();
+         exit(0);
+     } else if (pid < 0) {
+         return false;
+     }
      
-     void run() {
-         while (true) {
-             // Read payment requests
-             IPCMessage message;
-             ssize_t bytesRead = read(readPipe, &message, sizeof(message));
-             
-             if (bytesRead <= 0) {
-                 // Error or pipe closed
-                 break;
-             }
-             
-             if (message.type == MessageType::PAYMENT_REQUEST) {
-                 processPayment(message);
-             }
+     requests->useAsWriter();
+     replies->useAsReader();
+     FrameWriter writer(requests.get());
+     FrameReader reader(replies.get());
+     IPCMessage query;
+     query.type = MessageType::QUERY_AVN;
+     query.avnId = 1;
+     bool ok = measureRoundTrips(writer, reader, query, BENCHMARK_ROUND_TRIPS, samples);
+     requests->closeWriter();
+     stopChildProcess(pid);
+     return ok;
+ }
+ 
+ // PAYMENT_REQUEST to a forked StripePay and its confirmation back, with the
+ // simulated settlement time taken out so only the IPC and queueing remain
+ bool benchmarkStripePayRoundTrip(Transport transport, BenchmarkSamples& samples) {
+     auto requests = MessageChannel::create(transport);
+     auto replies = MessageChannel::create(transport);
+     
+     pid_t pid = fork();
+     if (pid == 0) {
+         requests->useAsReader();
+         replies->useAsWriter();
+         StripePay stripePay(requests.get(), replies.get(), 0);
+         stripePay.run();
+         replies->closeWriter();
+         Logger::instance().shutdown();
+         exit(0);
+     } else if (pid < 0) {
+         return false;
+     }
+     
+     requests->useAsWriter();
+     replies->useAsReader();
+     FrameWriter writer(requests.get());
+     FrameReader reader(replies.get());
+     IPCMessage payment;
+     payment.type = MessageType::PAYMENT_REQUEST;
+     payment.avnId = 1;
+     payment.amount = COMMERCIAL_FINE;
+     bool ok = measureRoundTrips(writer, reader, payment, BENCHMARK_PAYMENT_ROUND_TRIPS, samples);
+     requests->closeWriter();
+     stopChildProcess(pid);
+     return ok;
+ }
+ 
+ // Messages per second through AVNGenerator::run(), fed and drained by threads
+ // in this process so the figure is the generator's, not the scheduler's
+ double benchmarkAVNGeneratorThroughput(Transport transport, size_t& repliesSeen) {
+     auto requests = MessageChannel::create(transport);
+     auto replies = MessageChannel::create(transport);
+     SharedAVNTable table;
+     AVNGenerator avnGenerator({requests.get()}, replies.get(), &table);
+     
+     repliesSeen = 0;
+     thread drain([&replies, &repliesSeen]() {
+         FrameReader reader(replies.get());
+         vector<IPCMessage> batch;
+         while (reader.read(batch)) {
+             repliesSeen += batch.size();
+             batch.clear();
+         }
+     });
+     
+     auto start = chrono::steady_clock::now();
+     thread generator([&]() {
+         avnGenerator.run();
+         replies->closeWriter();
+     });
+     
+     FrameWriter writer(requests.get());
+     IPCMessage query;
+     query.type = MessageType::QUERY_AVN;
+     for (int i = 0; i < BENCHMARK_THROUGHPUT_MESSAGES; i++) {
+         query.avnId = i + 1;
+         query.requestId = i + 1;
+         writer.queue(query);
+         if ((i + 1) % 256 == 0) {
+             writer.drain(5000);
          }
      }
+     writer.drain(5000);
+     requests->closeWriter();
+     generator.join();
+     double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+     drain.join();
+     return seconds > 0 ? BENCHMARK_THROUGHPUT_MESSAGES / seconds : 0.0;
+ }
+ 
+ // Run the whole suite and write one JSON document to options.benchmarkPath
+ // ("-" for stdout). Logging is cut to errors so the console is not timed.
+ int runBenchmarks(const SimulationOptions& options) {
+     ofstream file;
+     if (options.benchmarkPath != "-") {
+         file.open(options.benchmarkPath);
+         if (!file) {
+             cerr << "Cannot write benchmark report " << options.benchmarkPath << endl;
+             return 1;
+         }
+     }
+     ostream& out = file.is_open() ? static_cast<ostream&>(file) : cout;
+     Logger::setLevel(LogLevel::ERROR);
      
-     void processPayment(const IPCMessage& request) {
-         lock_guard<mutex> lock(cout_mutex);
-         cout << "[StripePay] Processing payment for AVN #" << request.avnId 
-              << " - PKR " << fixed << setprecision(2) << request.amount << endl;
-         
-         // Simulate payment processing
-         sleep(2);
-         
-         // Send confirmation
-         IPCMessage confirmation;
-         confirmation.type = MessageType::PAYMENT_CONFIRMATION;
-         confirmation.avnId = request.avnId;
-         confirmation.amount = request.amount;
-         
-         write(writePipe, &confirmation, sizeof(confirmation));
-         
-         lock_guard<mutex> lock2(cout_mutex);
-         cout << "[StripePay] Payment confirmed for AVN #" << request.avnId 
-              << " - PKR " << fixed << setprecision(2) << request.amount << endl;
+     out << "{\n  \"seed\": " << simulationSeed
+         << ",\n  \"threads\": " << options.threads
+         << ",\n  \"flightTable\": " << (options.useFlightTable ? "true" : "false")
+         << ",\n  \"archiveCompleted\": " << (options.archiveCompleted ? "true" : "false")
+         << ",\n  \"transport\": \"" << (options.transport == Transport::SHARED_MEMORY ? "shm" : "pipe") << "\""
+         << ",\n  \"scheduler\": [\n";
+     size_t scenarios = sizeof(BENCHMARK_FLIGHT_COUNTS) / sizeof(BENCHMARK_FLIGHT_COUNTS[0]);
+     for (size_t i = 0; i < scenarios; i++) {
+         benchmarkScheduler(BENCHMARK_FLIGHT_COUNTS[i], options, out);
+         out << (i + 1 < scenarios ? ",\n" : "\n");
+         out.flush();
      }
- };
+     out << "  ],\n  \"runwayPlanning\": ";
+     benchmarkRunwayPlanning(options, out);
+     out << ",\n  \"ipc\": {\n";
+     out.flush(); // Written before the forks so the children do not inherit it
+     
+     BenchmarkSamples avnRoundTrip;
+     bool avnOk = benchmarkAVNGeneratorRoundTrip(options.transport, avnRoundTrip);
+     out << "    \"avnGeneratorRoundTrip\": ";
+     avnRoundTrip.writeJson(out);
+     out.flush();
+     
+     BenchmarkSamples paymentRoundTrip;
+     bool paymentOk = benchmarkStripePayRoundTrip(options.transport, paymentRoundTrip);
+     out << ",\n    \"stripePayRoundTrip\": ";
+     paymentRoundTrip.writeJson(out);
+     
+     size_t repliesSeen = 0;
+     double messagesPerSecond = benchmarkAVNGeneratorThroughput(options.transport, repliesSeen);
+     out << ",\n    \"avnGeneratorThroughput\": {\"messages\": " << BENCHMARK_THROUGHPUT_MESSAGES
+         << ", \"replies\": " << repliesSeen << ", \"messagesPerSecond\": " << fixed << setprecision(1) << messagesPerSecond << "}"
+         << "\n  }\n}" << endl;
+     
+     Logger::instance().flush();
+     if (!avnOk || !paymentOk) {
+         cerr << "Benchmark IPC round trip did not complete" << endl;
+         return 1;
+     }
+     return 0;
+ }
  
  // Main function
  // Fix the main function to properly manage simulation vs airline portal modes
 
-int main() {
-    // Create pipes for IPC
-    int atcToAvn[2]; // ATC -> AVN Generator
-    int avnToAirline[2]; // AVN Generator -> Airline Portal
-    int airlineToAvn[2]; // Airline Portal -> AVN Generator
-    int airlineToStripe[2]; // Airline Portal -> StripePay
-    int stripeToAvn[2]; // StripePay -> AVN Generator
+int main(int argc, char* argv[]) {
+    SimulationOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    // Seed every random stream in the run
+    if (options.hasSeed) {
+        simulationSeed = options.seed;
+    } else {
+        random_device rd;
+        simulationSeed = (static_cast<uint64_t>(rd()) << 32) | rd();
+    }
+
+    // The Airline Portal end of a pipe may have no reader; a write to it must fail
+    // with EPIPE rather than kill the process. Inherited by every forked child.
+    signal(SIGPIPE, SIG_IGN);
+
+    // The benchmark suite sets up its own processes and channels
+    if (!options.benchmarkPath.empty()) {
+        return runBenchmarks(options);
+    }
+
+    // A restored run takes its seed from the checkpoint; branches fork off the
+    // mapped image before any process or channel exists
+    CheckpointImage checkpoint;
+    if (!options.restorePath.empty()) {
+        string error;
+        if (!checkpoint.open(options.restorePath, error)) {
+            cerr << "Cannot open checkpoint " << options.restorePath << ": " << error << endl;
+            return 1;
+        }
+        simulationSeed = checkpoint.getSeed();
+        if (options.branches > 0) {
+            int branch = forkBranches(options);
+            if (branch <= 0) {
+                return branch == 0 ? 0 : 1;
+            }
+        }
+    }
+
+    // Enabled before the forks so every process records; each starts its own reporter
+    if (!options.metricsDir.empty()) {
+        if (mkdir(options.metricsDir.c_str(), 0755) == -1 && errno != EEXIST) {
+            cerr << "Cannot create metrics directory " << options.metricsDir << ": " << strerror(errno) << endl;
+            return 1;
+        }
+        Metrics::instance().enable(options.metricsDir);
+    }
+
+    // Create channels for IPC (pipes or shared memory rings, see --transport)
+    unique_ptr<MessageChannel> atcToAvn; // ATC -> AVN Generator
+    unique_ptr<MessageChannel> avnToAirline; // AVN Generator -> Airline Portal
+    unique_ptr<MessageChannel> airlineToStripe; // Airline Portal -> StripePay
+    unique_ptr<MessageChannel> stripeToAvn; // StripePay -> AVN Generator
+    vector<unique_ptr<MessageChannel>> airportToAvn; // ATC of airports 2..N -> AVN Generator (--airports)
+    unique_ptr<AirportNetwork> airportNetwork; // Handoffs between the airports (--airports)
+    unique_ptr<SharedAVNTable> avnTable; // Every AVN, mapped into all processes
 
-    if (pipe(atcToAvn) == -1 || pipe(avnToAirline) == -1 || pipe(airlineToAvn) == -1 ||
-        pipe(airlineToStripe) == -1 || pipe(stripeToAvn) == -1) {
-        cerr << "Pipe creation failed!" << endl;
+    try {
+        atcToAvn = MessageChannel::create(options.transport);
+        avnToAirline = MessageChannel::create(options.transport);
+        airlineToStripe = MessageChannel::create(options.transport);
+        stripeToAvn = MessageChannel::create(options.transport);
+        for (int airport = 1; airport < options.airports; airport++) {
+            airportToAvn.push_back(MessageChannel::create(options.transport));
+        }
+        if (options.airports > 1) {
+            airportNetwork.reset(new AirportNetwork(options.transport, options.airports));
+        }
+        avnTable.reset(new SharedAVNTable(options.airports));
+    } catch (const exception& e) {
+        cerr << "IPC setup failed: " << e.what() << endl;
         return 1;
     }
 
+    // Replay the AVN journal before the controller starts issuing AVNs
+    AVNJournal::Recovery recovered;
+    if (!options.journalPath.empty()) {
+        string error;
+        if (!AVNJournal::recover(options.journalPath, recovered, error)) {
+            cerr << "Cannot recover AVN journal " << options.journalPath << ": " << error << endl;
+            return 1;
+        }
+    }
+
     // Fork AVN Generator process
     pid_t avnPid = fork();
     if (avnPid == 0) {
         // Child process: AVN Generator
-        close(atcToAvn[1]);
-        close(avnToAirline[0]);
-        close(airlineToAvn[1]);
-        close(airlineToStripe[0]);
-        close(airlineToStripe[1]);
-        close(stripeToAvn[0]);
-        close(stripeToAvn[1]);
+        atcToAvn->useAsReader();
+        avnToAirline->useAsWriter();
+        airlineToStripe->detach();
+        
+        // One AVN Generator for every airport, and for StripePay's
+        // confirmations when the portal runs
+        vector<MessageChannel*> inputs = {atcToAvn.get()};
+        for (auto& link : airportToAvn) {
+            link->useAsReader();
+            inputs.push_back(link.get());
+        }
+        if (airportNetwork) {
+            airportNetwork->detach();
+        }
+        if (options.portal) {
+            stripeToAvn->useAsReader();
+            inputs.push_back(stripeToAvn.get());
+        } else {
+            stripeToAvn->detach();
+        }
 
-        AVNGenerator avnGenerator(atcToAvn[0], avnToAirline[1]);
+        Metrics::instance().start("avn-generator");
+        AVNGenerator avnGenerator(inputs, avnToAirline.get(), avnTable.get());
         avnGenerator.run();
+        avnToAirline->closeWriter();
+        Metrics::instance().stop();
+        Logger::instance().shutdown();
         exit(0);
     } else if (avnPid < 0) {
         cerr << "Failed to fork AVN Generator process" << endl;
@@ -1988,17 +8389,23 @@ int main() {
     pid_t stripePid = fork();
     if (stripePid == 0) {
         // Child process: StripePay
-        close(atcToAvn[0]);
-        close(atcToAvn[1]);
-        close(avnToAirline[0]);
-        close(avnToAirline[1]);
-        close(airlineToAvn[0]);
-        close(airlineToAvn[1]);
-        close(airlineToStripe[1]);
-        close(stripeToAvn[0]);
+        atcToAvn->detach();
+        avnToAirline->detach();
+        airlineToStripe->useAsReader();
+        stripeToAvn->useAsWriter();
+        for (auto& link : airportToAvn) {
+            link->detach();
+        }
+        if (airportNetwork) {
+            airportNetwork->detach();
+        }
 
-        StripePay stripePay(airlineToStripe[0], stripeToAvn[1]);
+        Metrics::instance().start("stripepay");
+        StripePay stripePay(airlineToStripe.get(), stripeToAvn.get());
         stripePay.run();
+        stripeToAvn->closeWriter();
+        Metrics::instance().stop();
+        Logger::instance().shutdown();
         exit(0);
     } else if (stripePid < 0) {
         cerr << "Failed to fork StripePay process" << endl;
@@ -2007,18 +8414,168 @@ int main() {
         return 1;
     }
 
-    // Parent process: ATC Controller
-    close(avnToAirline[0]);
-    close(airlineToAvn[1]);
-    close(airlineToStripe[0]);
-    close(stripeToAvn[0]);
-    close(stripeToAvn[1]);
-    
-    // We'll fork a separate process for Airline Portal if needed
+    // Fork the Airline Portal process; it takes over the terminal's input
     pid_t airlinePid = -1;
+    if (options.portal) {
+        cout.flush();
+        airlinePid = fork();
+        if (airlinePid == 0) {
+            atcToAvn->detach();
+            avnToAirline->useAsReader();
+            airlineToStripe->useAsWriter();
+            stripeToAvn->detach();
+            for (auto& link : airportToAvn) {
+                link->detach();
+            }
+            if (airportNetwork) {
+                airportNetwork->detach();
+            }
+            
+            Metrics::instance().start("airline-portal");
+            AirlinePortal portal(avnToAirline.get(), airlineToStripe.get(), avnTable.get());
+            portal.run();
+            airlineToStripe->closeWriter();
+            Metrics::instance().stop();
+            Logger::instance().shutdown();
+            exit(0);
+        } else if (airlinePid < 0) {
+            cerr << "Failed to fork Airline Portal process" << endl;
+            atcToAvn->closeWriter();
+            airlineToStripe->closeWriter();
+            stopChildProcess(avnPid);
+            stopChildProcess(stripePid);
+            return 1;
+        }
+    }
+
+    // A sharded run forks airports 2..N here, each an ATC Controller of its own
+    // with the next seed, its own block of AVN ids and its own link to the AVN
+    // Generator. Airport 1 stays in this process and outlives the others.
+    int airport = 0;
+    vector<pid_t> airportPids;
+    for (int next = 1; next < options.airports; next++) {
+        cout.flush();
+        pid_t pid = fork();
+        if (pid == 0) {
+            airport = next;
+            airportPids.clear();
+            avnPid = -1; // Airport 1 stops those
+            stripePid = -1;
+            airlinePid = -1;
+            swap(atcToAvn, airportToAvn[next - 1]); // From here on atcToAvn is this airport's link
+            break;
+        }
+        if (pid < 0) {
+            // The airports already running see it gone at their first barrier
+            cerr << "Failed to fork airport " << next + 1 << endl;
+            break;
+        }
+        airportPids.push_back(pid);
+    }
+    for (auto& link : airportToAvn) {
+        link->detach();
+    }
+    
+    unique_ptr<AirspaceHandoff> handoff;
+    if (airportNetwork) {
+        airportNetwork->join(airport);
+        handoff.reset(new AirspaceHandoff(*airportNetwork, airport, options.handoffLag));
+        simulationSeed += airport;
+        Aircraft::reserveAvnIds(airport * AIRPORT_AVN_ID_BLOCK + 999);
+        Aircraft::limitAvnIds((airport + 1) * AIRPORT_AVN_ID_BLOCK + 999);
+        avnTable->appendAs(airport);
+        
+        // One core per airport when we may use enough of them; a phase update
+        // pool keeps the whole set. Airport K takes the K-th core we are allowed.
+        cpu_set_t allowed;
+        if (options.threads == 1 && sched_getaffinity(0, sizeof(allowed), &allowed) == 0 &&
+            CPU_COUNT(&allowed) >= options.airports) {
+            int core = -1;
+            for (int seen = -1; seen < airport; ) {
+                if (CPU_ISSET(++core, &allowed)) {
+                    seen++;
+                }
+            }
+            cpu_set_t cores;
+            CPU_ZERO(&cores);
+            CPU_SET(core, &cores);
+            if (sched_setaffinity(0, sizeof(cores), &cores) != 0) {
+                LogLine(LogLevel::WARN) << "Airport " << airport + 1 << " not pinned to core " << core << ": " << strerror(errno);
+            }
+        }
+    }
 
+    // Parent process: ATC Controller. Without the Airline Portal its end of
+    // each link has no process behind it, so those links are closed here. With
+    // it they are only let go: closing a shared memory ring closes it for the portal too.
+    atcToAvn->useAsWriter();
+    if (options.portal) {
+        avnToAirline->detach();
+        airlineToStripe->detach();
+    } else {
+        avnToAirline->closeReader();
+        airlineToStripe->useAsWriter();
+        stripeToAvn->closeReader();
+    }
+    stripeToAvn->detach();
+
+    Metrics::instance().start(airport == 0 ? string("atc-controller") : "atc-controller-" + to_string(airport + 1));
+    
     // Create FlightScheduler
-    FlightScheduler scheduler(atcToAvn[1]);
+    FlightScheduler scheduler(atcToAvn.get(), options);
+    scheduler.attachSharedTable(avnTable.get());
+    scheduler.attachHandoff(handoff.get());
+    
+    // The feed's reader thread, like the journal's, belongs to the controller only
+    if (!options.trafficSource.empty()) {
+        string error;
+        unique_ptr<StreamTraffic> feed = StreamTraffic::open(options.trafficSource, error);
+        if (!feed) {
+            cerr << "Cannot open traffic source " << options.trafficSource << ": " << error << endl;
+            atcToAvn->closeWriter();
+            airlineToStripe->closeWriter();
+            stopChildProcess(avnPid);
+            stopChildProcess(stripePid);
+            return 1;
+        }
+        scheduler.setTrafficSource(move(feed));
+    }
+    
+    if (!options.restorePath.empty()) {
+        auto restoreStart = chrono::steady_clock::now();
+        string error;
+        if (!scheduler.restoreCheckpoint(checkpoint, error)) {
+            cerr << "Cannot restore checkpoint " << options.restorePath << ": " << error << endl;
+            atcToAvn->closeWriter();
+            airlineToStripe->closeWriter();
+            stopChildProcess(avnPid);
+            stopChildProcess(stripePid);
+            return 1;
+        }
+        LogLine(LogLevel::INFO) << "Restored tick " << scheduler.getCurrentTime() << " from " << options.restorePath << " ("
+                                << scheduler.getActiveFlightCount() << " active flights, " << scheduler.getAllAVNs().size()
+                                << " AVNs) in " << fixed << setprecision(1)
+                                << chrono::duration<double, milli>(chrono::steady_clock::now() - restoreStart).count() << " ms";
+    }
+    
+    // Only the controller appends to the journal; opened after the forks so
+    // the committer thread lives in this process alone
+    AVNJournal journal;
+    if (!options.journalPath.empty()) {
+        string error;
+        if (!journal.open(options.journalPath, recovered.validBytes, error)) {
+            cerr << "Cannot open AVN journal " << options.journalPath << ": " << error << endl;
+            atcToAvn->closeWriter();
+            airlineToStripe->closeWriter();
+            stopChildProcess(avnPid);
+            stopChildProcess(stripePid);
+            return 1;
+        }
+        scheduler.restoreAVNs(recovered.avns);
+        scheduler.attachJournal(&journal);
+        LogLine(LogLevel::INFO) << "Restored " << recovered.avns.size() << " AVNs from " << recovered.records
+                                << " journal records";
+    }
     
     // Current simulation time
     int simulationTime = 0;
@@ -2026,8 +8583,15 @@ int main() {
     
     bool continueProgram = true;
     
+    // Headless batch mode skips the menus entirely
+    if (options.headless) {
+        runHeadlessSimulation(scheduler, options, handoff.get());
+        continueProgram = false;
+    }
+    
     while (continueProgram) {
         // Display main menu
+        Logger::instance().flush();
         system("clear"); // Clear screen
         cout << "╔══════════════════════════════════════╗" << endl;
         cout << "║         AIRCONTROLX SYSTEM           ║" << endl;
@@ -2035,7 +8599,8 @@ int main() {
         cout << "║ 1. Run Air Traffic Simulation        ║" << endl;
         cout << "║ 2. View & Pay AVNs                   ║" << endl;
         cout << "║ 3. View Airline Violations           ║" << endl;
-        cout << "║ 4. Exit                              ║" << endl;
+        cout << "║ 4. AVN Analytics Dashboard           ║" << endl;
+        cout << "║ 5. Exit                              ║" << endl;
         cout << "╚══════════════════════════════════════╝" << endl;
         cout << "Select an option: ";
         
@@ -2069,8 +8634,8 @@ int main() {
                     // Display status
                     //system("clear");
                     scheduler.printStatus();
-                    cout << "\nSimulation Time: " << ++simulationTime << "/" << MAX_SIMULATION_TIME << " seconds" << endl;
-                    cout << "Press 'q' to return to the main menu." << endl;
+                    LogLine(LogLevel::INFO) << "\nSimulation Time: " << ++simulationTime << "/" << MAX_SIMULATION_TIME << " seconds";
+                    LogLine(LogLevel::INFO) << "Press 'q' to return to the main menu.";
                     
                     // Check for user input (non-blocking)
                     FD_ZERO(&readfds);
@@ -2092,6 +8657,7 @@ int main() {
                 // Restore terminal settings
                 tcsetattr(STDIN_FILENO, TCSANOW, &oldSettings);
                 
+                Logger::instance().flush();
                 if (simulationTime >= MAX_SIMULATION_TIME) {
                     cout << "\nSimulation completed!" << endl;
                     cout << "Press Enter to return to the main menu...";
@@ -2108,6 +8674,7 @@ int main() {
                 bool avnMenuActive = true;
                 
                 while (avnMenuActive) {
+                    Logger::instance().flush();
                     system("clear");
                     cout << "╔══════════════════════════════════════╗" << endl;
                     cout << "║          AVN MANAGEMENT              ║" << endl;
@@ -2250,6 +8817,7 @@ int main() {
                 bool airlineMenuActive = true;
                 
                 while (airlineMenuActive) {
+                    Logger::instance().flush();
                     system("clear");
                     cout << "╔══════════════════════════════════════╗" << endl;
                     cout << "║        AIRLINE VIOLATIONS            ║" << endl;
@@ -2314,7 +8882,16 @@ int main() {
                 break;
             }
             
-            case 4:
+            case 4: {
+                system("clear");
+                scheduler.displayAnalytics();
+                cout << "\nPress Enter to continue...";
+                cin.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+                cin.get();
+                break;
+            }
+            
+            case 5:
                 continueProgram = false;
                 cout << "\nExiting AirControlX System. Goodbye!" << endl;
                 break;
@@ -2326,21 +8903,29 @@ int main() {
         }
     }
     
-    // Clean up and wait for child processes
-    if (avnPid > 0) {
-        kill(avnPid, SIGTERM);
-        waitpid(avnPid, nullptr, 0);
-    }
-    
-    if (stripePid > 0) {
-        kill(stripePid, SIGTERM);
-        waitpid(stripePid, nullptr, 0);
+    // Clean up and wait for child processes. Closing our write ends lets the
+    // AVN Generator and StripePay drain their input and flush their logs.
+    scheduler.drainAVNNotices(2000);
+    for (pid_t pid : airportPids) {
+        waitpid(pid, nullptr, 0); // Still sending to the AVN Generator until they finish
     }
-    
     if (airlinePid > 0) {
-        kill(airlinePid, SIGTERM);
-        waitpid(airlinePid, nullptr, 0);
+        // The portal stays up for its user after the run; StripePay and the AVN
+        // Generator serve it until it exits, and its payments are still taken in
+        Logger::instance().flush();
+        while (waitpid(airlinePid, nullptr, WNOHANG) == 0) {
+            scheduler.takeInPayments();
+            this_thread::sleep_for(chrono::milliseconds(50));
+        }
+        scheduler.takeInPayments();
     }
+    journal.close();
+    atcToAvn->closeWriter();
+    airlineToStripe->closeWriter();
+    stopChildProcess(avnPid);
+    stopChildProcess(stripePid);
     
+    Metrics::instance().stop();
+    Logger::instance().shutdown();
     return 0;
 }
\ No newline at end of file
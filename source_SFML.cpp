@@ -13,6 +13,7 @@
  #include <sstream>
  #include <memory>
  #include <algorithm>
+ #include <cmath>
  #include <ctime>
  #include <unistd.h> 
  #include <fcntl.h>
@@ -29,6 +30,7 @@
 #include <SFML/Window.hpp>
 #include <SFML/System.hpp>
 #include <atomic>
+#include <unordered_map>
 
  using namespace std;
  
@@ -806,6 +808,64 @@ void checkViolation() override {
      }
  };
  
+ // One flight as the renderer sees it, copied out of the scheduler after each tick
+ struct FlightSnapshot {
+     string flightNumber;
+     string airline;
+     string summary;
+     string stateString;
+     string runwayString;
+     FlightType type;
+     Direction direction;
+     Runway assignedRunway;
+     bool isEmergency;
+     bool isArrival;
+     int state;  // ArrivalState or DepartureState, depending on isArrival
+     int currentSpeed;
+     bool hasActiveViolation;
+     int avnId;
+     double fine;
+ };
+ 
+ struct WorldSnapshot {
+     int simulationTime = 0;
+     size_t completedFlights = 0;
+     vector<FlightSnapshot> flights;
+     string statusReport;  // The terminal view's text for this tick
+ };
+ 
+ // Triple buffer between the simulation and the render thread: the writer always
+ // has a free slot and the reader always keeps a complete one, so neither waits
+ class SnapshotBuffer {
+ private:
+     static constexpr int FRESH = 4;
+     WorldSnapshot slots[3];
+     atomic<int> ready;  // latest published slot, FRESH set until the reader takes it
+     int writing;
+     int reading;
+ 
+ public:
+     SnapshotBuffer() : ready(1), writing(0), reading(2) {}
+     
+     WorldSnapshot& back() {
+         return slots[writing];
+     }
+     
+     void publish() {
+         writing = ready.exchange(writing | FRESH, memory_order_acq_rel) & ~FRESH;
+     }
+     
+     // Newest world, or nullptr if nothing was published since the last call.
+     // The returned slot stays untouched until the next acquire.
+     const WorldSnapshot* acquire() {
+         if (!(ready.load(memory_order_acquire) & FRESH)) {
+             return nullptr;
+         }
+         reading = ready.exchange(reading, memory_order_acq_rel) & ~FRESH;
+         return &slots[reading];
+     }
+ };
+ 
  class FlightScheduler {
  private:
      vector<shared_ptr<Aircraft>> allFlights;
@@ -1315,26 +1375,26 @@ void checkViolation() override {
          activeFlights = stillActive;
      }
      
-     void printStatus() {
-         lock_guard<mutex> lock(cout_mutex);
-         
-         cout << "\n======== AIRCONTROLX STATUS ========" << endl;
-         cout << "Simulation Time: " << currentSimulationTime << " seconds" << endl;
-         cout << "Active Flights: " << activeFlights.size() << endl;
-         cout << "Completed Flights: " << completedFlights.size() << endl;
+     // The status panel as text; built on the simulation thread into each snapshot
+     string statusReport() const {
+         ostringstream out;
+         out << "\n======== AIRCONTROLX STATUS ========" << endl;
+         out << "Simulation Time: " << currentSimulationTime << " seconds" << endl;
+         out << "Active Flights: " << activeFlights.size() << endl;
+         out << "Completed Flights: " << completedFlights.size() << endl;
          
-         cout << "\n--- RUNWAY STATUS ---" << endl;
-         cout << "Runway A: " << (runwayAOccupant ? runwayAOccupant->flightNumber + " (" + runwayAOccupant->airline + ")" : "Free") << endl;
-         cout << "Runway B: " << (runwayBOccupant ? runwayBOccupant->flightNumber + " (" + runwayBOccupant->airline + ")" : "Free") << endl;
-         cout << "Runway C: " << (runwayCOccupant ? runwayCOccupant->flightNumber + " (" + runwayCOccupant->airline + ")" : "Free") << endl;
+         out << "\n--- RUNWAY STATUS ---" << endl;
+         out << "Runway A: " << (runwayAOccupant ? runwayAOccupant->flightNumber + " (" + runwayAOccupant->airline + ")" : "Free") << endl;
+         out << "Runway B: " << (runwayBOccupant ? runwayBOccupant->flightNumber + " (" + runwayBOccupant->airline + ")" : "Free") << endl;
+         out << "Runway C: " << (runwayCOccupant ? runwayCOccupant->flightNumber + " (" + runwayCOccupant->airline + ")" : "Free") << endl;
          
-         cout << "\n--- QUEUE STATUS ---" << endl;
-         cout << "Runway A Queue: " << runwayAQueue.size() << " flights waiting" << endl;
-         cout << "Runway B Queue: " << runwayBQueue.size() << " flights waiting" << endl;
+         out << "\n--- QUEUE STATUS ---" << endl;
+         out << "Runway A Queue: " << runwayAQueue.size() << " flights waiting" << endl;
+         out << "Runway B Queue: " << runwayBQueue.size() << " flights waiting" << endl;
          
-         cout << "\n--- ACTIVE FLIGHTS ---" << endl;
+         out << "\n--- ACTIVE FLIGHTS ---" << endl;
          for (const auto& flight : activeFlights) {
-             cout << flight->getSummary() << endl;
+             out << flight->getSummary() << endl;
          }
          
         //  cout << "\n--- ACTIVE VIOLATIONS ---" << endl;
@@ -1351,14 +1411,14 @@ void checkViolation() override {
         //      cout << "No active violations." << endl;
         //  }
         
-        cout << "\n--- ACTIVE AVNs ---" << endl;
+        out << "\n--- ACTIVE AVNs ---" << endl;
         if (allAVNs.empty()) {
-            cout << "No AVNs issued yet." << endl;
+            out << "No AVNs issued yet." << endl;
         } else {
             bool hasUnpaidAVNs = false;
             for (const auto& avn : allAVNs) {
                 if (avn->status == PaymentStatus::UNPAID) {
-                    cout << "AVN #" << avn->id << " | " << avn->airline << " flight " << avn->flightNumber 
+                    out << "AVN #" << avn->id << " | " << avn->airline << " flight " << avn->flightNumber 
                         << " | Speed: " << avn->recordedSpeed << " km/h"
                         << " | Amount: PKR " << fixed << setprecision(2) << avn->totalAmount << endl;
                     hasUnpaidAVNs = true;
@@ -1366,10 +1426,11 @@ void checkViolation() override {
             }
             
             if (!hasUnpaidAVNs) {
-                cout << "All AVNs have been paid." << endl;
+                out << "All AVNs have been paid." << endl;
             }
         }
-         cout << "=====================================" << endl;
+         out << "=====================================" << endl;
+         return out.str();
      }
      
      void processAVNPayment(int avnId, double amount) {
@@ -1424,6 +1485,38 @@ void checkViolation() override {
      }
      
      const std::vector<std::shared_ptr<Aircraft>>& getActiveFlights() const { return activeFlights; }
+     
+     // Called on the simulation thread between ticks; reuses the slot's storage
+     void fillSnapshot(WorldSnapshot& snapshot) const {
+         snapshot.simulationTime = currentSimulationTime;
+         snapshot.completedFlights = completedFlights.size();
+         snapshot.statusReport = statusReport();
+         snapshot.flights.resize(activeFlights.size());
+         for (size_t i = 0; i < activeFlights.size(); ++i) {
+             const Aircraft& flight = *activeFlights[i];
+             FlightSnapshot& view = snapshot.flights[i];
+             view.flightNumber = flight.flightNumber;
+             view.airline = flight.airline;
+             view.summary = flight.getSummary();
+             view.stateString = flight.getStateString();
+             view.runwayString = flight.getRunwayString();
+             view.type = flight.type;
+             view.direction = flight.direction;
+             view.assignedRunway = flight.assignedRunway;
+             view.isEmergency = flight.isEmergency;
+             view.currentSpeed = flight.currentSpeed;
+             view.hasActiveViolation = flight.hasActiveViolation && flight.currentViolation;
+             view.avnId = view.hasActiveViolation ? flight.currentViolation->id : 0;
+             view.fine = view.hasActiveViolation ? flight.currentViolation->totalAmount : 0.0;
+             if (auto arrival = dynamic_cast<const ArrivalFlight*>(&flight)) {
+                 view.isArrival = true;
+                 view.state = static_cast<int>(arrival->getState());
+             } else {
+                 view.isArrival = false;
+                 view.state = static_cast<int>(static_cast<const DepartureFlight&>(flight).getState());
+             }
+         }
+     }
  };
  
  class AVNGenerator {
@@ -1798,9 +1891,10 @@ void checkViolation() override {
      bool graphicsEnabled;
      std::vector<sf::RectangleShape> runways;
      std::vector<sf::Text> runwayLabels;
-     sf::CircleShape aircraftShape;
-     std::map<std::string, sf::CircleShape> aircraftShapes;
-     std::map<std::string, sf::Text> aircraftLabels;
+     // All aircraft go out in one draw call, all flight labels in another
+     sf::VertexArray aircraftVertices;
+     sf::VertexArray labelVertices;
+     sf::Glyph labelGlyphs[128];
      sf::Text timerText;
      sf::Text statusText;
      sf::Text runwayStatusText;
@@ -1808,6 +1902,19 @@ void checkViolation() override {
      sf::Text activeFlightsText;
      sf::Text avnStatusText;
      int simulationTime;
+     // Each flight glides from where it was shown to its new position over one tick
+     struct Motion {
+         std::string flightNumber;
+         sf::Vector2f from;
+         sf::Vector2f to;
+     };
+     const WorldSnapshot* world;
+     std::vector<Motion> motions;  // parallel to world->flights
+     std::unordered_map<std::string, sf::Vector2f> shownPositions;
+     std::chrono::steady_clock::time_point snapshotArrival;
+     float tickSeconds;
+     // Key of what each panel last showed; its string is rebuilt only when this changes
+     size_t timerKey, statusKey, runwayKey, queueKey, flightsKey, avnKey;
 
      static constexpr int WINDOW_WIDTH = 800;
      static constexpr int WINDOW_HEIGHT = 600;
@@ -1816,9 +1923,17 @@ void checkViolation() override {
      static constexpr float AIRCRAFT_RADIUS = 10.0f;
      static constexpr float RUNWAY_SPACING = 100.0f;
      static constexpr float LEFT_MARGIN = 200.0f;  // Space for text on the left
+     static constexpr int AIRCRAFT_SEGMENTS = 12;
+     static constexpr unsigned int LABEL_SIZE = 12;
+     static constexpr size_t NO_KEY = static_cast<size_t>(-1);
+     sf::Vector2f circleOffsets[AIRCRAFT_SEGMENTS];
 
  public:
-     AirportGraphics() : graphicsEnabled(false), simulationTime(0) {
+     AirportGraphics() : graphicsEnabled(false), aircraftVertices(sf::Triangles),
+                         labelVertices(sf::Triangles), simulationTime(0),
+                         world(nullptr), tickSeconds(1.0f),
+                         timerKey(NO_KEY), statusKey(NO_KEY), runwayKey(NO_KEY),
+                         queueKey(NO_KEY), flightsKey(NO_KEY), avnKey(NO_KEY) {
          try {
              const char* display = getenv("DISPLAY");
              if (!display) {
@@ -1849,6 +1964,7 @@ void checkViolation() override {
              initializeRunways();
              std::cout << "Runways initialized successfully." << std::endl;
              initializeTextElements();
+             initializeAircraftGeometry();
              graphicsEnabled = true;
              std::cout << "Graphics initialized successfully. Window should be visible now." << std::endl;
              window.setPosition(sf::Vector2i(
@@ -1865,119 +1981,207 @@ void checkViolation() override {
              }
          }
      }
-     void update(const std::vector<std::shared_ptr<Aircraft>>& flights, int currentTime) {
+     // Runs on the render thread: draws the newest published world, never the live one
+     void renderFrame(SnapshotBuffer& snapshots) {
          if (!graphicsEnabled) {
              return;
          }
          try {
-             simulationTime = currentTime;
+             auto now = std::chrono::steady_clock::now();
+             if (const WorldSnapshot* latest = snapshots.acquire()) {
+                 takeSnapshot(*latest, now);
+             }
              window.clear(sf::Color::White);
+             window.draw(timerText);
+             window.draw(statusText);
+             window.draw(runwayStatusText);
+             window.draw(queueStatusText);
+             window.draw(activeFlightsText);
+             window.draw(avnStatusText);
+             for (size_t i = 0; i < runways.size(); ++i) {
+                 window.draw(runways[i]);
+                 window.draw(runwayLabels[i]);
+             }
+             aircraftVertices.clear();
+             labelVertices.clear();
+             if (world) {
+                 float alpha = std::min(1.0f, std::chrono::duration<float>(now - snapshotArrival).count() / tickSeconds);
+                 for (size_t i = 0; i < world->flights.size(); ++i) {
+                     appendAircraft(world->flights[i], interpolate(motions[i], alpha));
+                 }
+             }
+             window.draw(aircraftVertices);
+             window.draw(labelVertices, sf::RenderStates(&font.getTexture(LABEL_SIZE)));
+             window.display();
+         } catch (const std::exception& e) {
+             std::cerr << "Error updating graphics: " << e.what() << std::endl;
+             graphicsEnabled = false;
+             window.close();
+         }
+     }
+     bool isOpen() const {
+         return graphicsEnabled && window.isOpen();
+     }
+     void handleEvents() {
+         if (!graphicsEnabled) {
+             return;
+         }
+         try {
+             sf::Event event;
+             while (window.pollEvent(event)) {
+                 if (event.type == sf::Event::Closed) {
+                     window.close();
+                     graphicsEnabled = false;
+                 }
+             }
+         } catch (const std::exception& e) {
+             std::cerr << "Error handling events: " << e.what() << std::endl;
+             graphicsEnabled = false;
+             window.close();
+         }
+     }
+ private:
+     static sf::Vector2f interpolate(const Motion& motion, float alpha) {
+         return sf::Vector2f(motion.from.x + (motion.to.x - motion.from.x) * alpha,
+                             motion.from.y + (motion.to.y - motion.from.y) * alpha);
+     }
+     void takeSnapshot(const WorldSnapshot& latest, std::chrono::steady_clock::time_point now) {
+         float alpha = 1.0f;
+         if (world) {
+             float elapsed = std::chrono::duration<float>(now - snapshotArrival).count();
+             alpha = std::min(1.0f, elapsed / tickSeconds);
+             // Ticks are paced by the simulation thread; follow whatever rate it actually runs at
+             tickSeconds = std::max(1.0f / 60.0f, std::min(2.0f, elapsed));
+         }
+         // The previous world's slot already belongs to the writer again, so only motions are read here
+         shownPositions.clear();
+         for (const Motion& motion : motions) {
+             shownPositions[motion.flightNumber] = interpolate(motion, alpha);
+         }
+         motions.resize(latest.flights.size());
+         for (size_t i = 0; i < latest.flights.size(); ++i) {
+             motions[i].flightNumber = latest.flights[i].flightNumber;
+             motions[i].to = targetPosition(latest.flights[i]);
+             auto shown = shownPositions.find(latest.flights[i].flightNumber);
+             motions[i].from = shown != shownPositions.end() ? shown->second : motions[i].to;
+         }
+         world = &latest;
+         snapshotArrival = now;
+         simulationTime = latest.simulationTime;
+         refreshPanels(latest);
+     }
+     static size_t mixKey(size_t key, size_t value) {
+         return key ^ (value + 0x9e3779b97f4a7c15ULL + (key << 6) + (key >> 2));
+     }
+     // Panels only change when the simulation does, not on every frame
+     void refreshPanels(const WorldSnapshot& latest) {
+         const std::vector<FlightSnapshot>& flights = latest.flights;
+         size_t key = static_cast<size_t>(simulationTime);
+         if (key != timerKey) {
+             timerKey = key;
              int minutes = simulationTime / 60;
              int seconds = simulationTime % 60;
              std::stringstream ss;
              ss << "Time: " << std::setfill('0') << std::setw(2) << minutes << ":"
                 << std::setfill('0') << std::setw(2) << seconds;
              timerText.setString(ss.str());
+         }
+         key = mixKey(flights.size(), latest.completedFlights);
+         if (key != statusKey) {
+             statusKey = key;
              std::stringstream statusSS;
              statusSS << "AIRCONTROLX STATUS\n\n"
                      << "Active Flights: " << flights.size() << "\n"
-                     << "Completed Flights: 0\n";
+                     << "Completed Flights: " << latest.completedFlights << "\n";
              statusText.setString(statusSS.str());
+         }
+         key = 0;
+         int runwayAQueueSize = 0;
+         int runwayBQueueSize = 0;
+         int runwayCQueueSize = 0;
+         for (const auto& flight : flights) {
+             if (flight.assignedRunway != Runway::NONE) {
+                 key = mixKey(key, std::hash<std::string>()(flight.flightNumber));
+                 key = mixKey(key, static_cast<size_t>(flight.assignedRunway));
+             } else if (flight.direction == Direction::NORTH || flight.direction == Direction::SOUTH) {
+                 runwayAQueueSize++;
+             } else if (flight.direction == Direction::EAST || flight.direction == Direction::WEST) {
+                 runwayBQueueSize++;
+             } else {
+                 runwayCQueueSize++;
+             }
+         }
+         if (key != runwayKey) {
+             runwayKey = key;
              std::stringstream runwaySS;
              runwaySS << "RUNWAY STATUS\n\n";
              for (const auto& flight : flights) {
-                 if (flight->assignedRunway != Runway::NONE) {
-                     runwaySS << "Runway " << flight->getRunwayString() << ": "
-                             << flight->flightNumber << " (" << flight->airline << ")\n";
+                 if (flight.assignedRunway != Runway::NONE) {
+                     runwaySS << "Runway " << flight.runwayString << ": "
+                             << flight.flightNumber << " (" << flight.airline << ")\n";
                  }
              }
              runwayStatusText.setString(runwaySS.str());
+         }
+         key = mixKey(mixKey(static_cast<size_t>(runwayAQueueSize), runwayBQueueSize), runwayCQueueSize);
+         if (key != queueKey) {
+             queueKey = key;
              std::stringstream queueSS;
-             queueSS << "QUEUE STATUS\n\n";
-             int runwayAQueueSize = 0;
-             int runwayBQueueSize = 0;
-             int runwayCQueueSize = 0;
-             for (const auto& flight : flights) {
-                 if (flight->assignedRunway == Runway::NONE) {
-                     if (flight->direction == Direction::NORTH || flight->direction == Direction::SOUTH) {
-                         runwayAQueueSize++;
-                     } else if (flight->direction == Direction::EAST || flight->direction == Direction::WEST) {
-                         runwayBQueueSize++;
-                     } else {
-                         runwayCQueueSize++;
-                     }
-                 }
-             }
-             queueSS << "Runway A Queue: " << runwayAQueueSize << " flights waiting\n"
+             queueSS << "QUEUE STATUS\n\n"
+                    << "Runway A Queue: " << runwayAQueueSize << " flights waiting\n"
                     << "Runway B Queue: " << runwayBQueueSize << " flights waiting\n"
                     << "Runway C Queue: " << runwayCQueueSize << " flights waiting\n";
              queueStatusText.setString(queueSS.str());
+         }
+         // Speeds and states move once per simulated second
+         key = mixKey(static_cast<size_t>(simulationTime), flights.size());
+         if (key != flightsKey) {
+             flightsKey = key;
              std::stringstream flightsSS;
              flightsSS << "ACTIVE FLIGHTS\n\n";
              for (const auto& flight : flights) {
-                 flightsSS << flight->getSummary() << "\n";
+                 flightsSS << flight.summary << "\n";
              }
              activeFlightsText.setString(flightsSS.str());
+         }
+         key = static_cast<size_t>(simulationTime);
+         for (const auto& flight : flights) {
+             if (flight.hasActiveViolation) {
+                 key = mixKey(key, flight.avnId);
+             }
+         }
+         if (key != avnKey) {
+             avnKey = key;
              std::stringstream avnSS;
              avnSS << "ACTIVE VIOLATIONS\n\n";
              bool hasViolations = false;
              for (const auto& flight : flights) {
-                 if (flight->hasActiveViolation && flight->currentViolation) {
+                 if (flight.hasActiveViolation) {
                      hasViolations = true;
-                     avnSS << "Flight " << flight->flightNumber << " (" << flight->airline << ")\n"
-                           << "Speed: " << flight->currentSpeed << " km/h\n"
-                           << "State: " << flight->getStateString() << "\n"
-                           << "AVN ID: " << flight->currentViolation->id << "\n"
-                           << "Fine: PKR " << std::fixed << std::setprecision(2) 
-                           << flight->currentViolation->totalAmount << "\n\n";
+                     avnSS << "Flight " << flight.flightNumber << " (" << flight.airline << ")\n"
+                           << "Speed: " << flight.currentSpeed << " km/h\n"
+                           << "State: " << flight.stateString << "\n"
+                           << "AVN ID: " << flight.avnId << "\n"
+                           << "Fine: PKR " << std::fixed << std::setprecision(2)
+                           << flight.fine << "\n\n";
                  }
              }
              if (!hasViolations) {
                  avnSS << "No active violations.\n";
              }
              avnStatusText.setString(avnSS.str());
-             window.draw(timerText);
-             window.draw(statusText);
-             window.draw(runwayStatusText);
-             window.draw(queueStatusText);
-             window.draw(activeFlightsText);
-             window.draw(avnStatusText);
-             for (size_t i = 0; i < runways.size(); ++i) {
-                 window.draw(runways[i]);
-                 window.draw(runwayLabels[i]);
-             }
-             for (const auto& flight : flights) {
-                 updateAircraftPosition(flight);
-             }
-             window.display();
-         } catch (const std::exception& e) {
-             std::cerr << "Error updating graphics: " << e.what() << std::endl;
-             graphicsEnabled = false;
-             window.close();
          }
      }
-     bool isOpen() const {
-         return graphicsEnabled && window.isOpen();
-     }
-     void handleEvents() {
-         if (!graphicsEnabled) {
-             return;
+     // Circle outline and the label glyphs are computed once, then only translated per frame
+     void initializeAircraftGeometry() {
+         for (int i = 0; i < AIRCRAFT_SEGMENTS; ++i) {
+             float angle = 2.0f * 3.14159265f * i / AIRCRAFT_SEGMENTS;
+             circleOffsets[i] = sf::Vector2f(AIRCRAFT_RADIUS * std::cos(angle), AIRCRAFT_RADIUS * std::sin(angle));
          }
-         try {
-             sf::Event event;
-             while (window.pollEvent(event)) {
-                 if (event.type == sf::Event::Closed) {
-                     window.close();
-                     graphicsEnabled = false;
-                 }
-             }
-         } catch (const std::exception& e) {
-             std::cerr << "Error handling events: " << e.what() << std::endl;
-             graphicsEnabled = false;
-             window.close();
+         for (int c = 32; c < 127; ++c) {
+             labelGlyphs[c] = font.getGlyph(static_cast<sf::Uint32>(c), LABEL_SIZE, false);
          }
      }
- private:
      void initializeTextElements() {
          timerText.setFont(font);
          timerText.setCharacterSize(24);
@@ -2027,26 +2231,14 @@ void checkViolation() override {
              runwayLabels.push_back(label);
          }
      }
-     void updateAircraftPosition(const std::shared_ptr<Aircraft>& aircraft) {
-         std::string id = aircraft->flightNumber;
-         if (aircraftShapes.find(id) == aircraftShapes.end()) {
-             sf::CircleShape shape(AIRCRAFT_RADIUS);
-             shape.setFillColor(getAircraftColor(aircraft));
-             aircraftShapes[id] = shape;
-             sf::Text label;
-             label.setFont(font);
-             label.setString(id);
-             label.setCharacterSize(12);
-             label.setFillColor(sf::Color::Black);
-             aircraftLabels[id] = label;
-         }
+     sf::Vector2f targetPosition(const FlightSnapshot& aircraft) const {
          float x = (WINDOW_WIDTH - RUNWAY_LENGTH) / 2;
          float y = (WINDOW_HEIGHT - (3 * RUNWAY_SPACING)) / 2;
-         if (aircraft->assignedRunway != Runway::NONE) {
-             int runwayIndex = static_cast<int>(aircraft->assignedRunway);
+         if (aircraft.assignedRunway != Runway::NONE) {
+             int runwayIndex = static_cast<int>(aircraft.assignedRunway);
              y += (runwayIndex * RUNWAY_SPACING) + (RUNWAY_WIDTH / 2);
-             if (auto arrival = dynamic_pointer_cast<ArrivalFlight>(aircraft)) {
-                 switch (arrival->getState()) {
+             if (aircraft.isArrival) {
+                 switch (static_cast<ArrivalState>(aircraft.state)) {
                      case ArrivalState::HOLDING:
                          x = (WINDOW_WIDTH - RUNWAY_LENGTH) / 2 - 100;
                          break;
@@ -2063,8 +2255,8 @@ void checkViolation() override {
                          x = (WINDOW_WIDTH - RUNWAY_LENGTH) / 2 + 600;
                          break;
                  }
-             } else if (auto departure = dynamic_pointer_cast<DepartureFlight>(aircraft)) {
-                 switch (departure->getState()) {
+             } else {
+                 switch (static_cast<DepartureState>(aircraft.state)) {
                      case DepartureState::AT_GATE:
                          x = (WINDOW_WIDTH - RUNWAY_LENGTH) / 2 + 600;
                          break;
@@ -2083,15 +2275,53 @@ void checkViolation() override {
                  }
              }
          }
-         aircraftShapes[id].setPosition(x - AIRCRAFT_RADIUS, y - AIRCRAFT_RADIUS);
-         aircraftLabels[id].setPosition(x - AIRCRAFT_RADIUS, y - AIRCRAFT_RADIUS - 20);
-         window.draw(aircraftShapes[id]);
-         window.draw(aircraftLabels[id]);
+         return sf::Vector2f(x, y);
+     }
+     void appendAircraft(const FlightSnapshot& aircraft, sf::Vector2f center) {
+         sf::Color color = getAircraftColor(aircraft);
+         for (int i = 0; i < AIRCRAFT_SEGMENTS; ++i) {
+             aircraftVertices.append(sf::Vertex(center, color));
+             aircraftVertices.append(sf::Vertex(center + circleOffsets[i], color));
+             aircraftVertices.append(sf::Vertex(center + circleOffsets[(i + 1) % AIRCRAFT_SEGMENTS], color));
+         }
+         appendLabel(aircraft.flightNumber, center.x - AIRCRAFT_RADIUS, center.y - AIRCRAFT_RADIUS - 20);
+     }
+     // Same layout sf::Text would give, as textured quads into the shared label array
+     void appendLabel(const std::string& label, float x, float top) {
+         float baseline = top + LABEL_SIZE;
+         for (char ch : label) {
+             unsigned char c = static_cast<unsigned char>(ch);
+             if (c < 32 || c >= 127) {
+                 continue;
+             }
+             const sf::Glyph& glyph = labelGlyphs[c];
+             float left = x + glyph.bounds.left;
+             float right = left + glyph.bounds.width;
+             float upper = baseline + glyph.bounds.top;
+             float lower = upper + glyph.bounds.height;
+             float u1 = static_cast<float>(glyph.textureRect.left);
+             float v1 = static_cast<float>(glyph.textureRect.top);
+             float u2 = u1 + glyph.textureRect.width;
+             float v2 = v1 + glyph.textureRect.height;
+             sf::Vertex corners[4] = {
+                 sf::Vertex(sf::Vector2f(left, upper), sf::Color::Black, sf::Vector2f(u1, v1)),
+                 sf::Vertex(sf::Vector2f(right, upper), sf::Color::Black, sf::Vector2f(u2, v1)),
+                 sf::Vertex(sf::Vector2f(right, lower), sf::Color::Black, sf::Vector2f(u2, v2)),
+                 sf::Vertex(sf::Vector2f(left, lower), sf::Color::Black, sf::Vector2f(u1, v2))
+             };
+             labelVertices.append(corners[0]);
+             labelVertices.append(corners[1]);
+             labelVertices.append(corners[2]);
+             labelVertices.append(corners[0]);
+             labelVertices.append(corners[2]);
+             labelVertices.append(corners[3]);
+             x += glyph.advance;
+         }
      }
-     sf::Color getAircraftColor(const std::shared_ptr<Aircraft>& aircraft) {
-         if (aircraft->isEmergency) {
+     sf::Color getAircraftColor(const FlightSnapshot& aircraft) {
+         if (aircraft.isEmergency) {
              return sf::Color::Red;
-         } else if (aircraft->type == FlightType::CARGO) {
+         } else if (aircraft.type == FlightType::CARGO) {
              return sf::Color::Blue;
          } else {
              return sf::Color::Green;
@@ -2102,7 +2332,9 @@ void checkViolation() override {
  // Global simulation time and scheduler
  std::atomic<int> simulationTime{0};
  FlightScheduler* globalScheduler = nullptr;
- bool simulationRunning = true;
+ SnapshotBuffer worldSnapshots;   // Read by the render thread
+ SnapshotBuffer statusSnapshots;  // Read by the terminal view; each buffer has one reader
+ std::atomic<bool> simulationRunning{true};
  std::atomic<bool> simulationPaused{true};
 
 void simulationLoop() {
@@ -2110,6 +2342,10 @@ void simulationLoop() {
         if (!simulationPaused && simulationTime < SIMULATION_TIME) {
             globalScheduler->updateSimulation();
             simulationTime++;
+            globalScheduler->fillSnapshot(worldSnapshots.back());
+            worldSnapshots.publish();
+            globalScheduler->fillSnapshot(statusSnapshots.back());
+            statusSnapshots.publish();
         }
         std::this_thread::sleep_for(std::chrono::seconds(1));
     }
@@ -2219,27 +2455,31 @@ int main() {
             tcsetattr(STDIN_FILENO, TCSANOW, &newSettings);
             fd_set readfds;
             struct timeval tv;
-            AirportGraphics* graphics = new AirportGraphics();
-            
-            int lastPrintTime = -10; 
-            const int PRINT_INTERVAL = 1; 
+            // The window lives on its own thread and only ever sees published snapshots,
+            // so a slow frame cannot hold up a tick and a heavy tick cannot drop frames
+            std::atomic<bool> renderRunning{true};
+            std::atomic<bool> windowOpen{true};
+            std::thread renderThread([&renderRunning, &windowOpen]() {
+                AirportGraphics graphics;
+                while (renderRunning && graphics.isOpen()) {
+                    graphics.handleEvents();
+                    graphics.renderFrame(worldSnapshots);
+                }
+                windowOpen = false;
+            });
             
             while (true) {
-                if (graphics && graphics->isOpen()) {
-                    graphics->handleEvents();
-                    graphics->update(scheduler.getActiveFlights(), simulationTime);
-                    
-                    if (simulationTime >= lastPrintTime + PRINT_INTERVAL) {
-                        cout << "\033[2J\033[H"; 
-                        cout << "AIR TRAFFIC SIMULATION (Terminal View)" << endl;
-                        cout << "SFML window is running alongside this terminal" << endl;
-                        cout << "Press 'q' at any time to return to the main menu" << endl;
-                        cout << "--------------------------------------------" << endl;
-                        
-                        scheduler.printStatus();
-                        
-                        lastPrintTime = simulationTime;
-                    }
+                // Like the window, the terminal only reads published snapshots,
+                // never the scheduler the simulation thread is changing
+                const WorldSnapshot* latest = statusSnapshots.acquire();
+                if (windowOpen && latest) {
+                    lock_guard<mutex> lock(cout_mutex);
+                    cout << "\033[2J\033[H"; 
+                    cout << "AIR TRAFFIC SIMULATION (Terminal View)" << endl;
+                    cout << "SFML window is running alongside this terminal" << endl;
+                    cout << "Press 'q' at any time to return to the main menu" << endl;
+                    cout << "--------------------------------------------" << endl;
+                    cout << latest->statusReport << flush;
                 }
                 
                 FD_ZERO(&readfds);
@@ -2255,9 +2495,8 @@ int main() {
                 std::this_thread::sleep_for(std::chrono::milliseconds(100));
             }
             tcsetattr(STDIN_FILENO, TCSANOW, &oldSettings);
-            if (graphics) {
-                delete graphics;
-            }
+            renderRunning = false;
+            renderThread.join();
             simulationPaused = true;
             break;
         }